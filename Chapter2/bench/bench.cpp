@@ -0,0 +1,531 @@
+#include "graphics/canvas.hpp"
+#include "graphics/clipping.hpp"
+#include "graphics/culling.hpp"
+#include "graphics/mesh.hpp"
+#include "graphics/parallel.hpp"
+#include "graphics/path_tracer.hpp"
+#include "graphics/profiler.hpp"
+#include "graphics/rasterizer.hpp"
+#include "graphics/raytracing.hpp"
+#include "graphics/scenes.hpp"
+#include "graphics/simd.hpp"
+#include "graphics/stats.hpp"
+#include "graphics/texture.hpp"
+#include "graphics/transform.hpp"
+#include "raylib.h"
+#include "raymath.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+
+using namespace graphics;
+
+/*
+ * graphics_bench - headless, reproducible performance measurements.
+ *
+ * Renders the standard scenes at several resolutions and thread counts and
+ * reports min / median / p99 frame times and Mrays/s (Mpixels/s when the
+ * library is built without statistics, which count the rays), followed by
+ * microbenchmarks of the innermost operations. Run with --help for options.
+ */
+
+namespace {
+
+    using Clock = std::chrono::steady_clock;
+
+    struct Resolution {
+        int width;
+        int height;
+    };
+
+    struct SceneCase {
+        const char* name;
+        std::function<Scene()> build;
+        std::vector<Resolution> resolutions; // used when none is given on the command line
+    };
+
+    struct Options {
+        std::string scene = "all";
+        std::vector<Resolution> resolutions;
+        std::vector<int> threads;
+        int frames = 10;
+        double max_seconds = 2.0;     // per case, once 3 frames were measured
+        double budget = 4e9;          // max pixels * spheres per frame before a case is skipped
+        bool aa = false;
+        bool shadow_cache = true;
+        bool wavefront = false;
+        bool sort_rays = false;
+        bool path_tracer = false;     // time one path traced sample per pixel instead of Render
+        bool denoise = false;         // denoise every path traced pass
+        bool scenes = true;
+        bool micro = true;
+        std::string trace;            // Chrome trace output, needs GRAPHICS_ENABLE_PROFILER
+    };
+
+    std::vector<SceneCase> StandardScenes() {
+        const std::vector<Resolution> light{{320, 240}, {640, 480}, {1280, 720}};
+        return {
+            {"book", [] { return scenes::BookScene(); }, light},
+            {"textured", [] { return scenes::TexturedScene(); }, light},
+            {"book_32_lights", [] { return scenes::ManyLightsScene(32); }, light},
+            {"random_1k", [] { return scenes::RandomSpheres(1000); }, light},
+            {"random_100k", [] { return scenes::RandomSpheres(100000); }, {{80, 60}, {160, 120}}},
+            {"random_1m", [] { return scenes::RandomSpheres(1000000); }, {{40, 30}, {80, 60}}},
+            {"grid_64x48", [] { return scenes::SphereGrid(64, 48); }, {{320, 240}, {640, 480}}},
+            {"grid_256x192", [] { return scenes::SphereGrid(256, 192); }, {{80, 60}, {160, 120}}},
+        };
+    }
+
+    double Percentile(std::vector<double> values, double p) {
+        std::sort(values.begin(), values.end());
+        // nearest rank
+        const auto rank = static_cast<size_t>(p / 100.0 * static_cast<double>(values.size()) + 0.5);
+        return values[std::clamp<size_t>(rank, 1, values.size()) - 1];
+    }
+
+    void RunScene(const SceneCase& scene_case, const Options& options) {
+        const Scene scene = scene_case.build();
+        const std::vector<Resolution>& resolutions = options.resolutions.empty() ? scene_case.resolutions : options.resolutions;
+
+        for (const Resolution& resolution : resolutions) {
+            const double work = static_cast<double>(resolution.width) * resolution.height * static_cast<double>(scene.spheres.size());
+            if (work > options.budget) {
+                std::printf("%-14s %5dx%-5d %8s  skipped (%.2g tests/frame over budget)\n",
+                            scene_case.name, resolution.width, resolution.height, "-", work);
+                continue;
+            }
+
+            Canvas canvas(resolution.width, resolution.height, "graphics_bench", true);
+            canvas.SetViewPort(static_cast<float>(resolution.width) / static_cast<float>(resolution.height), 1.0f, 1.0f);
+            canvas.Clear(WHITE);
+
+            Raytracer raytracer(canvas);
+            raytracer.SetScene(scene);
+            raytracer.SetAntiAliasing(options.aa ? AntiAliasing::Adaptive : AntiAliasing::None);
+            raytracer.SetShadowCache(options.shadow_cache);
+            raytracer.SetRenderMode(options.wavefront ? RenderMode::Wavefront : RenderMode::PerPixel);
+            raytracer.SetRaySorting(options.sort_rays);
+            PathTracer path_tracer(canvas, raytracer);
+            path_tracer.SetDenoising(options.denoise);
+            auto render = [&] {
+                if (options.path_tracer)
+                    path_tracer.RenderPass({0, 0, 0});
+                else
+                    raytracer.Render({0, 0, 0});
+            };
+
+            for (int threads : options.threads) {
+                raytracer.SetThreadCount(threads);
+
+                // warm up caches and the page tables of the frame buffers
+                render();
+
+                std::vector<double> times;
+                // without the counters only the pixels are known, not the rays cast for them
+                uint64_t work = 0;
+                const auto start = Clock::now();
+                for (int frame = 0; frame < options.frames; frame++) {
+                    const auto frame_start = Clock::now();
+                    render();
+                    times.push_back(std::chrono::duration<double, std::milli>(Clock::now() - frame_start).count());
+
+                    work = stats::Enabled() ? stats::LastFrame().Rays()
+                                             : static_cast<uint64_t>(resolution.width) * resolution.height;
+
+                    const double elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+                    if (frame >= 2 && elapsed > options.max_seconds)
+                        break;
+                }
+
+                const double median = Percentile(times, 50);
+                std::printf("%-14s %5dx%-5d %8d  min %9.3f ms  median %9.3f ms  p99 %9.3f ms  %9.4f %s  (%zu frames)\n",
+                            scene_case.name, resolution.width, resolution.height, threads,
+                            Percentile(times, 0), median, Percentile(times, 99),
+                            static_cast<double>(work) / (median * 1e-3) * 1e-6,
+                            stats::Enabled() ? "Mrays/s" : "Mpixels/s", times.size());
+
+                // what sorting cost against the secondary ray work it is meant to speed up
+                if (options.wavefront) {
+                    const auto& report = raytracer.GetRaySortReport();
+                    std::printf("%-14s %11s %8s  secondary rays %9.3f ms  sort %9.3f ms  (%llu rays sorted)\n",
+                                "", "", "", report.trace_seconds * 1e3, report.sort_seconds * 1e3,
+                                static_cast<unsigned long long>(report.sorted_rays));
+                }
+            }
+        }
+    }
+
+    template <typename Fn>
+    void RunMicro(const char* name, long iterations, Fn&& fn) {
+        fn(iterations / 10); // warm-up
+        const auto start = Clock::now();
+        fn(iterations);
+        const double ns = std::chrono::duration<double, std::nano>(Clock::now() - start).count();
+        std::printf("%-28s %12ld calls  %8.3f ns/call\n", name, iterations, ns / static_cast<double>(iterations));
+    }
+
+    void RunMicrobenchmarks() {
+        std::printf("\n== microbenchmarks ==\n");
+
+        Canvas canvas(640, 480, "graphics_bench", true);
+        canvas.SetViewPort(640.0f / 480.0f, 1.0f, 1.0f);
+        Raytracer raytracer(canvas);
+
+        // a fixed set of directions through the canvas, about half of them hit the sphere
+        constexpr int kDirections = 1024;
+        std::mt19937 generator(7);
+        std::uniform_int_distribution<int> px(-320, 319);
+        std::uniform_int_distribution<int> py(-240, 239);
+        std::vector<Vector3> directions(kDirections);
+        for (auto& direction : directions)
+            direction = canvas.CanvasToViewPort(px(generator), py(generator));
+
+        const Sphere sphere{{0, 0, 3}, 1, WHITE};
+        const Vector3 origin{0, 0, 0};
+
+        volatile float sink = 0.0f;
+        RunMicro("IntersectRaySphere", 50'000'000, [&](long iterations) {
+            float acc = 0.0f;
+            for (long i = 0; i < iterations; i++) {
+                auto [t1, t2] = raytracer.IntersectRaySphere(origin, directions[i & (kDirections - 1)], sphere);
+                acc += std::min(t1, t2) < 1e30f ? t1 : 0.0f;
+            }
+            sink = acc;
+        });
+
+        RunMicro("CanvasToViewPort", 50'000'000, [&](long iterations) {
+            float acc = 0.0f;
+            for (long i = 0; i < iterations; i++) {
+                const Vector3 v = canvas.CanvasToViewPort(static_cast<int>(i & 511) - 256, static_cast<int>((i >> 9) & 511) - 256);
+                acc += v.x + v.y;
+            }
+            sink = acc;
+        });
+
+        const Scene lit = scenes::ManyLightsScene(32);
+        RunMicro("ComputeLighting (32 lights)", 5'000'000, [&](long iterations) {
+            float acc = 0.0f;
+            for (long i = 0; i < iterations; i++) {
+                const Vector3& direction = directions[i & (kDirections - 1)];
+                const Vector3 normal = Vector3Normalize(Vector3Negate(direction));
+                acc += lit.lights.ComputeLighting(direction, normal, normal, 500.0f);
+            }
+            sink = acc;
+        });
+
+        // shadow rays from random points through a 1k sphere cloud, most of them blocked late or never
+        Raytracer cloud(canvas);
+        cloud.SetScene(scenes::RandomSpheres(1000));
+        std::uniform_real_distribution<float> coordinate(-1.0f, 1.0f);
+        std::vector<Vector3> origins(kDirections);
+        for (auto& point : origins)
+            point = {coordinate(generator) * 10.0f, coordinate(generator) * 10.0f, 25.0f + coordinate(generator) * 20.0f};
+
+        RunMicro("Occluded (1k spheres)", 200'000, [&](long iterations) {
+            int blocked = 0;
+            for (long i = 0; i < iterations; i++)
+                blocked += cloud.Occluded(origins[i & (kDirections - 1)], directions[(i * 7) & (kDirections - 1)], 0.001f, 1.0f);
+            sink = static_cast<float>(blocked);
+        });
+
+        RunMicro("scalar any-hit (1k spheres)", 200'000, [&](long iterations) {
+            int blocked = 0;
+            for (long i = 0; i < iterations; i++) {
+                const Vector3& point = origins[i & (kDirections - 1)];
+                const Vector3& direction = directions[(i * 7) & (kDirections - 1)];
+                for (const Sphere& candidate : cloud.GetSpheres()) {
+                    auto [t1, t2] = cloud.IntersectRaySphere(point, direction, candidate);
+                    if ((t1 > 0.001f && t1 < 1.0f) || (t2 > 0.001f && t2 < 1.0f)) {
+                        blocked++;
+                        break;
+                    }
+                }
+            }
+            sink = static_cast<float>(blocked);
+        });
+
+        // wireframe-like segments, short and long, some crossing the border
+        constexpr int kSegments = 4096;
+        std::uniform_int_distribution<int> sx(-64, 703);
+        std::uniform_int_distribution<int> sy(-48, 527);
+        std::vector<LineSegment> segments(kSegments);
+        for (auto& segment : segments)
+            segment = {sx(generator), sy(generator), sx(generator), sy(generator), BLACK};
+
+        RunMicro("DrawLines (per segment)", 200'000, [&](long iterations) {
+            for (long done = 0; done < iterations; done += kSegments)
+                canvas.DrawLines(segments.data(), static_cast<size_t>(std::min<long>(kSegments, iterations - done)));
+        });
+
+        RunMicro("PutPixel line (per segment)", 200'000, [&](long iterations) {
+            for (long i = 0; i < iterations; i++) {
+                const LineSegment& segment = segments[i & (kSegments - 1)];
+                const int steps = std::max(std::abs(segment.x1 - segment.x0), std::abs(segment.y1 - segment.y0));
+                const float inv = steps > 0 ? 1.0f / static_cast<float>(steps) : 0.0f;
+                for (int step = 0; step <= steps; step++) {
+                    const float f = static_cast<float>(step) * inv;
+                    canvas.PutPixel(static_cast<int>(std::lround(segment.x0 + f * (segment.x1 - segment.x0))),
+                                    static_cast<int>(std::lround(segment.y0 + f * (segment.y1 - segment.y0))), segment.color);
+                }
+            }
+        });
+
+        // triangles of about 5 and 50 pixels on a side, anywhere on the canvas
+        Rasterizer rasterizer(canvas);
+        rasterizer.SetThreadCount(1);
+        std::uniform_real_distribution<float> tx(0.0f, 640.0f);
+        std::uniform_real_distribution<float> ty(0.0f, 480.0f);
+        for (const float size : {5.0f, 50.0f}) {
+            std::uniform_real_distribution<float> offset(-size, size);
+            std::vector<ScreenTriangle> triangles(kSegments);
+            for (auto& triangle : triangles) {
+                const float cx = tx(generator);
+                const float cy = ty(generator);
+                for (auto& vertex : triangle.v)
+                    vertex = {cx + offset(generator), cy + offset(generator)};
+                triangle.color = BLACK;
+            }
+            const std::string name = "DrawTriangles (" + std::to_string(static_cast<int>(size)) + " px)";
+            RunMicro(name.c_str(), size < 10.0f ? 2'000'000 : 200'000, [&](long iterations) {
+                for (long done = 0; done < iterations; done += kSegments)
+                    rasterizer.DrawTriangles(triangles.data(), static_cast<size_t>(std::min<long>(kSegments, iterations - done)));
+            });
+
+            // sort-middle with every core, and at least two threads so the binning is measured
+            if (size > 10.0f) {
+                Rasterizer binned(canvas);
+                binned.SetThreadCount(std::max(2, DefaultThreadCount()));
+                const std::string binned_name = "DrawTriangles binned x" + std::to_string(binned.GetThreadCount()) + " (50 px)";
+                RunMicro(binned_name.c_str(), 200'000, [&](long iterations) {
+                    for (long done = 0; done < iterations; done += kSegments)
+                        binned.DrawTriangles(triangles.data(), static_cast<size_t>(std::min<long>(kSegments, iterations - done)));
+                });
+            }
+        }
+
+        // the same, Gouraud shaded with perspective correction
+        {
+            std::uniform_real_distribution<float> offset(-50.0f, 50.0f);
+            std::uniform_real_distribution<float> unit(0.1f, 1.0f);
+            std::vector<ScreenTriangle> triangles(kSegments);
+            for (auto& triangle : triangles) {
+                const float cx = tx(generator);
+                const float cy = ty(generator);
+                for (auto& vertex : triangle.v)
+                    vertex = {cx + offset(generator), cy + offset(generator), 0.0f, unit(generator), unit(generator)};
+                triangle.color = WHITE;
+            }
+            RunMicro("DrawTriangles Gouraud (50 px)", 200'000, [&](long iterations) {
+                for (long done = 0; done < iterations; done += kSegments)
+                    rasterizer.DrawTriangles(triangles.data(), static_cast<size_t>(std::min<long>(kSegments, iterations - done)));
+            });
+        }
+
+        // small camera-space triangles in front of the camera, a few crossing the near plane or off screen
+        {
+            constexpr float kNear = 0.5f;
+            const Matrix projection = ProjectionFromViewPort(canvas, kNear);
+            std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+            std::uniform_real_distribution<float> depth(kNear, 20.0f);
+            ClipVertexBuffer vertices;
+            vertices.Resize(3 * kSegments);
+            std::vector<uint32_t> indices(3 * kSegments);
+            for (int i = 0; i < 3 * kSegments; i += 3) {
+                const Vector3 center{unit(generator) * 8.0f, unit(generator) * 6.0f, depth(generator)};
+                for (int k = i; k < i + 3; k++) {
+                    const Vector3 p = Vector3Add(center, {unit(generator) * 0.3f, unit(generator) * 0.3f, unit(generator) * 0.3f});
+                    vertices.x[k] = projection.m0 * p.x;
+                    vertices.y[k] = projection.m5 * p.y;
+                    vertices.z[k] = p.z + projection.m14;
+                    vertices.w[k] = p.z;
+                    indices[k] = static_cast<uint32_t>(k);
+                }
+            }
+            Clipper clipper(canvas);
+            std::vector<ScreenTriangle> clipped;
+            clipped.reserve(2 * kSegments);
+            RunMicro("Clip", 2'000'000, [&](long iterations) {
+                for (long done = 0; done < iterations; done += kSegments) {
+                    clipped.clear();
+                    clipper.Clip(vertices, indices.data(), static_cast<size_t>(std::min<long>(kSegments, iterations - done)), WHITE, nullptr, clipped);
+                }
+            });
+
+            // objects all around the camera, most of them behind or beside it
+            BoundingSphereBuffer spheres;
+            spheres.Resize(kSegments);
+            for (int i = 0; i < kSegments; i++)
+                spheres.Set(i, {unit(generator) * 20.0f, unit(generator) * 20.0f, unit(generator) * 20.0f}, 1.0f);
+            const Frustum frustum(projection);
+            std::vector<uint32_t> visible;
+            RunMicro("Frustum::Cull (per sphere)", 20'000'000, [&](long iterations) {
+                for (long done = 0; done < iterations; done += kSegments)
+                    frustum.Cull(spheres, visible);
+            });
+
+            // texture reads walking diagonally across a 256x256 texture, at every mip level
+            TextureMap checker = TextureMap::Checkerboard(256, 8, RED, WHITE);
+            for (const auto& [name, filter] : {std::pair{"TextureMap::Sample nearest", TextureFilter::Nearest},
+                                               std::pair{"TextureMap::Sample bilinear", TextureFilter::Bilinear},
+                                               std::pair{"TextureMap::Sample trilinear", TextureFilter::Trilinear}}) {
+                checker.SetFilter(filter);
+                RunMicro(name, 2'000'000, [&](long iterations) {
+                    unsigned acc = 0;
+                    for (long i = 0; i < iterations; i++) {
+                        const auto f = static_cast<float>(i % 4096);
+                        acc += checker.Sample(f * 0.0037f, f * 0.0021f, f * (8.0f / 4096.0f)).g;
+                    }
+                    sink = static_cast<float>(acc);
+                });
+            }
+
+            // a sphere mesh in its generator's strip order, then reordered for the post-transform cache
+            Mesh sphere = Mesh::UvSphere({0.0f, 0.0f, 5.0f}, 2.0f, 64, 32);
+            const auto sphere_triangles = static_cast<long>(sphere.GetTriangleCount());
+            VertexStage stage;
+            ClipVertexBuffer transformed;
+            std::vector<uint32_t> transformed_indices;
+            for (const char* name : {"VertexStage::Process strips (per triangle)", "VertexStage::Process optimized (per triangle)"}) {
+                RunMicro(name, 2'000'000, [&](long iterations) {
+                    for (long done = 0; done < iterations; done += sphere_triangles)
+                        stage.Process(sphere, projection, transformed, transformed_indices);
+                });
+                OptimizeVertexCache(sphere);
+            }
+
+            // the same sphere, every vertex transformed eight at a time with its instance's cached matrix
+            Instance instance(sphere);
+            ViewProjection camera;
+            camera.SetProjection(projection);
+            RunMicro("TransformVertices (per vertex)", 20'000'000, [&](long iterations) {
+                for (long done = 0; done < iterations; done += static_cast<long>(sphere.vertex_count))
+                    TransformVertices(instance, camera, transformed);
+            });
+        }
+        (void)sink;
+    }
+
+    bool ParseResolution(const char* text, Resolution& resolution) {
+        return std::sscanf(text, "%dx%d", &resolution.width, &resolution.height) == 2 &&
+               resolution.width > 0 && resolution.height > 0;
+    }
+
+    void PrintUsage(const std::vector<SceneCase>& cases) {
+        std::printf("usage: graphics_bench [options]\n"
+                    "  --scene NAME        scene to run, or 'all' (default)\n"
+                    "  --resolution WxH    resolution, may be repeated (default: per scene)\n"
+                    "  --threads N         thread count, may be repeated (default: 1 and all cores)\n"
+                    "  --frames N          measured frames per case (default 10)\n"
+                    "  --max-seconds S     stop a case after S seconds once 3 frames were measured\n"
+                    "  --budget N          skip cases above N ray-sphere tests per frame (default 4e9)\n"
+                    "  --aa                enable adaptive anti-aliasing\n"
+                    "  --no-shadow-cache   always query the whole scene for shadow rays\n"
+                    "  --wavefront         render in wavefronts instead of pixel by pixel\n"
+                    "  --sort-rays         sort secondary rays by direction and origin (wavefront only)\n"
+                    "  --path-tracer       time path tracer passes (one sample per pixel) instead\n"
+                    "  --denoise           denoise every path tracer pass (with --path-tracer)\n"
+                    "  --no-micro          skip the microbenchmarks\n"
+                    "  --micro-only        run only the microbenchmarks\n"
+                    "  --trace FILE        write a Chrome trace of the scene runs (profiler builds)\n"
+                    "scenes:");
+        for (const auto& scene_case : cases)
+            std::printf(" %s", scene_case.name);
+        std::printf("\n");
+    }
+}
+
+int main(int argc, char** argv) {
+    if (!simd::CpuSupported()) {
+        std::fprintf(stderr, "%s\n", simd::kCpuUnsupportedMessage);
+        return 1;
+    }
+    const std::vector<SceneCase> cases = StandardScenes();
+    Options options;
+
+    for (int i = 1; i < argc; i++) {
+        const bool has_value = i + 1 < argc;
+        if (!std::strcmp(argv[i], "--scene") && has_value) {
+            options.scene = argv[++i];
+        } else if (!std::strcmp(argv[i], "--resolution") && has_value) {
+            Resolution resolution{};
+            if (!ParseResolution(argv[++i], resolution)) {
+                std::fprintf(stderr, "invalid resolution '%s'\n", argv[i]);
+                return 1;
+            }
+            options.resolutions.push_back(resolution);
+        } else if (!std::strcmp(argv[i], "--threads") && has_value) {
+            options.threads.push_back(std::max(1, std::atoi(argv[++i])));
+        } else if (!std::strcmp(argv[i], "--frames") && has_value) {
+            options.frames = std::max(1, std::atoi(argv[++i]));
+        } else if (!std::strcmp(argv[i], "--max-seconds") && has_value) {
+            options.max_seconds = std::atof(argv[++i]);
+        } else if (!std::strcmp(argv[i], "--budget") && has_value) {
+            options.budget = std::atof(argv[++i]);
+        } else if (!std::strcmp(argv[i], "--aa")) {
+            options.aa = true;
+        } else if (!std::strcmp(argv[i], "--no-shadow-cache")) {
+            options.shadow_cache = false;
+        } else if (!std::strcmp(argv[i], "--wavefront")) {
+            options.wavefront = true;
+        } else if (!std::strcmp(argv[i], "--sort-rays")) {
+            options.sort_rays = true;
+        } else if (!std::strcmp(argv[i], "--path-tracer")) {
+            options.path_tracer = true;
+        } else if (!std::strcmp(argv[i], "--denoise")) {
+            options.denoise = true;
+        } else if (!std::strcmp(argv[i], "--no-micro")) {
+            options.micro = false;
+        } else if (!std::strcmp(argv[i], "--micro-only")) {
+            options.scenes = false;
+        } else if (!std::strcmp(argv[i], "--trace") && has_value) {
+            options.trace = argv[++i];
+        } else {
+            PrintUsage(cases);
+            return std::strcmp(argv[i], "--help") == 0 ? 0 : 1;
+        }
+    }
+
+    if (options.threads.empty()) {
+        options.threads.push_back(1);
+        if (DefaultThreadCount() > 1)
+            options.threads.push_back(DefaultThreadCount());
+    }
+
+    if (options.scenes) {
+        std::printf("== scenes (stats counters %s) ==\n", stats::Enabled() ? "on" : "off");
+        std::printf("%-14s %11s %8s\n", "scene", "resolution", "threads");
+
+        bool found = false;
+        for (const auto& scene_case : cases) {
+            if (options.scene != "all" && options.scene != scene_case.name)
+                continue;
+            found = true;
+            RunScene(scene_case, options);
+        }
+        if (!found) {
+            std::fprintf(stderr, "unknown scene '%s'\n", options.scene.c_str());
+            PrintUsage(cases);
+            return 1;
+        }
+    }
+
+    if (!options.trace.empty()) {
+        if (!profiler::Enabled())
+            std::fprintf(stderr, "--trace ignored: built without GRAPHICS_ENABLE_PROFILER\n");
+        else if (!profiler::WriteChromeTrace(options.trace))
+            std::fprintf(stderr, "could not write trace to '%s'\n", options.trace.c_str());
+    }
+
+    if (options.micro)
+        RunMicrobenchmarks();
+    return 0;
+}
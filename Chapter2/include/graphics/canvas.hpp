@@ -2,8 +2,21 @@
 
 #include "raylib.h"
 
+#include <cstddef>
+#include <vector>
+
 namespace graphics {
 
+    /**
+     * @struct LineSegment
+     * @brief A line between two pixels, in screen coordinates ((0,0) at the top-left).
+     */
+    struct LineSegment {
+        int x0, y0;   ///< First end point
+        int x1, y1;   ///< Second end point
+        Color color;  ///< Color of every pixel of the line
+    };
+
     /**
      * @class Canvas
      * @brief Represents a 2D canvas for computer graphics operations.
@@ -29,9 +42,13 @@ namespace graphics {
         float Distance;
         // Color of the background
         Color background;
+        // no window nor GPU texture, only the pixel buffer (benchmarks, tools)
+        bool headless;
 
-
-        RenderTexture2D renderTexture;
+        // CPU side pixels, row-major with (0,0) at the top-left corner
+        std::vector<Color> framebuffer;
+        // GPU copy of the framebuffer, updated on Present
+        Texture2D texture{};
 
     public:
         /**
@@ -39,13 +56,18 @@ namespace graphics {
          * @param w Canvas width in pixels (Cx in Chapter 2 notation)
          * @param h Canvas height in pixels (Cy in Chapter 2 notation)  
          * @param title Window title for the display
+         * @param headless If true, no window is opened and Present does nothing
          * 
          * Creates a canvas with the specified dimensions. In Chapter 2 theory, the canvas
          * dimensions define the resolution of our raster display. The canvas uses a 
          * coordinate system where (0,0) is at the top-left corner, with X increasing
          * rightward and Y increasing downward (standard screen coordinates).
+         *
+         * Pixels are kept in a CPU framebuffer, so several threads may draw
+         * different pixels at the same time. A headless canvas is used to
+         * render without a display, e.g. for benchmarks.
          */
-        Canvas(int w, int h, const char* title = "Graphics from Scratch");
+        Canvas(int w, int h, const char* title = "Graphics from Scratch", bool headless = false);
         
         /**
          * @brief Destructor for Canvas class.
@@ -78,6 +100,7 @@ namespace graphics {
          * This is the fundamental rasterization operation from Chapter 2 theory.
          * It directly maps a color value to a discrete pixel location in the
          * canvas buffer. Uses standard screen coordinates with (0,0) at top-left.
+         * Writes to different pixels may happen concurrently.
          */
         void PutPixel(int x, int y, const Color& color);
         
@@ -94,6 +117,35 @@ namespace graphics {
          */
         void PutPixelCentered(int x, int y, const Color& color);
 
+        /**
+         * @brief Draws a line between two pixels, both end points included.
+         * @param x0 X coordinate of the first end point (screen space)
+         * @param y0 Y coordinate of the first end point (screen space)
+         * @param x1 X coordinate of the second end point
+         * @param y1 Y coordinate of the second end point
+         * @param color Color of the line
+         *
+         * The DrawLine of Chapter 6: one pixel per step along the longer axis,
+         * the other coordinate interpolated linearly. The end points may lie
+         * outside the canvas; see DrawLines.
+         */
+        void DrawLine(int x0, int y0, int x1, int y1, const Color& color);
+
+        /**
+         * @brief Draws many line segments.
+         * @param segments First segment
+         * @param count Number of segments
+         *
+         * Meant for wireframes with many thousands of segments. Each segment
+         * is clipped to the canvas once, by computing the range of steps whose
+         * pixels fall inside, so the pixel loop has no bounds checks: it steps
+         * the interpolated coordinate with an integer 16.16 fixed-point DDA
+         * and writes straight into the framebuffer. Clipping does not move the
+         * pixels that remain, a line looks the same whether or not it crosses
+         * the border.
+         */
+        void DrawLines(const LineSegment* segments, size_t count);
+
         /**
          * @brief Converts canvas coordinates to viewport coordinates.
          * @param x Canvas X coordinate (pixel space)
@@ -108,6 +160,17 @@ namespace graphics {
          */
         Vector3 CanvasToViewPort(int x, int y);
 
+        /**
+         * @brief Converts sub-pixel canvas coordinates to viewport coordinates.
+         * @param x Canvas X coordinate, may fall between pixel centers
+         * @param y Canvas Y coordinate, may fall between pixel centers
+         * @return Vector3 representing viewport coordinates (Vx, Vy, d)
+         *
+         * Same mapping as the integer version, but lets supersampling place
+         * several rays inside the area covered by a single pixel.
+         */
+        Vector3 CanvasToViewPort(float x, float y);
+
         // Canvas management
         /**
          * @brief Clears the entire canvas to a solid color.
@@ -125,6 +188,7 @@ namespace graphics {
          * Copies the canvas buffer to the actual display device. This implements
          * double buffering - we draw to an off-screen buffer and then present
          * the complete frame all at once to avoid visual artifacts.
+         * Does nothing on a headless canvas.
          */
         void Present();
         
@@ -162,8 +226,32 @@ namespace graphics {
          */
         [[nodiscard]] float GetViewHeight() const { return ViewHeight; }
 
+        /**
+         * @brief Gets the distance from the camera to the viewport.
+         * @return Projection plane distance (d in Chapter 2 notation)
+         */
+        [[nodiscard]] float GetDistance() const { return Distance; }
+
+        /**
+         * @brief Gets the angle between the rays of two neighbouring pixels, near the center.
+         * @return Vw / (Cw * d), in radians: a pixel covers this times the distance
+         */
+        [[nodiscard]] float GetPixelAngle() const { return ViewWidth / (static_cast<float>(CanvasWidth) * Distance); }
+
         [[nodiscard]] Color& GetBackground() { return background; }
 
+        /**
+         * @brief Direct access to the framebuffer pixels.
+         * @return Pointer to width*height colors, row-major, (0,0) at top-left
+         */
+        [[nodiscard]] Color* GetFramebuffer() { return framebuffer.data(); }
+        [[nodiscard]] const Color* GetFramebuffer() const { return framebuffer.data(); }
+
+        /**
+         * @brief Checks whether the canvas was created without a window.
+         */
+        [[nodiscard]] bool IsHeadless() const { return headless; }
+
         // Bounds checking
         /**
          * @brief Checks if coordinates are within canvas bounds (screen coordinates).
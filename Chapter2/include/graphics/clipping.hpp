@@ -0,0 +1,109 @@
+#pragma once
+
+#include "raylib.h"
+#include "canvas.hpp"
+#include "rasterizer.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+namespace graphics {
+
+    /**
+     * @brief Projection of the canvas's viewport as a matrix to homogeneous clip space.
+     * @param canvas Canvas whose viewport (Vw, Vh, d) sets the field of view
+     * @param near Distance of the near plane, > 0
+     *
+     * Camera space is the ray tracer's: x right, y up and z forward (raylib's
+     * own cameras look down -z). A point is mapped to x' = x * 2d / Vw,
+     * y' = y * 2d / Vh, z' = z - near and w' = z, so it is inside the view
+     * frustum when -w' <= x' <= w', -w' <= y' <= w' and 0 <= z'. After the
+     * division by w', z' / w' = 1 - near / z is the rasterizer's depth: 0 on
+     * the near plane and towards 1 at infinity, with no far plane to clip.
+     * The matrix applies to column vectors, as raymath's Vector3Transform does.
+     */
+    Matrix ProjectionFromViewPort(const Canvas& canvas, float near);
+
+    /**
+     * @struct ClipVertexBuffer
+     * @brief Vertices in homogeneous clip space, stored as structure of arrays.
+     *
+     * Each array holds PaddedSize(count) values so every SIMD load is whole.
+     * Resize fills the padding with a point inside the frustum.
+     */
+    struct ClipVertexBuffer {
+        std::vector<float> x, y, z, w;
+        std::vector<float> intensity;  ///< Light intensity, for Gouraud shading
+        std::vector<float> u, v;       ///< Texture coordinates
+        size_t count = 0;
+
+        /**
+         * @brief Sets the number of vertices. Existing values are kept.
+         */
+        void Resize(size_t vertex_count);
+    };
+
+    /**
+     * @class Clipper
+     * @brief Clips indexed triangles to the view frustum and projects them onto a canvas.
+     *
+     * Works in batches. First each vertex gets an outcode, one bit per plane
+     * it is outside of, and its screen position, computed for eight vertices
+     * at a time. Then most triangles are settled by their corners' codes
+     * alone (Cohen-Sutherland):
+     *
+     * - all three corners outside the same plane: rejected;
+     * - no corner outside the near plane or the guard band: projected as is;
+     * - otherwise the triangle is clipped as a polygon, in homogeneous
+     *   coordinates (Sutherland-Hodgman), and the result fanned into triangles.
+     *
+     * The guard band is a region around the canvas as wide as the rasterizer
+     * can handle. A triangle partly off the canvas but within it needs no
+     * clipping, since the rasterizer only visits on-canvas pixels anyway. So
+     * only triangles crossing the near plane or reaching far off screen are
+     * clipped, and a mostly visible scene costs an outcode and a projection
+     * per vertex plus a few bit operations per triangle.
+     *
+     * With back-face culling on, triangles are also tested for facing eight
+     * at a time, before their outcodes. Front faces wind counter-clockwise as
+     * seen from the camera, as in OpenGL.
+     *
+     * Screen positions follow the ray tracer's pixel centers, so rasterized
+     * and raytraced images of a scene line up.
+     */
+    class Clipper {
+        std::reference_wrapper<const Canvas> canvas;
+        std::vector<uint16_t> outcodes;
+        // vertices after the perspective division, per batch
+        std::vector<float> screen_x, screen_y, screen_z, screen_inv_w;
+        bool cull_back_faces = false;
+
+    public:
+        /**
+         * @brief Creates a clipper projecting onto a canvas.
+         */
+        explicit Clipper(const Canvas& canvas);
+
+        /**
+         * @brief Drops triangles that face away from the camera, for closed meshes.
+         */
+        void SetBackFaceCulling(bool enabled) { cull_back_faces = enabled; }
+        [[nodiscard]] bool GetBackFaceCulling() const { return cull_back_faces; }
+
+        /**
+         * @brief Clips triangles and appends what is left of them, in screen coordinates.
+         * @param vertices Clip-space vertices, all of which get an outcode and a projection
+         * @param indices Three vertex indices per triangle
+         * @param triangle_count Number of triangles
+         * @param color Color of every triangle
+         * @param texture Texture of every triangle, or nullptr
+         * @param out Receives the screen triangles, in the order of the input
+         * @return Number of triangles appended to out
+         */
+        size_t Clip(const ClipVertexBuffer& vertices, const uint32_t* indices, size_t triangle_count, Color color,
+                    const TextureMap* texture, std::vector<ScreenTriangle>& out);
+    };
+
+} // namespace graphics
@@ -0,0 +1,90 @@
+#pragma once
+
+#include "raylib.h"
+#include "canvas.hpp"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace graphics {
+
+    /**
+     * @enum CostMetric
+     * @brief What a cost map measures for each pixel.
+     *
+     * - Cycles: CPU timestamp counter ticks spent tracing the pixel's rays.
+     * - IntersectionTests: ray-sphere tests done for the pixel, independent
+     *   of clock speed and of other processes running on the machine.
+     */
+    enum class CostMetric {
+        Cycles,
+        IntersectionTests
+    };
+
+    /**
+     * @class CostMap
+     * @brief Per-pixel rendering cost of a frame, shown as a false-color heatmap.
+     *
+     * Filled by the raytracer while rendering in the cost heatmap output mode.
+     * The raw values can be aggregated in square tiles, to compare tile
+     * scheduling strategies, and exported as CSV for offline analysis.
+     */
+    class CostMap {
+        int width = 0;
+        int height = 0;
+        CostMetric metric = CostMetric::Cycles;
+        std::vector<uint64_t> costs;
+
+    public:
+        /**
+         * @brief Resizes the map and zeroes every pixel.
+         * @param w Width in pixels
+         * @param h Height in pixels
+         * @param m Metric the values will hold
+         */
+        void Reset(int w, int h, CostMetric m);
+
+        /**
+         * @brief Adds cost to a pixel. Different pixels may be updated concurrently.
+         */
+        void Add(int x, int y, uint64_t cost) { costs[static_cast<size_t>(y) * width + x] += cost; }
+
+        [[nodiscard]] uint64_t Get(int x, int y) const { return costs[static_cast<size_t>(y) * width + x]; }
+        [[nodiscard]] int GetWidth() const { return width; }
+        [[nodiscard]] int GetHeight() const { return height; }
+        [[nodiscard]] CostMetric GetMetric() const { return metric; }
+
+        /**
+         * @brief Sums the cost of square tiles.
+         * @param tile_size Side of the tiles in pixels
+         * @return Row-major tile sums, ceil(w / tile_size) per row
+         */
+        [[nodiscard]] std::vector<uint64_t> TileCosts(int tile_size) const;
+
+        /**
+         * @brief Draws the map on a canvas as a false-color heatmap.
+         * @param canvas Target canvas, of the same size as the map
+         * @param tile_size Side of the tiles drawn with a single color, 1 for per-pixel
+         *
+         * Costs are mapped on a logarithmic scale from black (cheapest) through
+         * blue, cyan, green and yellow to red (most expensive), because a few
+         * very expensive pixels would otherwise squash everything else to black.
+         */
+        void Draw(Canvas& canvas, int tile_size = 1) const;
+
+        /**
+         * @brief Writes the raw values as CSV, one line per row of tiles.
+         * @param path Output file
+         * @param tile_size Side of the aggregated tiles, 1 for per-pixel values
+         * @return true if the file was written
+         */
+        bool ExportCsv(const std::string& path, int tile_size = 1) const;
+    };
+
+    /**
+     * @brief Maps a value in [0, 1] to the heatmap color ramp.
+     */
+    Color HeatmapColor(float value);
+
+} // namespace graphics
@@ -0,0 +1,83 @@
+#pragma once
+
+#include "raylib.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace graphics {
+
+    /**
+     * @struct BoundingSphereBuffer
+     * @brief Bounding spheres of many objects, stored as structure of arrays.
+     *
+     * Each array holds PaddedSize(count) values so every SIMD load is whole.
+     */
+    struct BoundingSphereBuffer {
+        std::vector<float> x, y, z;
+        std::vector<float> radius;
+        size_t count = 0;
+
+        /**
+         * @brief Sets the number of spheres. Existing values are kept.
+         */
+        void Resize(size_t sphere_count);
+
+        /**
+         * @brief Sets one sphere.
+         */
+        void Set(size_t index, Vector3 center, float sphere_radius) {
+            x[index] = center.x;
+            y[index] = center.y;
+            z[index] = center.z;
+            radius[index] = sphere_radius;
+        }
+    };
+
+    /**
+     * @class Frustum
+     * @brief The planes bounding what a camera sees, for culling whole objects.
+     *
+     * Built from the matrix taking a space (world, usually) to the clip space
+     * of ProjectionFromViewPort: each clip condition, such as x' + w' >= 0,
+     * is a plane in the original space whose coefficients are sums of the
+     * matrix's rows (Gribb and Hartmann, "Fast Extraction of Viewing Frustum
+     * Planes from the World-View-Projection Matrix"). The four sides and the
+     * near plane are kept; the projection has no far plane.
+     *
+     * An object whose bounding sphere is entirely outside one plane cannot
+     * show, so none of its vertices need to be transformed. Spheres crossing
+     * a corner of the frustum are sometimes kept although outside, which is
+     * only a missed saving.
+     */
+    class Frustum {
+    public:
+        static constexpr int kPlaneCount = 5;
+
+    private:
+        // plane i is a * x + b * y + c * z + d >= 0 inside, with (a, b, c) unit length
+        float a[kPlaneCount]{}, b[kPlaneCount]{}, c[kPlaneCount]{}, d[kPlaneCount]{};
+
+    public:
+        /**
+         * @brief Extracts the frustum from a matrix to clip space.
+         * @param to_clip Matrix applied to column vectors, as raymath's Vector3Transform does
+         */
+        explicit Frustum(const Matrix& to_clip);
+
+        /**
+         * @brief Checks whether a sphere may be visible.
+         */
+        [[nodiscard]] bool Intersects(Vector3 center, float radius) const;
+
+        /**
+         * @brief Culls many spheres, eight at a time.
+         * @param spheres Spheres to test
+         * @param visible Receives the indices of the spheres that may be visible, in order
+         * @return Number of visible spheres
+         */
+        size_t Cull(const BoundingSphereBuffer& spheres, std::vector<uint32_t>& visible) const;
+    };
+
+} // namespace graphics
@@ -0,0 +1,103 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+namespace graphics {
+
+    /**
+     * @struct DenoiserConfig
+     * @brief Tuning knobs of the denoiser's edge-stopping weights.
+     *
+     * Each sigma is the difference at which a neighbour's weight falls to
+     * exp(-1) of the kernel's; smaller values keep sharper edges but remove
+     * less noise.
+     */
+    struct DenoiserConfig {
+        int iterations = 5;          ///< A-trous passes, the filter reaches 2^(iterations + 1) - 2 pixels away
+        float sigma_color = 2.0f;    ///< Color difference at one sample per pixel, halved at every pass
+        float sigma_normal = 0.3f;   ///< Distance between unit normals
+        float sigma_depth = 0.05f;   ///< Depth difference relative to the pixel's depth
+        float sigma_albedo = 0.1f;   ///< Albedo difference per channel
+    };
+
+    /**
+     * @struct DenoiserInput
+     * @brief One noisy image and the guides that tell the denoiser where edges are.
+     *
+     * All the planes are row-major, width * height floats. The guides come from
+     * the first surface seen through each pixel and are much less noisy than
+     * the color: a sphere's normal, its distance and its albedo do not depend
+     * on where the light paths went next.
+     */
+    struct DenoiserInput {
+        int width = 0;
+        int height = 0;
+        const float* color[3]{};   ///< Linear RGB
+        const float* normal[3]{};  ///< Unit normal, zero where nothing was hit
+        const float* depth{};      ///< Distance to the first hit
+        const float* albedo[3]{};  ///< Surface color in [0, 1]
+        float noise = 1.0f;        ///< Noise level relative to one sample per pixel, scales sigma_color
+    };
+
+    /**
+     * @class Denoiser
+     * @brief Edge-avoiding a-trous wavelet filter for low sample count renders.
+     *
+     * Implements Dammertz et al., "Edge-Avoiding A-Trous Wavelet Transform for
+     * fast Global Illumination Filtering". Each pass blurs with a 5x5 B3-spline
+     * kernel whose taps are 2^pass pixels apart, so five passes cover a
+     * 125 pixel wide footprint with only 125 taps per pixel. Every tap is
+     * weighted down by how different its color, normal, depth and albedo are
+     * from the center pixel's, so the blur stays inside surfaces.
+     *
+     * The color is divided by the albedo before filtering and multiplied back
+     * after, so the filter smooths the lighting without blurring the surface
+     * colors. Rows of eight pixels go through the SIMD lanes, with the images
+     * padded so taps past the border read zero-weight pixels, and rows are
+     * shared among threads.
+     */
+    class Denoiser {
+        DenoiserConfig config{};
+
+        int width = 0;
+        int height = 0;
+        int margin = 0;   // padding around the image, the reach of the last pass
+        int stride = 0;   // floats per padded row
+
+        // padded planes; valid is 1 inside the image and 0 in the padding
+        std::vector<float> irradiance[2][3];
+        std::vector<float> normal[3];
+        std::vector<float> depth;
+        std::vector<float> albedo[3];
+        std::vector<float> valid;
+
+        void Resize(int w, int h);
+
+        [[nodiscard]] size_t Index(int x, int y) const {
+            return static_cast<size_t>(y + margin) * stride + x + margin;
+        }
+
+        /**
+         * @brief Runs one a-trous pass over a row of the image.
+         * @param source Index of the irradiance planes read
+         * @param step Distance between the kernel taps
+         * @param sigma_color Color sigma of this pass
+         * @param y Row filtered
+         */
+        void FilterRow(int source, int step, float sigma_color, int y);
+
+    public:
+        void SetConfig(const DenoiserConfig& denoiser_config) { config = denoiser_config; }
+        [[nodiscard]] const DenoiserConfig& GetConfig() const { return config; }
+
+        /**
+         * @brief Filters a noisy image.
+         * @param input Color and guide planes
+         * @param output Filtered linear RGB planes, width * height floats each
+         * @param threads Number of threads sharing the rows
+         */
+        void Denoise(const DenoiserInput& input, float* const (&output)[3], int threads);
+    };
+
+} // namespace graphics
@@ -0,0 +1,103 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+namespace graphics {
+
+    /**
+     * @class DepthBuffer
+     * @brief Per-pixel depths for hidden-surface removal, with per-tile bounds.
+     *
+     * Holds one float per canvas pixel, 0 at the near plane and kFar at the
+     * far one; a pixel is drawn only if it is nearer than what the buffer
+     * holds. On top of the pixels, every 8x8 tile keeps a lower and an upper
+     * bound of the depths stored in it, a one-level hierarchical Z buffer
+     * (Greene et al., "Hierarchical Z-Buffer Visibility"):
+     *
+     * - a triangle, or the part of it over a tile, that is no nearer than
+     *   the tile's upper bound is hidden and skipped before any per-pixel work;
+     * - one entirely nearer than the tile's lower bound passes without reading
+     *   the stored depths.
+     *
+     * Rows are padded to whole tiles, so a tile row is always one full SIMD
+     * vector; padding pixels are left out of the bounds.
+     */
+    class DepthBuffer {
+        int width = 0;
+        int height = 0;
+        int stride = 0;   // floats per row, a whole number of tiles
+        int tiles_x = 0;
+        int tiles_y = 0;
+
+        std::vector<float> depth;
+        std::vector<float> tile_min;
+        std::vector<float> tile_max;
+
+    public:
+        /// Side of the tiles, the same as the rasterizer's
+        static constexpr int kTileSize = 8;
+        /// Depth of an empty pixel, nothing at or beyond it is drawn
+        static constexpr float kFar = 1.0f;
+
+        /**
+         * @brief Resizes the buffer to a canvas and clears it.
+         */
+        void Resize(int w, int h);
+
+        /**
+         * @brief Resets every pixel and tile to kFar.
+         */
+        void Clear();
+
+        [[nodiscard]] int GetWidth() const { return width; }
+        [[nodiscard]] int GetHeight() const { return height; }
+
+        /**
+         * @brief First depth of a pixel row, valid up to a whole number of tiles.
+         */
+        [[nodiscard]] float* Row(int y) { return depth.data() + static_cast<size_t>(y) * stride; }
+        [[nodiscard]] const float* Row(int y) const { return depth.data() + static_cast<size_t>(y) * stride; }
+
+        /**
+         * @brief Depth stored for a pixel.
+         */
+        [[nodiscard]] float Get(int x, int y) const { return Row(y)[x]; }
+
+        /**
+         * @brief Lower bound of the depths in a tile (tile coordinates).
+         */
+        [[nodiscard]] float TileMin(int tx, int ty) const { return tile_min[static_cast<size_t>(ty) * tiles_x + tx]; }
+
+        /**
+         * @brief Upper bound of the depths in a tile (tile coordinates).
+         */
+        [[nodiscard]] float TileMax(int tx, int ty) const { return tile_max[static_cast<size_t>(ty) * tiles_x + tx]; }
+
+        /**
+         * @brief Sets the bounds of a tile, e.g. when one triangle overwrote all of it.
+         */
+        void SetTileBounds(int tx, int ty, float min_depth, float max_depth) {
+            const size_t tile = static_cast<size_t>(ty) * tiles_x + tx;
+            tile_min[tile] = min_depth;
+            tile_max[tile] = max_depth;
+        }
+
+        /**
+         * @brief Recomputes the bounds of a tile from its pixels.
+         */
+        void UpdateTile(int tx, int ty);
+
+        /**
+         * @brief Checks whether a depth is hidden everywhere in a rectangle of pixels.
+         * @param x0 First column
+         * @param y0 First row
+         * @param x1 Last column, included
+         * @param y1 Last row, included
+         * @param depth Nearest depth of what would be drawn there
+         * @return true if every tile the rectangle touches already holds nearer depths only
+         */
+        [[nodiscard]] bool Occluded(int x0, int y0, int x1, int y1, float depth) const;
+    };
+
+} // namespace graphics
@@ -0,0 +1,131 @@
+#pragma once
+
+#include "raylib.h"
+
+#include <cstddef>
+#include <limits>
+#include <vector>
+
+namespace graphics {
+
+    /**
+     * @enum LightType
+     * @brief The three kinds of light sources from Chapter 3.
+     *
+     * - Ambient: light reaching every point from every direction.
+     * - Point: light emitted from a position in all directions.
+     * - Directional: light coming from infinitely far away along a direction.
+     */
+    enum class LightType {
+        Ambient,
+        Point,
+        Directional
+    };
+
+    /**
+     * @struct Light
+     * @brief A single light source, as used to build a LightList.
+     */
+    struct Light {
+        LightType type;
+        float intensity;    ///< Fraction of the light's color it contributes, all lights usually add up to 1
+        Vector3 vector;     ///< Position of a point light, direction towards a directional light
+    };
+
+    /**
+     * @class LightList
+     * @brief Light sources stored as a structure of arrays.
+     *
+     * All ambient lights collapse into a single intensity. Point and
+     * directional lights share the same arrays using homogeneous coordinates:
+     * w = 1 stores a point light's position and w = 0 a directional light's
+     * direction, so the vector from a point P towards any light is simply
+     * (x, y, z) - w * P. With no branch on the light type, ComputeLighting
+     * evaluates eight lights per iteration with SIMD. The arrays are padded
+     * to a multiple of eight with zero-intensity lights.
+     */
+    class LightList {
+        float ambient = 0.0f;
+        std::size_t count = 0;
+        std::vector<float> x, y, z, w, intensity;
+
+    public:
+        /**
+         * @brief Adds a light of any type.
+         */
+        void Add(const Light& light);
+
+        void AddAmbient(float light_intensity) { Add({LightType::Ambient, light_intensity, {0, 0, 0}}); }
+        void AddPoint(float light_intensity, const Vector3& position) { Add({LightType::Point, light_intensity, position}); }
+        void AddDirectional(float light_intensity, const Vector3& direction) { Add({LightType::Directional, light_intensity, direction}); }
+
+        /**
+         * @brief Removes every light.
+         */
+        void Clear();
+
+        /**
+         * @brief Whether the list has no light at all, ambient included.
+         */
+        [[nodiscard]] bool Empty() const { return count == 0 && ambient == 0.0f; }
+
+        /**
+         * @brief Number of point and directional lights.
+         */
+        [[nodiscard]] std::size_t Size() const { return count; }
+
+        /**
+         * @brief Sum of the ambient lights.
+         */
+        [[nodiscard]] float Ambient() const { return ambient; }
+
+        /**
+         * @brief Gets a point or directional light back in AoS form.
+         * @param index Light index in [0, Size())
+         */
+        [[nodiscard]] Light Get(std::size_t index) const;
+
+        /**
+         * @brief Vector from a point towards a point or directional light.
+         * @param index Light index in [0, Size())
+         * @param point Point being lit
+         * @return L = light - w * P, not normalized: a point light is at P + 1 * L
+         */
+        [[nodiscard]] Vector3 VectorFrom(std::size_t index, const Vector3& point) const {
+            return {x[index] - w[index] * point.x, y[index] - w[index] * point.y, z[index] - w[index] * point.z};
+        }
+
+        /**
+         * @brief Farthest ray parameter at which a blocker can shadow the light.
+         * @param index Light index in [0, Size())
+         * @return 1 for a point light (the light itself along VectorFrom), infinity for a directional one
+         */
+        [[nodiscard]] float ShadowDistance(std::size_t index) const {
+            return w[index] != 0.0f ? 1.0f : std::numeric_limits<float>::infinity();
+        }
+
+        /**
+         * @brief Diffuse plus specular intensity of each light at a point.
+         * @param point Point being lit (P)
+         * @param normal Unit surface normal at P (N)
+         * @param view Vector from P towards the viewer (V)
+         * @param specular Specular exponent of the surface, -1 for a matte one
+         * @param terms Output, one intensity per light, at least simd::PaddedSize(Size()) floats
+         *
+         * Implements the diffuse reflection I * <N, L> / (|N| |L|) and the specular
+         * reflection I * (<R, V> / (|R| |V|))^s of Chapter 3, for all lights at once.
+         * Occlusion is not considered: the caller can weight each term by the
+         * light's visibility.
+         */
+        void ComputeTerms(const Vector3& point, const Vector3& normal, const Vector3& view, float specular, float* terms) const;
+
+        /**
+         * @brief Total light intensity at a point, ambient included.
+         *
+         * Same parameters as ComputeTerms, returns the ambient intensity plus
+         * the sum of all the light terms.
+         */
+        [[nodiscard]] float ComputeLighting(const Vector3& point, const Vector3& normal, const Vector3& view, float specular) const;
+    };
+
+} // namespace graphics
@@ -0,0 +1,141 @@
+#pragma once
+
+#include "raylib.h"
+#include "clipping.hpp"
+#include "lights.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace graphics {
+
+    /**
+     * @struct Mesh
+     * @brief An indexed triangle mesh, its vertices stored as structure of arrays.
+     *
+     * Each vertex array holds PaddedSize(vertex_count) values so every SIMD
+     * load is whole. Triangles are three consecutive entries of indices, and
+     * wind counter-clockwise seen from outside, as the Clipper's back-face
+     * culling expects.
+     */
+    struct Mesh {
+        std::vector<float> x, y, z;     ///< Positions
+        std::vector<float> nx, ny, nz;  ///< Unit normals
+        std::vector<float> u, v;        ///< Texture coordinates
+        std::vector<uint32_t> indices;
+        size_t vertex_count = 0;
+
+        /**
+         * @brief Sets the number of vertices. Existing values are kept.
+         */
+        void Resize(size_t count);
+
+        /**
+         * @brief Sets one vertex.
+         */
+        void SetVertex(size_t index, Vector3 position, Vector3 normal, float tex_u, float tex_v) {
+            x[index] = position.x;
+            y[index] = position.y;
+            z[index] = position.z;
+            nx[index] = normal.x;
+            ny[index] = normal.y;
+            nz[index] = normal.z;
+            u[index] = tex_u;
+            v[index] = tex_v;
+        }
+
+        [[nodiscard]] size_t GetTriangleCount() const { return indices.size() / 3; }
+
+        /**
+         * @brief A sphere made of stacks of quads, each split into two triangles.
+         * @param center Center of the sphere
+         * @param radius Radius of the sphere
+         * @param slices Quads around the vertical axis, >= 3
+         * @param stacks Quads from pole to pole, >= 2
+         *
+         * Texture coordinates follow the ray tracer's spheres (SurfaceColor),
+         * so a texture wraps the same way around both.
+         */
+        static Mesh UvSphere(Vector3 center, float radius, int slices, int stacks);
+    };
+
+    /**
+     * @brief Reorders a mesh's triangles and vertices for the post-transform cache.
+     * @param mesh Mesh to reorder; it draws the same triangles afterwards
+     *
+     * Triangles are reordered with Forsyth's "Linear-Speed Vertex Cache
+     * Optimisation": each vertex is scored by how recently it entered the
+     * cache and how few of its triangles are left, and the next triangle is
+     * the best scored one among those of the cached vertices. Mesh
+     * generators and modelling tools tend to emit long strips, whose shared
+     * vertices have left a small cache by the time the next strip needs
+     * them; the reordered triangles reuse them while they are still there.
+     *
+     * Vertices are then renumbered in the order the new index list first
+     * uses them, so the vertex stage reads the vertex arrays front to back
+     * rather than jumping around them.
+     */
+    void OptimizeVertexCache(Mesh& mesh);
+
+    /**
+     * @brief Average cache miss ratio (ACMR) of an index list: vertices transformed per triangle.
+     * @param indices Three vertex indices per triangle
+     * @param triangle_count Number of triangles
+     *
+     * Simulates the post-transform cache of VertexStage. The ratio is 3 with
+     * no reuse at all, and approaches 0.5 for a large regular grid that
+     * transforms every vertex only once.
+     */
+    float AverageCacheMissRatio(const uint32_t* indices, size_t triangle_count);
+
+    /**
+     * @class VertexStage
+     * @brief Transforms the vertices of a mesh into clip space, once per cache miss.
+     *
+     * Walks a mesh's index list in order and keeps the last kCacheSize
+     * vertices it transformed in a FIFO post-transform cache, as GPUs do.
+     * A vertex found there reuses its transformed copy; any other one is
+     * transformed, lit, and appended to the output. The output is a compact
+     * ClipVertexBuffer with an index list of its own, ready for the Clipper.
+     *
+     * Only vertices the triangles use are transformed, and with indices
+     * reordered by OptimizeVertexCache most shared vertices are transformed
+     * once: about 0.7 transforms per triangle for a closed mesh, against 3
+     * if every triangle had its own corners.
+     */
+    class VertexStage {
+    public:
+        /// Number of transformed vertices the cache holds
+        static constexpr int kCacheSize = 32;
+
+    private:
+        const LightList* lights = nullptr;
+        Vector3 camera{0.0f, 0.0f, 0.0f};
+
+    public:
+        /**
+         * @brief Sets the lights for Gouraud shading.
+         * @param light_list Lights, or nullptr for an intensity of 1 everywhere; must outlive the stage's use
+         * @param camera_position Viewer's position, for the specular terms
+         *
+         * Mesh positions and normals are taken to be in the lights' space.
+         */
+        void SetLighting(const LightList* light_list, Vector3 camera_position) {
+            lights = light_list;
+            camera = camera_position;
+        }
+
+        /**
+         * @brief Transforms the vertices of a mesh's triangles.
+         * @param mesh Mesh to transform
+         * @param to_clip Matrix from the mesh's space to clip space, applied to column vectors
+         * @param out Receives the transformed vertices
+         * @param out_indices Receives three indices into out per triangle
+         * @return Number of vertices transformed
+         */
+        size_t Process(const Mesh& mesh, const Matrix& to_clip, ClipVertexBuffer& out,
+                       std::vector<uint32_t>& out_indices) const;
+    };
+
+} // namespace graphics
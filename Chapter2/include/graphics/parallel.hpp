@@ -0,0 +1,66 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <functional>
+#include <thread>
+
+namespace graphics {
+
+    /**
+     * @brief Number of worker threads used when none is configured.
+     * @return Hardware concurrency, at least 1
+     */
+    inline int DefaultThreadCount() {
+        return std::max(1u, std::thread::hardware_concurrency());
+    }
+
+    namespace detail {
+        /**
+         * @brief Runs job on the calling thread and on helper threads of the worker pool.
+         * @param helpers Number of pool threads to run it on as well
+         * @param job Work loop, returns once there is nothing left to take
+         *
+         * Returns once every copy of job has returned. The pool threads are
+         * started the first time they are needed and then kept, blocked
+         * between calls, until the program exits. Calls from several threads
+         * take turns; a call made from inside a job runs it on the calling
+         * thread only.
+         */
+        void RunOnWorkers(int helpers, const std::function<void()>& job);
+    }
+
+    /**
+     * @brief Runs fn(i) for every i in [0, count) on several threads.
+     * @param count Number of work items (rows, tiles...)
+     * @param threads Number of threads to use, the caller is one of them
+     * @param fn Callable taking the item index
+     *
+     * Items are handed out dynamically through an atomic counter, so rows or
+     * tiles of very different cost still keep every thread busy. Returns once
+     * all the items are done.
+     *
+     * The other threads come from a pool that lives as long as the program,
+     * so a call costs a wake-up rather than a thread creation, and
+     * thread_local state (row buffers, shadow caches, statistics) stays with
+     * the same threads from one call, and one frame, to the next.
+     */
+    template <typename Fn>
+    void ParallelFor(int count, int threads, Fn&& fn) {
+        threads = std::max(1, std::min(threads, count));
+        if (threads == 1) {
+            for (int i = 0; i < count; i++)
+                fn(i);
+            return;
+        }
+
+        std::atomic<int> next{0};
+        const std::function<void()> worker = [&]() {
+            for (int i = next.fetch_add(1, std::memory_order_relaxed); i < count;
+                 i = next.fetch_add(1, std::memory_order_relaxed))
+                fn(i);
+        };
+        detail::RunOnWorkers(threads - 1, worker);
+    }
+
+} // namespace graphics
@@ -0,0 +1,162 @@
+#pragma once
+
+#include "raylib.h"
+#include "canvas.hpp"
+#include "denoiser.hpp"
+#include "raytracing.hpp"
+
+#include <atomic>
+#include <cstdint>
+#include <vector>
+
+namespace graphics {
+
+    /**
+     * @struct PathTracerConfig
+     * @brief Tuning knobs of the path tracer.
+     */
+    struct PathTracerConfig {
+        int max_bounces = 8;         ///< Hard limit on the segments of a path after the camera ray
+        int roulette_depth = 2;      ///< Bounces after which Russian roulette may end a path
+        float max_survival = 0.95f;  ///< Upper bound of the roulette survival probability
+    };
+
+    /**
+     * @struct SurfaceFeatures
+     * @brief What the camera ray of a path hit first, used to guide the denoiser.
+     */
+    struct SurfaceFeatures {
+        Vector3 normal{0, 0, 0};   ///< Unit normal, zero if the ray escaped
+        float depth = 0.0f;        ///< Ray parameter of the hit
+        float albedo[3]{};         ///< Surface (or background) color in [0, 1]
+    };
+
+    /**
+     * @class PathTracer
+     * @brief Progressive Monte Carlo path tracer on top of the Raytracer's scene.
+     *
+     * The book's raytracer computes direct light only, with a constant
+     * ambient term standing in for all the light bouncing between objects.
+     * A path tracer estimates that indirect light instead: at each diffuse
+     * hit the path continues in a random direction, drawn with a cosine
+     * weighted density so the Lambertian term cancels out, and the lights
+     * are sampled explicitly (next event estimation) since point and
+     * directional lights cannot be hit by chance. Reflective spheres mirror
+     * the path with probability equal to their reflectivity. Rays escaping
+     * the scene see a uniform sky of the ambient intensity, so the book's
+     * ambient light becomes real, occluded, sky light. Specular exponents are
+     * ignored: the surfaces are Lambertian or mirrors.
+     *
+     * Paths end after max_bounces, or earlier by Russian roulette: past
+     * roulette_depth a path survives with a probability that follows its
+     * throughput, and survivors are weighted up to keep the estimate unbiased.
+     *
+     * Each RenderPass adds one sample to every pixel and shows the running
+     * average, which converges as passes accumulate. Pixels keep their own
+     * sample count, so a pass can be cut short by Interrupt() or a time
+     * budget and the canvas still holds a valid, if noisier, image.
+     *
+     * Random numbers come from graphics::sampling: scrambled Sobol points for
+     * the pixel position and the bounce directions, a PCG generator for the
+     * mirror and roulette decisions, all seeded by pixel and sample number.
+     * The image is the same whatever the thread count or scheduling.
+     *
+     * With denoising enabled, the running average goes through the Denoiser
+     * before being drawn, guided by the average normal, depth and albedo of
+     * the first surface seen through each pixel.
+     */
+    class PathTracer {
+        std::reference_wrapper<Canvas> canvas;
+        std::reference_wrapper<Raytracer> raytracer;
+        PathTracerConfig config{};
+
+        int width = 0;
+        int height = 0;
+        // sum of the samples of each pixel, linear RGB with 1 the color of a white surface under intensity 1
+        std::vector<float> sum_r, sum_g, sum_b;
+        std::vector<uint32_t> samples;
+        // sums of the first hit features, the denoiser's guides
+        std::vector<float> sum_normal[3], sum_depth, sum_albedo[3];
+        uint32_t pass = 0;
+
+        bool denoise = false;
+        Denoiser denoiser;
+        // per-pixel averages handed to the denoiser, and its output
+        std::vector<float> mean_color[3], mean_normal[3], mean_depth, mean_albedo[3], filtered[3];
+        std::atomic<bool> interrupted{false};
+
+        /**
+         * @brief Follows one path from the camera.
+         * @param origin Camera position
+         * @param direction Camera ray direction
+         * @param pixel Index of the pixel, with sample selects the path's random numbers
+         * @param sample Sample number of the pixel
+         * @param rgb Output radiance carried back along the path
+         * @param features Output description of the first surface hit
+         */
+        void TracePath(const Vector3& origin, const Vector3& direction, uint32_t pixel, uint32_t sample, float (&rgb)[3], SurfaceFeatures& features) const;
+
+        /**
+         * @brief Denoises the running averages and draws the result.
+         */
+        void DrawDenoised();
+
+    public:
+        /**
+         * @brief Creates a path tracer drawing into a canvas.
+         * @param canvas Canvas the running average is drawn on
+         * @param raytracer Provides the scene, the intersection queries and the thread count
+         */
+        PathTracer(Canvas& canvas, Raytracer& raytracer);
+
+        void SetConfig(const PathTracerConfig& path_config) { config = path_config; Reset(); }
+        [[nodiscard]] const PathTracerConfig& GetConfig() const { return config; }
+
+        /**
+         * @brief Filters the image with the Denoiser before drawing it.
+         * @param enabled true to denoise every pass
+         * @param config Filter tuning
+         */
+        void SetDenoising(bool enabled, const DenoiserConfig& config = {}) {
+            denoise = enabled;
+            denoiser.SetConfig(config);
+        }
+
+        /**
+         * @brief Drops all the accumulated samples, e.g. after the scene or camera changed.
+         */
+        void Reset();
+
+        /**
+         * @brief Adds up to one sample per pixel and draws the running average.
+         * @param origin Camera position
+         * @param max_seconds Stop starting new rows after this long, 0 for no limit
+         * @return true if every pixel received its sample
+         *
+         * Rows are shared among the raytracer's threads. Each pass starts at a
+         * different row, so interrupted passes do not always favour the top of
+         * the image.
+         */
+        bool RenderPass(const Vector3& origin, double max_seconds = 0.0);
+
+        /**
+         * @brief Makes the current RenderPass stop after the rows in flight.
+         *
+         * Safe to call from any thread; the next RenderPass runs normally.
+         */
+        void Interrupt() { interrupted.store(true, std::memory_order_relaxed); }
+
+        /**
+         * @brief Number of passes started since the last Reset.
+         */
+        [[nodiscard]] uint32_t GetPassCount() const { return pass; }
+
+        /**
+         * @brief Samples accumulated in a pixel.
+         */
+        [[nodiscard]] uint32_t GetSampleCount(int x, int y) const {
+            return samples.empty() ? 0 : samples[static_cast<size_t>(y) * width + x];
+        }
+    };
+
+} // namespace graphics
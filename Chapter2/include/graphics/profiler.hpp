@@ -0,0 +1,171 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#elif defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#else
+#include <chrono>
+#endif
+
+/**
+ * Scoped profiling zones exported as Chrome trace events.
+ *
+ * GRAPHICS_PROFILE_ZONE("name") measures the enclosing scope. Each thread
+ * appends its zones to its own fixed-size buffer without locks, using the
+ * CPU timestamp counter, so a zone costs a couple of counter reads and one
+ * store. WriteChromeTrace converts everything to the trace-event JSON format
+ * that chrome://tracing or Perfetto open. Without GRAPHICS_ENABLE_PROFILER the
+ * macro expands to nothing.
+ */
+namespace graphics::profiler {
+
+    /**
+     * @brief Reads a fast monotonic timestamp.
+     * @return CPU timestamp counter on x86, nanoseconds elsewhere
+     *
+     * The unit is converted to microseconds only when exporting, see
+     * TicksPerMicrosecond().
+     */
+    inline uint64_t Timestamp() {
+#if defined(_MSC_VER) || defined(__x86_64__) || defined(__i386__)
+        return __rdtsc();
+#else
+        return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count());
+#endif
+    }
+
+    /**
+     * @brief Rate of Timestamp(), measured against the steady clock.
+     */
+    double TicksPerMicrosecond();
+
+    /**
+     * @struct Event
+     * @brief One completed zone.
+     */
+    struct Event {
+        const char* name;   ///< Zone name, must be a string literal
+        uint64_t begin;     ///< Timestamp() when the zone was entered
+        uint64_t end;       ///< Timestamp() when the zone was left
+    };
+
+    /**
+     * @struct ThreadBuffer
+     * @brief Fixed-capacity event buffer written by a single thread.
+     *
+     * Only the owner thread writes events; it publishes them by bumping
+     * count with release ordering, so the exporter can read any prefix
+     * without locking. Buffers are pooled: when a thread exits its buffer
+     * (with its events) is handed to the next new thread, so render workers
+     * spawned every frame keep showing up as the same trace row.
+     */
+    struct ThreadBuffer {
+        static constexpr std::size_t kCapacity = 1 << 16;
+
+        std::atomic<std::size_t> count{0};
+        std::atomic<uint64_t> dropped{0};
+        int id = 0;     ///< Row of the buffer in the trace
+        Event events[kCapacity];
+    };
+
+    /**
+     * @brief Takes a buffer from the pool, allocating one if none is free.
+     */
+    ThreadBuffer* AcquireBuffer();
+
+    /**
+     * @struct BufferLease
+     * @brief Gives the thread's buffer back to the pool when the thread exits.
+     */
+    struct BufferLease {
+        ThreadBuffer* buffer = nullptr;
+        ~BufferLease();
+    };
+
+    inline thread_local BufferLease buffer_lease;
+
+    /**
+     * @brief Buffer of the calling thread, taken from the pool on first use.
+     */
+    inline ThreadBuffer& LocalBuffer() {
+        if (buffer_lease.buffer == nullptr)
+            buffer_lease.buffer = AcquireBuffer();
+        return *buffer_lease.buffer;
+    }
+
+    /**
+     * @brief Appends a completed zone to the calling thread's buffer.
+     *
+     * Events beyond the buffer capacity are dropped and counted.
+     */
+    inline void Record(const char* name, uint64_t begin, uint64_t end) {
+        ThreadBuffer& buffer = LocalBuffer();
+        const std::size_t index = buffer.count.load(std::memory_order_relaxed);
+        if (index >= ThreadBuffer::kCapacity) {
+            buffer.dropped.store(buffer.dropped.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+            return;
+        }
+        buffer.events[index] = {name, begin, end};
+        buffer.count.store(index + 1, std::memory_order_release);
+    }
+
+    /**
+     * @class Zone
+     * @brief Records the lifetime of a scope as an event.
+     */
+    class Zone {
+        const char* name;
+        uint64_t begin;
+    public:
+        explicit Zone(const char* name) : name(name), begin(Timestamp()) {}
+        ~Zone() { Record(name, begin, Timestamp()); }
+
+        Zone(const Zone&) = delete;
+        Zone& operator=(const Zone&) = delete;
+    };
+
+    /**
+     * @brief Whether the library was built with the zones compiled in.
+     */
+    constexpr bool Enabled() {
+#if GRAPHICS_ENABLE_PROFILER
+        return true;
+#else
+        return false;
+#endif
+    }
+
+    /**
+     * @brief Serializes every recorded event in Chrome trace-event JSON.
+     */
+    std::string ChromeTraceJson();
+
+    /**
+     * @brief Writes the recorded events to a Chrome trace-event JSON file.
+     * @param path Output file, open it with chrome://tracing or ui.perfetto.dev
+     * @return true if the file was written
+     */
+    bool WriteChromeTrace(const std::string& path);
+
+    /**
+     * @brief Discards all recorded events. No zone may be running.
+     */
+    void Reset();
+
+} // namespace graphics::profiler
+
+#define GRAPHICS_PROFILE_CONCAT_INNER(a, b) a##b
+#define GRAPHICS_PROFILE_CONCAT(a, b) GRAPHICS_PROFILE_CONCAT_INNER(a, b)
+
+#if GRAPHICS_ENABLE_PROFILER
+#define GRAPHICS_PROFILE_ZONE(name) ::graphics::profiler::Zone GRAPHICS_PROFILE_CONCAT(graphics_profile_zone_, __LINE__)(name)
+#else
+#define GRAPHICS_PROFILE_ZONE(name) ((void)0)
+#endif
@@ -0,0 +1,190 @@
+#pragma once
+
+#include "raylib.h"
+#include "canvas.hpp"
+#include "depth_buffer.hpp"
+#include "texture.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+namespace graphics {
+
+    /**
+     * @struct ScreenVertex
+     * @brief A triangle corner on the canvas, in pixels.
+     *
+     * Screen coordinates: (0,0) is the top-left corner of the top-left pixel
+     * and Y grows downward, so the center of pixel (x, y) is (x + 0.5, y + 0.5).
+     */
+    struct ScreenVertex {
+        float x;
+        float y;
+        /// Depth for the depth test, in [0, 1) from near to far. It is interpolated
+        /// linearly across the screen, like a projected z or 1 - 1/z is
+        float z = 0.0f;
+        /// Reciprocal of the view-space depth (the w of the clip-space vertex).
+        /// Shading is interpolated linearly in 1/w, which is what keeps it
+        /// perspective correct; leave it at 1 for triangles with no perspective
+        float inv_w = 1.0f;
+        /// Light intensity at the corner, scaling the triangle's color
+        float intensity = 1.0f;
+        /// Texture coordinates, for textured triangles
+        float u = 0.0f;
+        float v = 0.0f;
+    };
+
+    /**
+     * @struct ScreenTriangle
+     * @brief A colored triangle ready to be rasterized.
+     *
+     * When the corners have the same intensity the triangle is flat shaded
+     * with color * intensity. Otherwise it is Gouraud shaded: the intensity
+     * is interpolated across the triangle, perspective correct if the
+     * corners' 1/w differ, and the pixels are opaque.
+     *
+     * A textured triangle multiplies the texture, sampled at the pixel's
+     * perspective-correct texture coordinates and mip level, by color and
+     * intensity.
+     */
+    struct ScreenTriangle {
+        ScreenVertex v[3];  ///< Corners, in either winding order
+        Color color;        ///< Color at full intensity
+        const TextureMap* texture = nullptr;  ///< Texture, or nullptr for a plain color
+    };
+
+    /**
+     * @class Rasterizer
+     * @brief Draws triangles into a Canvas with edge functions, tile by tile.
+     *
+     * A pixel belongs to a triangle when its center is on the inner side of
+     * the three edges, i.e. when the three edge functions
+     * E(x, y) = a*x + b*y + c are all positive there (Pineda, "A Parallel
+     * Algorithm for Polygon Rasterization"). Pixels on an edge go to the
+     * triangle for which it is a top or a left edge, the fill convention of
+     * Direct3D and OpenGL, so triangles sharing an edge never draw a pixel
+     * twice or leave a gap. Vertices are snapped to 1/16 of a pixel and the
+     * edge functions are set up in integers, which makes this exact.
+     *
+     * The triangle's bounding box is walked in 8x8 pixel tiles. Since edge
+     * functions are linear, the values at two corners of a tile bound them
+     * over the whole tile: tiles outside some edge are skipped, tiles inside
+     * all three are filled without any per-pixel test. The remaining tiles,
+     * along the edges, test a row of eight pixels per SIMD operation, and
+     * reach the next pixel, row or tile by adding constants.
+     *
+     * Triangles wider or taller than kMaxExtent pixels are skipped: the
+     * per-pixel tests run in float, which is exact only for edge values of
+     * up to 2^24. Large triangles should be clipped to a guard band first.
+     *
+     * With the depth test enabled, a pixel is drawn only if it is nearer
+     * than the depth buffer. The buffer's tile bounds are checked first, for
+     * the whole triangle and then for each tile, so hidden triangles cost
+     * their setup and a few comparisons, and draw order back to front costs
+     * far more than front to back.
+     *
+     * Shading is set up once per triangle as planes over the screen, like
+     * the edges and the depth: from a tile's first pixel, the next pixel or
+     * row of an attribute is one add away. An attribute a is perspective
+     * correct as a / w and 1 / w are linear on the screen, not a itself, so
+     * both are stepped and divided, one division per row of eight pixels.
+     *
+     * With more than one thread, DrawTriangles sorts the triangles into bins
+     * of kBinSize pixels before drawing them (sort-middle, Molnar et al., "A
+     * Sorting Classification of Parallel Rendering"). First each thread takes
+     * a run of consecutive triangles and appends the index of each to the
+     * list of every bin its bounding box touches, a list per thread and per
+     * bin. Then the threads take whole bins and draw them, the lists of the
+     * first thread first, so each bin sees its triangles in submission order.
+     * Bins are whole tiles of the canvas and of the depth buffer, so no two
+     * threads ever write the same pixel, depth or tile bounds, and nothing is
+     * locked.
+     */
+    class Rasterizer {
+        std::reference_wrapper<Canvas> canvas;
+        DepthBuffer depth_buffer;
+        bool depth_test = false;
+        int thread_count;
+        // triangle indices per binning thread and per bin, thread-major
+        std::vector<std::vector<uint32_t>> bins;
+
+        /**
+         * @brief Draws the part of a triangle inside a rectangle of whole tiles.
+         * @param triangle Triangle in screen coordinates
+         * @param x0 First column, a multiple of kTileSize
+         * @param y0 First row, a multiple of kTileSize
+         * @param x1 Last column, included
+         * @param y1 Last row, included
+         */
+        void DrawTriangleIn(const ScreenTriangle& triangle, int x0, int y0, int x1, int y1);
+
+        /**
+         * @brief Resizes the depth buffer to the canvas if needed, before the depth test reads it.
+         */
+        void FitDepthBuffer();
+
+    public:
+        /// Side of the square tiles, one SIMD vector per tile row
+        static constexpr int kTileSize = 8;
+        /// Side of the square bins triangles are sorted into with several threads
+        static constexpr int kBinSize = 64;
+        /// Largest bounding box side, in pixels, of a triangle that can be drawn
+        static constexpr float kMaxExtent = 4096.0f;
+
+        static_assert(kBinSize % kTileSize == 0, "bins are whole tiles");
+
+        /**
+         * @brief Creates a rasterizer drawing into a canvas.
+         */
+        explicit Rasterizer(Canvas& canvas);
+
+        /**
+         * @brief Enables hidden-surface removal with the depth buffer.
+         */
+        void SetDepthTest(bool enabled) { depth_test = enabled; }
+        [[nodiscard]] bool GetDepthTest() const { return depth_test; }
+
+        /**
+         * @brief Sets how many threads DrawTriangles uses.
+         * @param threads Number of threads, values below 1 select the hardware concurrency
+         */
+        void SetThreadCount(int threads);
+
+        /**
+         * @brief Gets the number of threads DrawTriangles uses.
+         */
+        [[nodiscard]] int GetThreadCount() const { return thread_count; }
+
+        /**
+         * @brief Clears the depth buffer, resizing it to the canvas if needed. Call once per frame.
+         */
+        void ClearDepth();
+
+        /**
+         * @brief Gets the depth buffer, as left by the triangles drawn since the last ClearDepth.
+         */
+        [[nodiscard]] const DepthBuffer& GetDepthBuffer() const { return depth_buffer; }
+
+        /**
+         * @brief Fills the pixels whose centers lie inside a triangle.
+         * @param triangle Triangle in screen coordinates
+         *
+         * Degenerate (zero area) triangles draw nothing.
+         */
+        void DrawTriangle(const ScreenTriangle& triangle);
+
+        /**
+         * @brief Draws many triangles, in order.
+         * @param triangles First triangle
+         * @param count Number of triangles
+         *
+         * With several threads the triangles are binned and drawn in
+         * parallel; every pixel still sees them in order, so the image is the
+         * same as with one thread.
+         */
+        void DrawTriangles(const ScreenTriangle* triangles, size_t count);
+    };
+
+} // namespace graphics
@@ -1,11 +1,15 @@
-
 #pragma once
 
 #include "raylib.h"
 #include "canvas.hpp"
+#include "cost_map.hpp"
+#include "lights.hpp"
+#include "texture.hpp"
+#include "wavefront.hpp"
 
 #include <memory>
 #include <utility>
+#include <vector>
 
 namespace graphics {
 /**
@@ -22,6 +26,126 @@ struct Sphere {
     Vector3 center;  ///< Center point of the sphere in 3D space (C in Chapter 2)
     float radius;    ///< Radius of the sphere (r in Chapter 2) 
     Color color;     ///< Surface color of the sphere for rendering
+    float specular = -1.0f; ///< Specular exponent (shininess) from Chapter 3, -1 for a matte surface
+    float reflective = 0.0f; ///< Fraction of light mirrored by the surface (Chapter 4), 0 to 1
+    const TextureMap* texture = nullptr; ///< Image wrapped around the sphere in place of color, or nullptr
+};
+
+/**
+ * @struct Scene
+ * @brief Everything the raytracer needs to know about the world.
+ *
+ * Chapter 2 uses a handful of hard-coded spheres; keeping them in a scene
+ * object lets the same raytracer render other worlds, such as the standard
+ * benchmark scenes in scenes.hpp.
+ */
+struct Scene {
+    std::vector<Sphere> spheres;  ///< Spheres of the scene, their index is their primitive id
+    LightList lights;             ///< Light sources, a scene without lights is drawn with flat colors
+    std::vector<std::shared_ptr<const TextureMap>> textures;  ///< Textures of the spheres, kept alive with the scene
+};
+
+/**
+ * @brief Color of a sphere's surface at a point, from its texture if it has one.
+ * @param sphere The sphere
+ * @param normal Unit normal at the point
+ * @param footprint World-space size of what one pixel sees around the point, which picks the mip level
+ *
+ * The texture wraps around the sphere in longitude (u) and latitude (v,
+ * 0 at the top), like a map of the world.
+ */
+Color SurfaceColor(const Sphere& sphere, const Vector3& normal, float footprint);
+
+/**
+ * @struct Intersection
+ * @brief Result of a closest-hit query against the scene.
+ *
+ * Holds the index of the closest sphere hit by a ray (its primitive id) and
+ * the ray parameter t at which the hit happens. A sphere index of -1 means
+ * the ray escaped the scene and sees the background.
+ */
+struct Intersection {
+    int sphere = -1;  ///< Index of the closest sphere, -1 if nothing was hit
+    float t = 0.0f;   ///< Ray parameter of the hit point P = O + t*D
+};
+
+/**
+ * @struct RayState
+ * @brief Everything needed to continue a ray path after a bounce.
+ *
+ * Chapter 4 computes reflections by calling TraceRay recursively. Keeping
+ * this small fixed-size state instead turns the recursion into a loop, so
+ * the call stack does not grow with the reflection depth.
+ */
+struct RayState {
+    Vector3 origin;     ///< Start of the current segment of the path
+    Vector3 direction;  ///< Direction of the current segment
+    float throughput;   ///< Fraction of the segment's color that reaches the pixel
+    int depth;          ///< Reflections taken so far
+};
+
+/**
+ * @struct ReflectionConfig
+ * @brief Bounds on the work spent following mirror reflections.
+ */
+struct ReflectionConfig {
+    int max_depth = 3;            ///< Maximum reflections per pixel (the recursion limit of Chapter 4)
+    float min_throughput = 0.01f; ///< Stop once the reflected light would weigh less than this
+};
+
+/**
+ * @enum AntiAliasing
+ * @brief Anti-aliasing strategy used by Raytracer::Render.
+ *
+ * - None: one ray through the center of every pixel, as in Chapter 2.
+ * - Adaptive: one ray per pixel first, then only pixels whose neighbours
+ *   see a different sphere or a noticeably different color are supersampled
+ *   by recursively subdividing the pixel area.
+ */
+enum class AntiAliasing {
+    None,
+    Adaptive
+};
+
+/**
+ * @enum RenderOutput
+ * @brief What Raytracer::Render draws on the canvas.
+ *
+ * - Color: the rendered image.
+ * - CostHeatmap: how expensive each pixel was to render, as a false-color
+ *   heatmap (see CostMap). The image is still traced, only not shown.
+ */
+enum class RenderOutput {
+    Color,
+    CostHeatmap
+};
+
+/**
+ * @enum RenderMode
+ * @brief Order in which Raytracer::Render does its work.
+ *
+ * - PerPixel: each pixel's ray is intersected, shaded, and its shadow and
+ *   reflection rays followed before moving on to the next pixel.
+ * - Wavefront: every stage runs over all the rays of the frame before the
+ *   next one starts (generate, intersect, shade, shadows), and the
+ *   reflection rays the shading emits form the next wave. Each stage then
+ *   loops over one kind of work on contiguous data, which keeps its code
+ *   and data hot in the caches and lets intersection test eight rays at
+ *   once. Anti-aliasing is only available per pixel, and Render works per
+ *   pixel while the output is the cost heatmap.
+ */
+enum class RenderMode {
+    PerPixel,
+    Wavefront
+};
+
+/**
+ * @struct AdaptiveAAConfig
+ * @brief Tuning knobs of the adaptive anti-aliasing mode.
+ */
+struct AdaptiveAAConfig {
+    float color_threshold = 0.1f; ///< Max per-channel difference (0..1) treated as "same color"
+    int max_depth = 2;            ///< Subdivision levels, a pixel gets at most (2^depth + 1)^2 rays
 };
 
 /**
@@ -37,7 +161,185 @@ struct Sphere {
 class Raytracer {
     // we need a reference to the canvas
     std::reference_wrapper<Canvas> canvas;
-    Sphere spheres[5]{};
+    std::vector<Sphere> spheres;
+    LightList lights;
+    std::vector<std::shared_ptr<const TextureMap>> textures;
+
+    /**
+     * @brief Copy of the spheres as a structure of arrays for SIMD queries.
+     *
+     * Padded to a multiple of eight with NaN spheres, which no ray can hit
+     * because every comparison against NaN is false.
+     */
+    struct SphereArrays {
+        std::vector<float> cx, cy, cz, radius2;
+    } sphere_arrays;
+
+    // threads used by Render
+    int thread_count;
+
+    ReflectionConfig reflection{};
+    RenderMode render_mode = RenderMode::PerPixel;
+    wavefront::Buffers wavefront_buffers;
+    bool ray_sorting = false;
+    wavefront::SortReport sort_report{};
+
+    // identifies the current scene in the per-thread shadow caches
+    uint64_t scene_version = 0;
+    bool shadow_cache = true;
+
+    /**
+     * @brief One traced sample: the color seen and the primitive that produced it.
+     */
+    struct Sample {
+        Color color;
+        int sphere;
+    };
+
+    AntiAliasing anti_aliasing = AntiAliasing::None;
+    AdaptiveAAConfig adaptive_config{};
+    // first pass samples, one per pixel, used to find the edges
+    std::vector<Sample> frame_samples;
+
+    RenderOutput output = RenderOutput::Color;
+    int heatmap_tile_size = 1;
+    // per-pixel cost, filled only in the CostHeatmap output
+    CostMap cost_map;
+
+    /**
+     * @brief Reads the counter of the cost metric being measured.
+     * @return Timestamp counter for cycles, or the calling thread's number of
+     * intersection tests so far; the cost of some work is the difference
+     * between two reads around it
+     */
+    [[nodiscard]] uint64_t CostCounter() const;
+
+    /**
+     * @brief Computes the lit color of a sphere at a point, without reflections.
+     * @param sphere Sphere hit by the ray
+     * @param point Hit point P
+     * @param normal Unit normal N = (P - C) / |P - C|
+     * @param view Vector from P towards the viewer, -D
+     * @param footprint World-space size of the pixel at P, see SurfaceColor
+     * @return Sphere color scaled by the light intensity at P
+     *
+     * Implements the shading of Chapter 3. Lights blocked by another sphere
+     * are skipped, giving the shadows of Chapter 4.
+     */
+    Color LocalColor(const Sphere& sphere, const Vector3& point, const Vector3& normal, const Vector3& view, float footprint) const;
+
+    /**
+     * @brief Computes the color seen by a ray given its closest hit.
+     * @param origin Ray origin
+     * @param direction Ray direction
+     * @param hit Result of ClosestIntersection for that ray
+     * @return Lit color of the hit sphere, or the background if nothing was hit
+     *
+     * The local color at the hit point P = O + t*D is blended with what the
+     * mirror reflection sees, as in Chapter 4: local * (1 - r) + reflected * r.
+     * Reflections are followed in a loop over a RayState rather than by
+     * recursion, and stop at the configured depth or once their weight drops
+     * below the configured threshold; the last surface then counts fully.
+     */
+    Color Shade(const Vector3& origin, const Vector3& direction, const Intersection& hit);
+
+    /**
+     * @brief Finds any sphere blocking a ray, eight spheres at a time.
+     * @return Index of the first blocking sphere found, -1 if the ray is unoccluded
+     */
+    [[nodiscard]] int FindOccluder(const Vector3& origin, const Vector3& direction, float t_min, float t_max) const;
+
+    /**
+     * @brief Checks whether a light is blocked as seen from a point.
+     * @param point Point being shaded
+     * @param light Index of a point or directional light
+     * @return true if some sphere lies between the point and the light
+     *
+     * Shadow rays of neighbouring pixels towards the same light are usually
+     * blocked by the same sphere. Each thread remembers, per light, the last
+     * sphere that blocked it and tests that sphere alone before running a
+     * full Occluded query over the scene.
+     */
+    [[nodiscard]] bool LightOccluded(const Vector3& point, size_t light) const;
+
+    /**
+     * @brief Traces one ray through a (possibly sub-pixel) canvas position.
+     * @param origin Ray origin (camera position)
+     * @param x Canvas X coordinate relative to the center
+     * @param y Canvas Y coordinate relative to the center (positive Y points up)
+     * @return The color and sphere index seen through that position
+     */
+    Sample TraceSample(const Vector3& origin, float x, float y);
+
+    /**
+     * @brief Checks whether two samples can be blended without losing an edge.
+     * @return true if both samples see the same sphere and their colors are
+     * within the configured threshold
+     */
+    [[nodiscard]] bool SamplesAgree(const Sample& a, const Sample& b) const;
+
+    /**
+     * @brief Recursively supersamples a square area of the canvas.
+     * @param origin Ray origin (camera position)
+     * @param x Center X of the square (centered canvas coordinates)
+     * @param y Center Y of the square (centered canvas coordinates)
+     * @param half Half of the side of the square
+     * @param corners Samples at the top-left, top-right, bottom-left and bottom-right corners
+     * @param depth Current subdivision level
+     * @param rgb Output accumulated color of the square, in [0, 255] per channel
+     *
+     * If the four corners agree, or the maximum depth was reached, the square
+     * is shaded as the average of its corners. Otherwise it is split in four
+     * quadrants, which share corners so only five new rays are traced per split.
+     */
+    void SampleArea(const Vector3& origin, float x, float y, float half, const Sample (&corners)[4], int depth, float (&rgb)[3]);
+
+    /**
+     * @brief Finds the closest hit of a range of queued rays, eight rays at a time.
+     * @param rays Ray queue
+     * @param begin First ray of the range
+     * @param end One past the last ray of the range
+     * @param t_min Minimum intersection distance of every ray
+     * @param t Output ray parameter of the hits, indexed like the queue
+     * @param sphere Output sphere indices, -1 for rays that miss
+     *
+     * Same test as ClosestIntersection, but with the rays in the SIMD lanes:
+     * each sphere is broadcast and checked against eight rays at once.
+     */
+    void IntersectQueue(const wavefront::RayQueue& rays, size_t begin, size_t end, float t_min, float* t, int* sphere) const;
+
+    /**
+     * @brief Sorts the secondary rays of the wavefront buffers by coherence.
+     * @param sort_rays true to reorder the reflection ray queue (closest-hit rays)
+     * @param sort_shadows true to compute a tracing order for the shadow queue
+     *
+     * Rays are keyed by the octant of their direction (3 bits) followed by
+     * the Morton code of their origin quantized in the queue's bounds (9 bits
+     * per axis), and radix sorted. Rays that start close together and go the
+     * same way then follow each other, so they touch the same spheres and the
+     * same shadow cache entries. Reflection rays carry their pixel, and
+     * shadow results are written back at their unsorted index, so the image
+     * does not change.
+     */
+    void SortSecondaryRays(bool sort_rays, bool sort_shadows);
+
+    /**
+     * @brief Render for RenderMode::Wavefront.
+     */
+    void RenderWavefront(const Vector3& origin);
+public:
+    /// Offset of secondary rays from the surface, so a sphere does not shadow or reflect itself
+    static constexpr float kSurfaceEpsilon = 0.001f;
+
+    /**
+     * @brief Constructor for Raytracer.
+     * @param canvas Reference to the canvas for rendering output
+     * 
+     * Initializes the raytracer with a predefined scene containing several
+     * spheres. In Chapter 2, the scene is kept simple to focus on the
+     * core ray tracing algorithm rather than complex scene management.
+     */
+    explicit Raytracer(Canvas& canvas);
 
     /**
      * @brief Computes ray-sphere intersection using quadratic formula.
@@ -52,16 +354,78 @@ class Raytracer {
      * equation in t: at² + bt + c = 0, solved using quadratic formula.
      */
     [[nodiscard]] std::pair<float, float> IntersectRaySphere(const Vector3& origin, const Vector3& direction, const Sphere& sphere) const;
-public:
+
     /**
-     * @brief Constructor for Raytracer.
-     * @param canvas Reference to the canvas for rendering output
-     * 
-     * Initializes the raytracer with a predefined scene containing several
-     * spheres. In Chapter 2, the scene is kept simple to focus on the
-     * core ray tracing algorithm rather than complex scene management.
+     * @brief Replaces the scene being rendered.
+     * @param scene New scene, see scenes.hpp for the standard ones
      */
-    explicit Raytracer(Canvas& canvas);
+    void SetScene(Scene scene);
+
+    /**
+     * @brief Gets the spheres of the current scene.
+     */
+    [[nodiscard]] const std::vector<Sphere>& GetSpheres() const { return spheres; }
+
+    /**
+     * @brief Gets the lights of the current scene.
+     */
+    [[nodiscard]] const LightList& GetLights() const { return lights; }
+
+    /**
+     * @brief Identifies the current scene, every SetScene gives a new value.
+     *
+     * Lets code caching work derived from the scene notice it changed.
+     */
+    [[nodiscard]] uint64_t GetSceneVersion() const { return scene_version; }
+
+    /**
+     * @brief Sets how far mirror reflections are followed.
+     * @param config Maximum depth and minimum weight of a reflection
+     */
+    void SetReflections(const ReflectionConfig& config) { reflection = config; }
+
+    /**
+     * @brief Enables the per-thread, per-light last occluder cache for shadow rays.
+     * @param enabled true to test the last blocker first (default), false to always query the scene
+     */
+    void SetShadowCache(bool enabled) { shadow_cache = enabled; }
+
+    /**
+     * @brief Selects whether Render works pixel by pixel or in wavefronts.
+     * @param mode Per-pixel (default) or wavefront rendering; the images only differ
+     *             by rounding, on rays that graze a sphere
+     */
+    void SetRenderMode(RenderMode mode) { render_mode = mode; }
+
+    /**
+     * @brief Gets the current render mode.
+     */
+    [[nodiscard]] RenderMode GetRenderMode() const { return render_mode; }
+
+    /**
+     * @brief Enables sorting reflection and shadow rays before tracing them.
+     * @param enabled true to sort; only the wavefront mode has queues to sort
+     */
+    void SetRaySorting(bool enabled) { ray_sorting = enabled; }
+
+    /**
+     * @brief Cost of secondary ray sorting in the last wavefront frame.
+     *
+     * Also filled when sorting is off, so the tracing time of both settings
+     * can be compared with what sorting costs.
+     */
+    [[nodiscard]] const wavefront::SortReport& GetRaySortReport() const { return sort_report; }
+
+    /**
+     * @brief Sets how many threads Render uses.
+     * @param threads Number of threads, values below 1 select the hardware concurrency
+     */
+    void SetThreadCount(int threads);
+
+    /**
+     * @brief Gets the number of threads Render uses.
+     */
+    [[nodiscard]] int GetThreadCount() const { return thread_count; }
 
     /**
      * @brief Traces a ray through the scene and returns the color.
@@ -74,9 +438,80 @@ public:
      * This is the core ray tracing function from Chapter 2. For each ray,
      * it finds the closest intersection with scene objects within the
      * specified distance range. Returns the color of the closest object,
-     * implementing the basic visibility algorithm.
+     * implementing the basic visibility algorithm, lit by the scene lights
+     * as in Chapter 3.
      */
     Color TraceRay(const Vector3& origin, const Vector3& direction, float t_min, float t_max);
+
+    /**
+     * @brief Finds the closest sphere hit by a ray.
+     * @param origin Ray starting point
+     * @param direction Ray direction vector
+     * @param t_min Minimum intersection distance
+     * @param t_max Maximum intersection distance
+     * @return Index of the closest sphere and its distance, sphere -1 if none
+     *
+     * Visibility part of TraceRay, without shading. Exposing the primitive
+     * index lets callers tell apart pixels that see different objects.
+     */
+    [[nodiscard]] Intersection ClosestIntersection(const Vector3& origin, const Vector3& direction, float t_min, float t_max) const;
+
+    /**
+     * @brief Checks whether anything blocks a ray (any-hit query).
+     * @param origin Ray starting point, e.g. a point being shaded
+     * @param direction Ray direction, e.g. towards a light
+     * @param t_min Minimum intersection distance (avoids self-shadowing)
+     * @param t_max Maximum intersection distance (the light's position)
+     * @return true as soon as one sphere is found in [t_min, t_max]
+     *
+     * Shadow rays from Chapter 4 only need to know whether the light is
+     * visible, not which object is closest, so the search stops at the first
+     * intersection and no shading is done. The spheres are tested eight at a
+     * time from a structure-of-arrays copy of the scene.
+     */
+    [[nodiscard]] bool Occluded(const Vector3& origin, const Vector3& direction, float t_min, float t_max) const;
+
+    /**
+     * @brief Renders the whole scene into the canvas.
+     * @param origin Camera position from which the rays are cast
+     *
+     * Casts rays through the canvas as described in Chapter 2, one per
+     * pixel center. When adaptive anti-aliasing is enabled, a second pass
+     * supersamples only the pixels that sit on an edge: those whose
+     * neighbours see another sphere or a color beyond the threshold.
+     * Rows are shared among GetThreadCount() threads. Each call is one frame
+     * for the statistics counters, see stats::LastFrame(). See RenderMode
+     * for the wavefront alternative.
+     */
+    void Render(const Vector3& origin);
+
+    /**
+     * @brief Selects the anti-aliasing strategy used by Render.
+     * @param mode Anti-aliasing mode
+     * @param config Tuning used by the adaptive mode
+     */
+    void SetAntiAliasing(AntiAliasing mode, const AdaptiveAAConfig& config = {});
+
+    /**
+     * @brief Selects what Render draws on the canvas.
+     * @param mode Rendered image, or per-pixel cost heatmap
+     * @param metric Cost measured in heatmap mode
+     * @param tile_size Side of the heatmap tiles, 1 shows every pixel's own cost
+     */
+    void SetOutput(RenderOutput mode, CostMetric metric = CostMetric::Cycles, int tile_size = 1);
+
+    /**
+     * @brief Gets what Render draws on the canvas.
+     */
+    [[nodiscard]] RenderOutput GetOutput() const { return output; }
+
+    /**
+     * @brief Per-pixel cost of the last frame rendered in heatmap mode.
+     *
+     * Holds the raw values behind the heatmap, which can be aggregated per
+     * tile or exported with CostMap::ExportCsv.
+     */
+    [[nodiscard]] const CostMap& GetCostMap() const { return cost_map; }
 };
 
 }
\ No newline at end of file
@@ -0,0 +1,174 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/**
+ * Random and quasi-random numbers for the stochastic renderers.
+ *
+ * Nothing here is shared between threads: a generator is a 16-byte value
+ * seeded from the pixel and sample it works for, and the sample table is
+ * read-only once built. The numbers a pixel gets therefore depend only on
+ * the pixel and the sample index, never on which thread traced it or in
+ * which order.
+ */
+namespace graphics::sampling {
+
+    /**
+     * @brief Mixes the bits of an integer, so consecutive pixels and samples get unrelated seeds.
+     *
+     * The "lowbias32" hash by Chris Wellons.
+     */
+    inline uint32_t Hash(uint32_t x) {
+        x ^= x >> 16;
+        x *= 0x7feb352dU;
+        x ^= x >> 15;
+        x *= 0x846ca68bU;
+        x ^= x >> 16;
+        return x;
+    }
+
+    /**
+     * @brief Mirrors the bits of an integer, bit 0 becoming bit 31.
+     */
+    inline uint32_t ReverseBits(uint32_t x) {
+        x = (x << 16) | (x >> 16);
+        x = ((x & 0x00ff00ffu) << 8) | ((x & 0xff00ff00u) >> 8);
+        x = ((x & 0x0f0f0f0fu) << 4) | ((x & 0xf0f0f0f0u) >> 4);
+        x = ((x & 0x33333333u) << 2) | ((x & 0xccccccccu) >> 2);
+        x = ((x & 0x55555555u) << 1) | ((x & 0xaaaaaaaau) >> 1);
+        return x;
+    }
+
+    /**
+     * @brief Owen-scrambles the bits of an integer, most significant first, with a hash.
+     * @param x Value to scramble, a 32-bit fraction or an index
+     * @param seed Selects the permutation
+     *
+     * Burley, "Practical Hash-based Owen Scrambling": each bit is flipped or
+     * not depending on the seed and on all the bits above it, through the
+     * Laine-Karras hash on the mirrored bits. As a permutation of fractions
+     * it maps every binary interval [k/2^m, (k+1)/2^m) onto another one, so
+     * stratified points stay stratified. As a permutation of indices it
+     * maps the first 2^m indices onto 2^m consecutive ones that start at a
+     * multiple of 2^m.
+     */
+    inline uint32_t NestedUniformScramble(uint32_t x, uint32_t seed) {
+        x = ReverseBits(x);
+        x += seed;
+        x ^= x * 0x6c50b47cu;
+        x ^= x * 0xb82f1e52u;
+        x ^= x * 0xc7afe638u;
+        x ^= x * 0x8d22f6e6u;
+        return ReverseBits(x);
+    }
+
+    /**
+     * @brief Turns 32 random bits into a float uniform in [0, 1).
+     */
+    inline float ToUnitFloat(uint32_t bits) {
+        return static_cast<float>(bits >> 8) * 0x1p-24f;
+    }
+
+    /**
+     * @class Pcg32
+     * @brief PCG-XSH-RR generator (O'Neill, "PCG: A Family of Simple Fast
+     * Space-Efficient Statistically Good Algorithms for Random Number Generation").
+     *
+     * One 64-bit multiply-add per number and no tables, so it is cheap to
+     * create one per path on the stack. Each stream is an independent sequence.
+     */
+    class Pcg32 {
+        uint64_t state = 0;
+        uint64_t increment;
+
+    public:
+        /**
+         * @brief Starts a sequence.
+         * @param seed Position in the sequence
+         * @param stream Selects one of 2^63 independent sequences
+         */
+        explicit Pcg32(uint64_t seed, uint64_t stream = 0) : increment((stream << 1) | 1u) {
+            NextUint();
+            state += seed;
+            NextUint();
+        }
+
+        uint32_t NextUint() {
+            const uint64_t old = state;
+            state = old * 6364136223846793005ULL + increment;
+            const auto xorshifted = static_cast<uint32_t>(((old >> 18) ^ old) >> 27);
+            const auto rotation = static_cast<uint32_t>(old >> 59);
+            return (xorshifted >> rotation) | (xorshifted << ((32 - rotation) & 31));
+        }
+
+        /**
+         * @brief Next number, uniform in [0, 1).
+         */
+        float Next() { return ToUnitFloat(NextUint()); }
+    };
+
+    /**
+     * @struct Sample2D
+     * @brief A point of the unit square.
+     */
+    struct Sample2D {
+        float u;
+        float v;
+    };
+
+    /**
+     * @class SampleTable
+     * @brief Precomputed 2D Sobol points, shuffled and scrambled per pixel and dimension.
+     *
+     * The first two Sobol dimensions form a (0, 2)-sequence: any power of two
+     * consecutive points stratify the unit square, so N samples of a pixel
+     * cover it far more evenly than N random points and the error falls
+     * faster. Pixels must not all share the same points, or the error would
+     * show as structured patterns, so each point is Owen-scrambled with bits
+     * hashed from the pixel and dimension (jitter, first bounce, second
+     * bounce, ...), which keeps the stratification.
+     *
+     * A path combines several dimensions, which must be independent of each
+     * other: were they all read at the same index, the second bounce of
+     * sample i would be a fixed function of its first bounce and the paths
+     * of a pixel would lie on a 2D surface of the path space, converging to
+     * a biased value. Each pixel and dimension therefore also visits the
+     * points in its own order, an Owen scrambling of the sample index
+     * (Burley, "Practical Hash-based Owen Scrambling"). Its first 2^m
+     * samples are still a stratified block of 2^m points.
+     *
+     * Past kSize samples the table is reused with new scrambling bits.
+     */
+    class SampleTable {
+        std::vector<uint32_t> points;  // u and v of each point, as 32-bit fractions
+
+        SampleTable();
+
+    public:
+        static constexpr uint32_t kSize = 4096;
+
+        /**
+         * @brief The table, built on first use.
+         */
+        static const SampleTable& Instance();
+
+        /**
+         * @brief A sample point of a pixel.
+         * @param pixel Index of the pixel
+         * @param sample Sample number within the pixel
+         * @param dimension Which decision the point is used for, each gets independent points
+         */
+        [[nodiscard]] Sample2D Get(uint32_t pixel, uint32_t sample, uint32_t dimension) const {
+            const uint32_t seed = Hash(pixel * 0x9e3779b9u ^ Hash(dimension * 0x85ebca6bu));
+            const uint32_t shuffled = NestedUniformScramble(sample, seed);
+            // the high bits pick which block of kSize samples, all read from the same table
+            const uint32_t scramble = Hash(seed ^ Hash(shuffled / kSize));
+            const size_t index = 2 * static_cast<size_t>(shuffled % kSize);
+            return {ToUnitFloat(NestedUniformScramble(points[index], scramble)),
+                    ToUnitFloat(NestedUniformScramble(points[index + 1], Hash(scramble)))};
+        }
+    };
+
+} // namespace graphics::sampling
@@ -0,0 +1,61 @@
+#pragma once
+
+#include "raytracing.hpp"
+
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * Standard scenes shared by the demo and the benchmarks, so that timings
+ * taken on different machines or commits render exactly the same thing.
+ */
+namespace graphics::scenes {
+
+    /**
+     * @brief Adds the lights of Chapter 3: ambient, one point and one directional light.
+     */
+    void AddBookLights(Scene& scene);
+
+    /**
+     * @brief The five spheres scene from Chapter 2 (red, green, blue, black
+     * and the huge yellow ground sphere), lit by the Chapter 3 lights and
+     * with the reflective materials of Chapter 4.
+     */
+    Scene BookScene();
+
+    /**
+     * @brief The book scene with checkered red, green and blue spheres.
+     *
+     * Exercises texture sampling and mip level selection.
+     */
+    Scene TexturedScene();
+
+    /**
+     * @brief The book scene lit by a ring of point lights instead.
+     * @param count Number of point lights, sharing 0.8 of intensity
+     *
+     * Stresses the per-light shading loop.
+     */
+    Scene ManyLightsScene(int count);
+
+    /**
+     * @brief Randomly placed spheres in front of the camera.
+     * @param count Number of spheres
+     * @param seed Seed of the generator, the same seed gives the same scene
+     *
+     * Spheres are spread in a box in front of the camera, and their radius
+     * shrinks as the count grows so that the screen coverage stays similar.
+     */
+    Scene RandomSpheres(std::size_t count, uint32_t seed = 1);
+
+    /**
+     * @brief A dense wall of touching spheres facing the camera.
+     * @param columns Number of spheres along X
+     * @param rows Number of spheres along Y
+     *
+     * Nearly every primary ray hits a sphere, which makes it the worst case
+     * for hit shading and the best case for edge detection to find work.
+     */
+    Scene SphereGrid(int columns, int rows);
+
+} // namespace graphics::scenes
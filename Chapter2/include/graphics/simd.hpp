@@ -0,0 +1,309 @@
+#pragma once
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+
+#if defined(__AVX2__) && defined(__FMA__)
+#include <immintrin.h>
+#define GRAPHICS_SIMD_AVX2 1
+#else
+#define GRAPHICS_SIMD_AVX2 0
+#endif
+
+#if defined(__AVX2__) && defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#endif
+
+/**
+ * Eight-lane float vectors for the hot loops (lights, shadow rays, ...).
+ *
+ * With AVX2 and FMA enabled (the GRAPHICS_ENABLE_AVX2 CMake option) every
+ * operation is a single instruction on a 256-bit register. Otherwise the
+ * same code runs on plain arrays of eight floats, which the compiler still
+ * vectorizes with whatever instruction set it targets. Loops written with
+ * these types process data stored as structure of arrays, eight items at
+ * a time.
+ */
+namespace graphics::simd {
+
+    constexpr int kWidth = 8;
+
+    /**
+     * @brief Rounds a count up to a whole number of vectors.
+     */
+    constexpr std::size_t PaddedSize(std::size_t count) {
+        return (count + kWidth - 1) / kWidth * kWidth;
+    }
+
+    /**
+     * @brief Checks that the CPU has the instructions the build targets.
+     *
+     * A build with GRAPHICS_ENABLE_AVX2 lets the compiler use AVX2 and FMA
+     * anywhere, not only in these types, so it stops with an illegal
+     * instruction on an older x86-64 CPU. Programs call this first thing in
+     * main, to exit with a message instead. This is best effort: code run
+     * before main, such as static initializers, may already have used them,
+     * which is why the option is off by default.
+     */
+    inline bool CpuSupported() {
+#if defined(__AVX2__) && (defined(__GNUC__) || defined(__clang__))
+        return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+#elif defined(__AVX2__) && defined(_MSC_VER)
+        int info[4];
+        __cpuid(info, 1);
+        const bool fma = info[2] & (1 << 12);
+        const bool os_saves_ymm = (info[2] & (1 << 27)) && (_xgetbv(0) & 6) == 6;
+        __cpuidex(info, 7, 0);
+        const bool avx2 = info[1] & (1 << 5);
+        return fma && os_saves_ymm && avx2;
+#else
+        return true;
+#endif
+    }
+
+    /**
+     * @brief Why CpuSupported failed, for the user.
+     */
+    constexpr const char* kCpuUnsupportedMessage =
+        "This build uses AVX2 and FMA, which this CPU does not support. "
+        "Reconfigure with GRAPHICS_ENABLE_AVX2 off (the default) to run here.";
+
+#if GRAPHICS_SIMD_AVX2
+
+    struct Mask8 {
+        __m256 v;
+    };
+
+    struct Float8 {
+        __m256 v;
+
+        static Float8 Load(const float* p) { return {_mm256_loadu_ps(p)}; }
+        static Float8 Broadcast(float x) { return {_mm256_set1_ps(x)}; }
+        static Float8 Zero() { return {_mm256_setzero_ps()}; }
+        void Store(float* p) const { _mm256_storeu_ps(p, v); }
+    };
+
+    inline Float8 operator+(Float8 a, Float8 b) { return {_mm256_add_ps(a.v, b.v)}; }
+    inline Float8 operator-(Float8 a, Float8 b) { return {_mm256_sub_ps(a.v, b.v)}; }
+    inline Float8 operator*(Float8 a, Float8 b) { return {_mm256_mul_ps(a.v, b.v)}; }
+    inline Float8 operator/(Float8 a, Float8 b) { return {_mm256_div_ps(a.v, b.v)}; }
+    inline Float8 MulAdd(Float8 a, Float8 b, Float8 c) { return {_mm256_fmadd_ps(a.v, b.v, c.v)}; }
+    inline Float8 MulSub(Float8 a, Float8 b, Float8 c) { return {_mm256_fmsub_ps(a.v, b.v, c.v)}; }
+    inline Float8 Min(Float8 a, Float8 b) { return {_mm256_min_ps(a.v, b.v)}; }
+    inline Float8 Max(Float8 a, Float8 b) { return {_mm256_max_ps(a.v, b.v)}; }
+    inline Float8 Sqrt(Float8 a) { return {_mm256_sqrt_ps(a.v)}; }
+
+    inline Mask8 operator<(Float8 a, Float8 b) { return {_mm256_cmp_ps(a.v, b.v, _CMP_LT_OQ)}; }
+    inline Mask8 operator<=(Float8 a, Float8 b) { return {_mm256_cmp_ps(a.v, b.v, _CMP_LE_OQ)}; }
+    inline Mask8 operator>(Float8 a, Float8 b) { return {_mm256_cmp_ps(a.v, b.v, _CMP_GT_OQ)}; }
+    inline Mask8 operator>=(Float8 a, Float8 b) { return {_mm256_cmp_ps(a.v, b.v, _CMP_GE_OQ)}; }
+    inline Mask8 operator&(Mask8 a, Mask8 b) { return {_mm256_and_ps(a.v, b.v)}; }
+    inline Mask8 operator|(Mask8 a, Mask8 b) { return {_mm256_or_ps(a.v, b.v)}; }
+
+    /**
+     * @brief Lane-wise mask ? a : b.
+     */
+    inline Float8 Select(Mask8 mask, Float8 a, Float8 b) { return {_mm256_blendv_ps(b.v, a.v, mask.v)}; }
+
+    /**
+     * @brief One bit per lane, lane 0 in the lowest bit.
+     */
+    inline int MoveMask(Mask8 mask) { return _mm256_movemask_ps(mask.v); }
+
+    /**
+     * @brief Sets the lanes of p selected by the mask to a 32-bit value.
+     *
+     * Reads and rewrites all eight lanes, so the others must not be written
+     * concurrently; in exchange it costs a load, a blend and a store instead
+     * of a branch per lane.
+     */
+    inline void MaskedFill(uint32_t* p, Mask8 mask, uint32_t value) {
+        const __m256i old = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+        const __m256i blended = _mm256_blendv_epi8(old, _mm256_set1_epi32(static_cast<int>(value)), _mm256_castps_si256(mask.v));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(p), blended);
+    }
+
+    /**
+     * @brief Loads base[indices[i]] into lane i.
+     */
+    inline Float8 Gather(const float* base, const uint32_t* indices) {
+        return {_mm256_i32gather_ps(base, _mm256_loadu_si256(reinterpret_cast<const __m256i*>(indices)), 4)};
+    }
+
+    /**
+     * @brief One bit per lane of p equal to a 32-bit value, lane 0 in the lowest bit.
+     */
+    inline int EqualMask(const uint32_t* p, uint32_t value) {
+        const __m256i equal = _mm256_cmpeq_epi32(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(p)),
+                                                 _mm256_set1_epi32(static_cast<int>(value)));
+        return _mm256_movemask_ps(_mm256_castsi256_ps(equal));
+    }
+
+    /**
+     * @brief Sets the lanes of p selected by the mask to opaque RGBA8 pixels.
+     * @param r, g, b Channels in [0, 255], rounded to nearest and clamped
+     *
+     * The pixels are laid out like raylib's Color, red in the lowest byte.
+     * Same read-modify-write as MaskedFill.
+     */
+    inline void MaskedStoreRgb(uint32_t* p, Mask8 mask, Float8 r, Float8 g, Float8 b) {
+        const __m256 low = _mm256_set1_ps(0.5f);
+        const __m256 high = _mm256_set1_ps(255.5f);
+        const auto channel = [&](Float8 c) {
+            return _mm256_cvttps_epi32(_mm256_min_ps(_mm256_max_ps(_mm256_add_ps(c.v, low), low), high));
+        };
+        const __m256i rgb = _mm256_or_si256(_mm256_or_si256(channel(r), _mm256_slli_epi32(channel(g), 8)),
+                                            _mm256_slli_epi32(channel(b), 16));
+        const __m256i pixels = _mm256_or_si256(rgb, _mm256_set1_epi32(static_cast<int>(0xff000000u)));
+        const __m256i old = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+        const __m256i blended = _mm256_blendv_epi8(old, pixels, _mm256_castps_si256(mask.v));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(p), blended);
+    }
+
+#else
+
+    struct Mask8 {
+        bool v[kWidth];
+    };
+
+    struct Float8 {
+        float v[kWidth];
+
+        static Float8 Load(const float* p) { Float8 r; for (int i = 0; i < kWidth; i++) r.v[i] = p[i]; return r; }
+        static Float8 Broadcast(float x) { Float8 r; for (float& lane : r.v) lane = x; return r; }
+        static Float8 Zero() { return Broadcast(0.0f); }
+        void Store(float* p) const { for (int i = 0; i < kWidth; i++) p[i] = v[i]; }
+    };
+
+#define GRAPHICS_SIMD_LANEWISE(type, expression) \
+    type r;                                      \
+    for (int i = 0; i < kWidth; i++)             \
+        r.v[i] = (expression);                   \
+    return r
+
+    inline Float8 operator+(Float8 a, Float8 b) { GRAPHICS_SIMD_LANEWISE(Float8, a.v[i] + b.v[i]); }
+    inline Float8 operator-(Float8 a, Float8 b) { GRAPHICS_SIMD_LANEWISE(Float8, a.v[i] - b.v[i]); }
+    inline Float8 operator*(Float8 a, Float8 b) { GRAPHICS_SIMD_LANEWISE(Float8, a.v[i] * b.v[i]); }
+    inline Float8 operator/(Float8 a, Float8 b) { GRAPHICS_SIMD_LANEWISE(Float8, a.v[i] / b.v[i]); }
+    inline Float8 MulAdd(Float8 a, Float8 b, Float8 c) { GRAPHICS_SIMD_LANEWISE(Float8, a.v[i] * b.v[i] + c.v[i]); }
+    inline Float8 MulSub(Float8 a, Float8 b, Float8 c) { GRAPHICS_SIMD_LANEWISE(Float8, a.v[i] * b.v[i] - c.v[i]); }
+    inline Float8 Min(Float8 a, Float8 b) { GRAPHICS_SIMD_LANEWISE(Float8, a.v[i] < b.v[i] ? a.v[i] : b.v[i]); }
+    inline Float8 Max(Float8 a, Float8 b) { GRAPHICS_SIMD_LANEWISE(Float8, a.v[i] > b.v[i] ? a.v[i] : b.v[i]); }
+    inline Float8 Sqrt(Float8 a) { GRAPHICS_SIMD_LANEWISE(Float8, std::sqrt(a.v[i])); }
+
+    inline Mask8 operator<(Float8 a, Float8 b) { GRAPHICS_SIMD_LANEWISE(Mask8, a.v[i] < b.v[i]); }
+    inline Mask8 operator<=(Float8 a, Float8 b) { GRAPHICS_SIMD_LANEWISE(Mask8, a.v[i] <= b.v[i]); }
+    inline Mask8 operator>(Float8 a, Float8 b) { GRAPHICS_SIMD_LANEWISE(Mask8, a.v[i] > b.v[i]); }
+    inline Mask8 operator>=(Float8 a, Float8 b) { GRAPHICS_SIMD_LANEWISE(Mask8, a.v[i] >= b.v[i]); }
+    inline Mask8 operator&(Mask8 a, Mask8 b) { GRAPHICS_SIMD_LANEWISE(Mask8, a.v[i] && b.v[i]); }
+    inline Mask8 operator|(Mask8 a, Mask8 b) { GRAPHICS_SIMD_LANEWISE(Mask8, a.v[i] || b.v[i]); }
+
+    /**
+     * @brief Lane-wise mask ? a : b.
+     */
+    inline Float8 Select(Mask8 mask, Float8 a, Float8 b) { GRAPHICS_SIMD_LANEWISE(Float8, mask.v[i] ? a.v[i] : b.v[i]); }
+
+#undef GRAPHICS_SIMD_LANEWISE
+
+    /**
+     * @brief One bit per lane, lane 0 in the lowest bit.
+     */
+    inline int MoveMask(Mask8 mask) {
+        int bits = 0;
+        for (int i = 0; i < kWidth; i++)
+            bits |= mask.v[i] ? 1 << i : 0;
+        return bits;
+    }
+
+    /**
+     * @brief Sets the lanes of p selected by the mask to a 32-bit value.
+     */
+    inline void MaskedFill(uint32_t* p, Mask8 mask, uint32_t value) {
+        for (int i = 0; i < kWidth; i++)
+            if (mask.v[i])
+                p[i] = value;
+    }
+
+    /**
+     * @brief Loads base[indices[i]] into lane i.
+     */
+    inline Float8 Gather(const float* base, const uint32_t* indices) {
+        Float8 r;
+        for (int i = 0; i < kWidth; i++)
+            r.v[i] = base[indices[i]];
+        return r;
+    }
+
+    /**
+     * @brief One bit per lane of p equal to a 32-bit value, lane 0 in the lowest bit.
+     */
+    inline int EqualMask(const uint32_t* p, uint32_t value) {
+        int bits = 0;
+        for (int i = 0; i < kWidth; i++)
+            bits |= p[i] == value ? 1 << i : 0;
+        return bits;
+    }
+
+    /**
+     * @brief Sets the lanes of p selected by the mask to opaque RGBA8 pixels.
+     * @param r, g, b Channels in [0, 255], rounded to nearest and clamped
+     *
+     * The pixels are laid out like raylib's Color, red in the lowest byte.
+     */
+    inline void MaskedStoreRgb(uint32_t* p, Mask8 mask, Float8 r, Float8 g, Float8 b) {
+        const auto channel = [](float c) {
+            return static_cast<uint32_t>(std::fmin(std::fmax(c + 0.5f, 0.5f), 255.5f));
+        };
+        for (int i = 0; i < kWidth; i++)
+            if (mask.v[i])
+                p[i] = channel(r.v[i]) | channel(g.v[i]) << 8 | channel(b.v[i]) << 16 | 0xff000000u;
+    }
+
+#endif
+
+    /**
+     * @brief Whether any lane of the mask is set.
+     */
+    inline bool Any(Mask8 mask) { return MoveMask(mask) != 0; }
+
+    /**
+     * @brief Raises every lane to the same non-negative integer power.
+     *
+     * Uses binary exponentiation, so x^1000 costs about 15 multiplies and no
+     * transcendental function. Specular exponents are per surface, hence the
+     * same for all the lanes, which keeps this loop uniform.
+     */
+    inline Float8 PowInt(Float8 x, unsigned exponent) {
+        Float8 result = Float8::Broadcast(1.0f);
+        while (exponent) {
+            if (exponent & 1u)
+                result = result * x;
+            x = x * x;
+            exponent >>= 1;
+        }
+        return result;
+    }
+
+    /**
+     * @brief Approximates exp(-x) for x >= 0 using only the arithmetic above.
+     *
+     * exp(-x) = exp(-x/16)^16, and exp(-x/16) is close to the inverse of
+     * the Taylor polynomial of exp(x/16). Four squarings keep the result
+     * decaying like an exponential for large x; the relative error is below
+     * 1% up to x = 10 and 6% at x = 16, where the weight is already ~1e-7.
+     * Plenty for filter weights.
+     */
+    inline Float8 ExpNeg(Float8 x) {
+        const Float8 q = x * Float8::Broadcast(1.0f / 16.0f);
+        Float8 p = MulAdd(q, Float8::Broadcast(1.0f / 24.0f), Float8::Broadcast(1.0f / 6.0f));
+        p = MulAdd(p, q, Float8::Broadcast(0.5f));
+        p = MulAdd(p, q, Float8::Broadcast(1.0f));
+        p = MulAdd(p, q, Float8::Broadcast(1.0f));
+        Float8 e = Float8::Broadcast(1.0f) / p;
+        for (int i = 0; i < 4; i++)
+            e = e * e;
+        return e;
+    }
+
+} // namespace graphics::simd
@@ -0,0 +1,161 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+/**
+ * Ray tracing and rasterization statistics counters.
+ *
+ * Every thread owns its own block of counters, so counting a ray is a plain
+ * load and store on a cache line no other thread writes to. The blocks are
+ * summed only when a frame ends. The counting macros below expand to nothing
+ * unless the library is built with GRAPHICS_ENABLE_STATS, so production
+ * builds pay nothing for them.
+ */
+namespace graphics::stats {
+
+    /**
+     * @enum Counter
+     * @brief Events counted while rendering a frame.
+     */
+    enum class Counter : int {
+        PrimaryRays,        ///< Rays cast from the camera through the canvas
+        IntersectionTests,  ///< Ray-sphere intersection tests
+        Hits,               ///< Closest-hit queries that found a sphere
+        ReflectionRays,     ///< Closest-hit rays following a mirror reflection
+        BounceRays,         ///< Closest-hit rays continuing a path after a diffuse bounce
+        ShadowRays,         ///< Any-hit (occlusion) queries, e.g. towards a light
+        Occlusions,         ///< Any-hit queries that found a blocker
+        ShadowCacheHits,    ///< Shadow rays resolved by the last occluder cache
+        ShadowCacheMisses,  ///< Shadow rays not blocked by their cached occluder, then queried in full
+        Triangles,          ///< Triangles submitted to the rasterizer
+        TilesAccepted,      ///< Raster tiles filled whole, without per-pixel tests
+        TilesPartial,       ///< Raster tiles tested pixel by pixel
+        TrianglesOccluded,  ///< Triangles found hidden by the depth buffer's tile bounds
+        TilesOccluded,      ///< Raster tiles found hidden by the depth buffer's tile bounds
+        TrianglesRejected,  ///< Triangles outside the view frustum by their outcodes
+        TrianglesClipped,   ///< Triangles crossing the near plane or the guard band, clipped as polygons
+        BackFaces,          ///< Triangles culled for facing away from the camera
+        SpheresCulled,      ///< Bounding spheres found outside the view frustum
+        VerticesTransformed, ///< Mesh vertices transformed to clip space
+        VertexCacheHits,    ///< Mesh corners whose vertex was found in the post-transform cache
+        Count
+    };
+
+    constexpr int kCounterCount = static_cast<int>(Counter::Count);
+
+    /**
+     * @struct ThreadCounters
+     * @brief Counters owned by a single thread.
+     *
+     * The values are atomics only so that the frame aggregation can read them
+     * while the owner thread is alive; the owner never uses a locked
+     * read-modify-write on them. Each block registers itself when a thread
+     * first counts something, and folds its values into a global total when
+     * the thread exits.
+     */
+    struct alignas(64) ThreadCounters {
+        std::atomic<uint64_t> values[kCounterCount];
+
+        ThreadCounters();
+        ~ThreadCounters();
+
+        ThreadCounters(const ThreadCounters&) = delete;
+        ThreadCounters& operator=(const ThreadCounters&) = delete;
+    };
+
+    inline thread_local ThreadCounters thread_counters;
+
+    /**
+     * @brief Adds n to a counter of the calling thread.
+     */
+    inline void Add(Counter counter, uint64_t n) {
+        auto& value = thread_counters.values[static_cast<int>(counter)];
+        value.store(value.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+    }
+
+    /**
+     * @struct FrameStats
+     * @brief Counters aggregated over all threads for one frame.
+     */
+    struct FrameStats {
+        uint64_t values[kCounterCount]{};
+        double seconds = 0.0;   ///< Wall time between BeginFrame and EndFrame
+
+        [[nodiscard]] uint64_t Get(Counter counter) const { return values[static_cast<int>(counter)]; }
+
+        /**
+         * @brief Rays traced in the frame, of any kind.
+         */
+        [[nodiscard]] uint64_t Rays() const;
+
+        /**
+         * @brief Average number of intersection tests per traced ray.
+         */
+        [[nodiscard]] double TestsPerRay() const;
+
+        /**
+         * @brief Fraction of closest-hit (non shadow) rays that found a sphere.
+         */
+        [[nodiscard]] double HitRate() const;
+
+        /**
+         * @brief Fraction of cached shadow rays resolved by the last occluder cache.
+         */
+        [[nodiscard]] double ShadowCacheHitRate() const;
+
+        /**
+         * @brief Throughput in millions of rays per second.
+         */
+        [[nodiscard]] double MRaysPerSecond() const;
+    };
+
+    /**
+     * @brief Whether the library was built with the counters compiled in.
+     */
+    constexpr bool Enabled() {
+#if GRAPHICS_ENABLE_STATS
+        return true;
+#else
+        return false;
+#endif
+    }
+
+    /**
+     * @brief Marks the start of a frame: snapshots the counters and the clock.
+     */
+    void BeginFrame();
+
+    /**
+     * @brief Marks the end of a frame and aggregates the per-thread counters.
+     * @return Statistics of the frame, also available through LastFrame()
+     *
+     * Must be called once all the threads working on the frame are done.
+     */
+    const FrameStats& EndFrame();
+
+    /**
+     * @brief Statistics of the last frame closed with EndFrame.
+     */
+    const FrameStats& LastFrame();
+
+    /**
+     * @brief Serializes frame statistics as a JSON object.
+     */
+    std::string ToJson(const FrameStats& frame);
+
+    /**
+     * @brief Returns a counter's name as used in the JSON output.
+     */
+    const char* CounterName(Counter counter);
+
+} // namespace graphics::stats
+
+#if GRAPHICS_ENABLE_STATS
+#define GRAPHICS_STAT_ADD(counter, n) ::graphics::stats::Add(::graphics::stats::Counter::counter, (n))
+#else
+#define GRAPHICS_STAT_ADD(counter, n) ((void)0)
+#endif
+
+#define GRAPHICS_STAT_INC(counter) GRAPHICS_STAT_ADD(counter, 1)
@@ -0,0 +1,97 @@
+#pragma once
+
+#include "raylib.h"
+#include "canvas.hpp"
+#include "raytracing.hpp"
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+namespace graphics {
+
+    /**
+     * @class TemporalAccumulator
+     * @brief Refines a still raytraced image with the frames that would redraw it unchanged.
+     *
+     * While the camera and the scene stay put, every frame presents the same
+     * image. Accumulate() puts those frames to work: each call traces one more
+     * ray per pixel, shifted inside the pixel by a frame-dependent sub-pixel
+     * offset (a Halton (2, 3) sequence, so the offsets cover the pixel evenly),
+     * and shows the running per-pixel mean. Edges and fine detail converge to
+     * their box-filtered value, i.e. the image gets anti-aliased for free.
+     *
+     * Any change restarts the mean: a different camera position, canvas size
+     * or scene makes Accumulate render a regular frame first, so interaction
+     * costs exactly one Raytracer::Render as before. Changes the accumulator
+     * cannot see (anti-aliasing, reflection or render mode settings) must be
+     * followed by a Render and a call to Reset().
+     *
+     * Like the path tracer, a call can be given a time budget: rows left out
+     * keep their previous mean and sample count, so idle refinement never
+     * delays the next frame by more than the budget. After 1024 frames the
+     * image is considered converged and Accumulate stops tracing.
+     */
+    class TemporalAccumulator {
+        std::reference_wrapper<Canvas> canvas;
+        std::reference_wrapper<Raytracer> raytracer;
+
+        int width = 0;
+        int height = 0;
+        Vector3 last_origin{0, 0, 0};
+        uint64_t scene_version = 0;
+        bool seeded = false;
+
+        // sum of the samples of each pixel, 0..255 per channel
+        std::vector<float> sum_r, sum_g, sum_b;
+        std::vector<uint32_t> samples;
+        uint32_t frame = 0;
+        std::atomic<bool> interrupted{false};
+
+        /**
+         * @brief Restarts the mean from the image currently on the canvas.
+         */
+        void Seed(const Vector3& origin);
+
+    public:
+        /**
+         * @brief Creates an accumulator refining a raytracer's image.
+         * @param canvas Canvas holding the image
+         * @param raytracer Renders the first frame and traces the extra samples
+         */
+        TemporalAccumulator(Canvas& canvas, Raytracer& raytracer);
+
+        /**
+         * @brief Drops the accumulated samples; the next Accumulate starts from the canvas as it is.
+         *
+         * Call after rendering with settings the accumulator does not track.
+         */
+        void Reset() { seeded = false; }
+
+        /**
+         * @brief Renders a new frame if the view changed, else adds a jittered sample per pixel.
+         * @param origin Camera position
+         * @param max_seconds Stop starting new rows after this long, 0 for no limit
+         * @return true if the canvas changed
+         *
+         * The first call after construction or Reset() only takes the canvas
+         * as the first frame of the mean. Does nothing in the cost heatmap output, whose values are not colors.
+         */
+        bool Accumulate(const Vector3& origin, double max_seconds = 0.0);
+
+        /**
+         * @brief Makes the current Accumulate stop after the rows in flight.
+         *
+         * Called between two calls, it stops the next one that traces before
+         * its first row. Either way only that call is affected.
+         */
+        void Interrupt() { interrupted.store(true, std::memory_order_relaxed); }
+
+        /**
+         * @brief Number of frames averaged since the last change, the rendered one included.
+         */
+        [[nodiscard]] uint32_t GetFrameCount() const { return frame; }
+    };
+
+} // namespace graphics
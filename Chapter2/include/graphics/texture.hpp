@@ -0,0 +1,100 @@
+#pragma once
+
+#include "raylib.h"
+
+#include <cstddef>
+#include <vector>
+
+namespace graphics {
+
+    /**
+     * @enum TextureFilter
+     * @brief How a texture is read between texels and between mip levels.
+     */
+    enum class TextureFilter {
+        Nearest,   ///< Nearest texel of the nearest mip level
+        Bilinear,  ///< Four texels of the nearest mip level, blended
+        Trilinear  ///< Bilinear in the two mip levels around the footprint, blended
+    };
+
+    /**
+     * @class TextureMap
+     * @brief An RGBA8 image with its mip chain, stored tile by tile for sampling.
+     *
+     * Texture coordinates run from (0, 0) at the top-left corner of the image
+     * to (1, 1) at the bottom-right one, and repeat outside of that.
+     *
+     * Mip level 0 is the image itself, and each next level halves both sides,
+     * down to 1x1, averaging 2x2 texels. A minified texture is sampled from
+     * the level whose texels are about the size of the pixel's footprint, so
+     * it neither aliases nor walks over a large image for a small result.
+     *
+     * Every level is stored in 4x4 texel tiles of 64 bytes, one cache line,
+     * rather than row by row: the 2x2 texels of a bilinear fetch and those of
+     * neighbouring pixels are then mostly in the same line, whatever the
+     * direction a triangle or a ray walks the texture in.
+     */
+    class TextureMap {
+        struct Level {
+            int width, height;
+            int tiles_x;     // tiles per row of tiles
+            size_t offset;   // first texel in texels
+        };
+
+        std::vector<Level> levels;
+        std::vector<Color> texels;
+        TextureFilter filter = TextureFilter::Trilinear;
+
+        [[nodiscard]] size_t Index(const Level& level, int x, int y) const {
+            return level.offset + (static_cast<size_t>(y / kTileSize) * level.tiles_x + x / kTileSize) * (kTileSize * kTileSize) +
+                   (y % kTileSize) * kTileSize + x % kTileSize;
+        }
+
+        void Bilinear(const Level& level, float u, float v, float* rgba) const;
+
+    public:
+        /// Side of the square tiles texels are stored in
+        static constexpr int kTileSize = 4;
+
+        /**
+         * @brief Creates a texture from an image and builds its mip chain.
+         * @param pixels width * height colors, row-major, top row first
+         * @param width Image width, > 0
+         * @param height Image height, > 0
+         */
+        TextureMap(const Color* pixels, int width, int height);
+
+        /**
+         * @brief A checkerboard texture, e.g. for floors.
+         * @param size Side of the texture in texels
+         * @param checks Number of squares along each side
+         * @param a Color of the top-left square
+         * @param b Color of the other squares
+         */
+        static TextureMap Checkerboard(int size, int checks, Color a, Color b);
+
+        [[nodiscard]] int GetWidth() const { return levels[0].width; }
+        [[nodiscard]] int GetHeight() const { return levels[0].height; }
+        [[nodiscard]] int GetLevelCount() const { return static_cast<int>(levels.size()); }
+
+        void SetFilter(TextureFilter mode) { filter = mode; }
+        [[nodiscard]] TextureFilter GetFilter() const { return filter; }
+
+        /**
+         * @brief Reads one texel of a mip level.
+         * @param level Mip level, 0 is the full image
+         * @param x Column, in [0, level width)
+         * @param y Row, in [0, level height)
+         */
+        [[nodiscard]] Color Texel(int level, int x, int y) const { return texels[Index(levels[level], x, y)]; }
+
+        /**
+         * @brief Samples the texture with the current filter.
+         * @param u Horizontal texture coordinate
+         * @param v Vertical texture coordinate
+         * @param lod Level of detail: log2 of the footprint's size in level 0 texels
+         */
+        [[nodiscard]] Color Sample(float u, float v, float lod) const;
+    };
+
+} // namespace graphics
@@ -0,0 +1,120 @@
+#pragma once
+
+#include "raylib.h"
+#include "clipping.hpp"
+#include "mesh.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+
+namespace graphics {
+
+    /**
+     * @class ViewProjection
+     * @brief A camera's view and projection matrices, and their product.
+     *
+     * The product is recomputed only when one of them changes. Every change
+     * takes a new version number from a counter shared by all cameras, so a
+     * version names one product: an instance that cached its matrix for a
+     * version can tell it is still valid, whichever camera object it is
+     * drawn with next, even one rebuilt at the same address.
+     */
+    class ViewProjection {
+        Matrix view;
+        Matrix projection;
+        Matrix view_projection;
+        uint64_t version;
+
+    public:
+        /**
+         * @brief Starts with identity view and projection.
+         */
+        ViewProjection();
+
+        /**
+         * @brief Sets the matrix from world space to camera space.
+         */
+        void SetView(const Matrix& matrix);
+
+        /**
+         * @brief Sets the matrix from camera space to clip space, e.g. ProjectionFromViewPort.
+         */
+        void SetProjection(const Matrix& matrix);
+
+        [[nodiscard]] const Matrix& GetView() const { return view; }
+        [[nodiscard]] const Matrix& GetProjection() const { return projection; }
+
+        /**
+         * @brief The view followed by the projection.
+         */
+        [[nodiscard]] const Matrix& GetViewProjection() const { return view_projection; }
+
+        /**
+         * @brief Changes every time the view or the projection is set; no two cameras share one.
+         */
+        [[nodiscard]] uint64_t GetVersion() const { return version; }
+    };
+
+    /**
+     * @class Instance
+     * @brief A mesh placed in the world by a model matrix.
+     *
+     * Caches its model-view-projection matrix along with the camera version
+     * it was combined for. Drawing the instance again with nothing moved
+     * costs a comparison; only moving it or the camera costs the two matrix
+     * products.
+     */
+    class Instance {
+        std::reference_wrapper<const Mesh> mesh;
+        Matrix model;
+        Matrix model_view_projection;
+        uint64_t cached_version = 0;  // no camera has version 0
+        bool dirty = true;
+
+    public:
+        /**
+         * @brief Places a mesh at the origin, unrotated and unscaled.
+         * @param instance_mesh Mesh to draw; must outlive the instance
+         */
+        explicit Instance(const Mesh& instance_mesh);
+
+        [[nodiscard]] const Mesh& GetMesh() const { return mesh.get(); }
+
+        /**
+         * @brief Sets the matrix from the mesh's space to world space.
+         */
+        void SetModel(const Matrix& matrix) {
+            model = matrix;
+            dirty = true;
+        }
+
+        [[nodiscard]] const Matrix& GetModel() const { return model; }
+
+        /**
+         * @brief The model, view and projection combined, recomputed only if one of them changed.
+         * @param camera Camera the instance is drawn with
+         */
+        const Matrix& GetModelViewProjection(const ViewProjection& camera);
+    };
+
+    /**
+     * @brief Transforms every vertex of a mesh to clip space, eight at a time.
+     * @param mesh Mesh whose positions are transformed; its indices apply to out unchanged
+     * @param to_clip Matrix from the mesh's space to clip space, applied to column vectors
+     * @param out Receives the transformed vertices, with the mesh's texture coordinates and an intensity of 1
+     *
+     * Reads the mesh's structure of arrays with whole SIMD loads: each output
+     * coordinate is a row of the matrix dotted with (x, y, z, 1), three
+     * fused multiply-adds for eight vertices. Every vertex is transformed
+     * once and none is looked up, which suits meshes mostly in view; for
+     * per-vertex lighting or a part of a mesh, use VertexStage.
+     */
+    void TransformVertices(const Mesh& mesh, const Matrix& to_clip, ClipVertexBuffer& out);
+
+    /**
+     * @brief Transforms the vertices of an instance, with its cached model-view-projection matrix.
+     */
+    void TransformVertices(Instance& instance, const ViewProjection& camera, ClipVertexBuffer& out);
+
+} // namespace graphics
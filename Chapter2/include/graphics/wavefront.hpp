@@ -0,0 +1,141 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/**
+ * Queues of the wavefront rendering mode (see RenderMode::Wavefront).
+ *
+ * Instead of following each pixel's rays to the end before moving to the
+ * next pixel, the wavefront mode runs every stage over a whole queue of rays
+ * at once: intersection for all rays, then shading for all hits, then all
+ * the shadow rays the shading produced, and again with the reflection rays.
+ * The queues are structures of arrays so each stage is a tight loop over
+ * contiguous data, eight rays per SIMD iteration where it applies.
+ */
+namespace graphics::wavefront {
+
+    /**
+     * @struct RayQueue
+     * @brief Closest-hit rays waiting for the intersection stage.
+     */
+    struct RayQueue {
+        std::vector<float> ox, oy, oz;      ///< Origins
+        std::vector<float> dx, dy, dz;      ///< Directions
+        std::vector<float> throughput;      ///< Weight of the ray's color in its pixel
+        std::vector<int> pixel;             ///< Framebuffer index the ray contributes to
+
+        [[nodiscard]] std::size_t Size() const { return pixel.size(); }
+
+        void Push(float x, float y, float z, float dir_x, float dir_y, float dir_z, float weight, int target) {
+            ox.push_back(x); oy.push_back(y); oz.push_back(z);
+            dx.push_back(dir_x); dy.push_back(dir_y); dz.push_back(dir_z);
+            throughput.push_back(weight);
+            pixel.push_back(target);
+        }
+
+        void Clear() {
+            ox.clear(); oy.clear(); oz.clear();
+            dx.clear(); dy.clear(); dz.clear();
+            throughput.clear();
+            pixel.clear();
+        }
+
+        /**
+         * @brief Appends all the rays of another queue, keeping their order.
+         */
+        void Append(const RayQueue& other);
+    };
+
+    /**
+     * @struct SurfaceQueue
+     * @brief Hit points waiting for their shadow rays to be resolved.
+     *
+     * The light reaching a surface is only known once its shadow rays went
+     * through the shadow stage; until then the surface keeps its color, its
+     * weight in the pixel and the range of shadow rays it emitted.
+     */
+    struct SurfaceQueue {
+        std::vector<int> pixel;
+        std::vector<float> px, py, pz;      ///< Hit point, the origin of the shadow rays
+        std::vector<float> weight;          ///< throughput * (1 - reflectivity)
+        std::vector<float> r, g, b;         ///< Unlit sphere color
+        std::vector<float> ambient;         ///< Light reaching the surface regardless of shadows
+        std::vector<int> first_shadow;      ///< Index of the surface's first shadow ray
+        std::vector<int> shadow_count;      ///< Number of shadow rays, -1 for an unlit (flat) surface
+
+        [[nodiscard]] std::size_t Size() const { return pixel.size(); }
+
+        void Clear() {
+            pixel.clear(); px.clear(); py.clear(); pz.clear(); weight.clear();
+            r.clear(); g.clear(); b.clear();
+            ambient.clear(); first_shadow.clear(); shadow_count.clear();
+        }
+    };
+
+    /**
+     * @struct ShadowQueue
+     * @brief Any-hit rays from a surface towards a light.
+     */
+    struct ShadowQueue {
+        std::vector<int> surface;           ///< Index of the surface being lit in its SurfaceQueue
+        std::vector<int> light;             ///< Light index in the scene's LightList
+        std::vector<float> term;            ///< Light intensity added if the ray is unoccluded
+        std::vector<unsigned char> visible; ///< Filled by the shadow stage
+
+        [[nodiscard]] std::size_t Size() const { return light.size(); }
+
+        void Clear() {
+            surface.clear(); light.clear(); term.clear(); visible.clear();
+        }
+    };
+
+    /**
+     * @struct ChunkOutput
+     * @brief What one chunk of the shade stage produced.
+     *
+     * Chunks fill their own queues, which are then concatenated in chunk
+     * order, so no stage needs atomics and the queues are the same for any
+     * thread count.
+     */
+    struct ChunkOutput {
+        SurfaceQueue surfaces;
+        ShadowQueue shadows;
+        RayQueue reflections;
+        std::vector<float> terms; ///< Per-light intensities at the point being shaded, scratch
+    };
+
+    /**
+     * @struct SortReport
+     * @brief What secondary ray sorting cost and what the work it should speed up took.
+     *
+     * Sorting only pays off when the tracing time it saves is larger than
+     * sort_seconds; comparing trace_seconds with sorting on and off tells.
+     */
+    struct SortReport {
+        uint64_t sorted_rays = 0;   ///< Reflection and shadow rays reordered in the last frame
+        double sort_seconds = 0.0;  ///< Time spent computing keys, sorting and reordering
+        double trace_seconds = 0.0; ///< Time spent intersecting reflection rays and tracing shadow rays
+    };
+
+    /**
+     * @struct Buffers
+     * @brief Every queue of a wavefront frame, kept from one frame to the next
+     * so their memory is only allocated once.
+     */
+    struct Buffers {
+        RayQueue rays;
+        std::vector<float> hit_t;
+        std::vector<int> hit_sphere;
+        std::vector<ChunkOutput> chunks;
+        SurfaceQueue surfaces;
+        ShadowQueue shadows;
+        std::vector<float> accum_r, accum_g, accum_b; ///< Color reaching each pixel so far
+
+        // secondary ray sorting
+        RayQueue sorted_rays;
+        std::vector<uint32_t> keys, order, key_scratch, order_scratch;
+    };
+
+} // namespace graphics::wavefront
@@ -1,25 +1,98 @@
 #include "graphics/canvas.hpp"
+#include "graphics/profiler.hpp"
 #include "raylib.h"
 
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
 #include <iterator>
 #include <iostream>
+#include <utility>
 
 namespace graphics {
-    Canvas::Canvas(int w, int h, const char *title) : CanvasWidth(w), CanvasHeight(h) {
+    namespace {
+        // the interpolated coordinate of a line is kept in 16.16 fixed point
+        constexpr int kFractionBits = 16;
+        constexpr int64_t kOne = int64_t{1} << kFractionBits;
+
+        int64_t FloorDiv(int64_t a, int64_t b) {  // b > 0
+            return a >= 0 ? a / b : -((-a + b - 1) / b);
+        }
+
+        int64_t CeilDiv(int64_t a, int64_t b) {  // b > 0
+            return -FloorDiv(-a, b);
+        }
+
+        /**
+         * Draws one line into a framebuffer. The major axis is the longer one,
+         * walked one pixel per step; the minor coordinate of step i is
+         * floor(base + i * slope) in fixed point. Both are linear in i, so the
+         * steps inside the canvas form one range found with a few divisions.
+         */
+        void DrawClippedLine(Color* pixels, int width, int height, const LineSegment& line) {
+            int64_t major0 = line.x0, major1 = line.x1, minor0 = line.y0, minor1 = line.y1;
+            int64_t major_size = width, minor_size = height;
+            int64_t major_stride = 1, minor_stride = width;
+            const bool x_major = std::llabs(major1 - major0) >= std::llabs(minor1 - minor0);
+            if (!x_major) {
+                std::swap(major0, minor0);
+                std::swap(major1, minor1);
+                std::swap(major_size, minor_size);
+                std::swap(major_stride, minor_stride);
+            }
+            if (major0 > major1) {
+                std::swap(major0, major1);
+                std::swap(minor0, minor1);
+            }
+
+            const int64_t length = major1 - major0;
+            const int64_t slope = length > 0 ? (minor1 - minor0) * kOne / length : 0;
+            // rounds to the nearest pixel instead of truncating
+            const int64_t base = minor0 * kOne + kOne / 2;
+            const int64_t minor_limit = minor_size * kOne - 1;
+
+            int64_t first = std::max<int64_t>(0, -major0);
+            int64_t last = std::min(length, major_size - 1 - major0);
+            if (slope > 0) {
+                first = std::max(first, CeilDiv(-base, slope));
+                last = std::min(last, FloorDiv(minor_limit - base, slope));
+            } else if (slope < 0) {
+                first = std::max(first, CeilDiv(base - minor_limit, -slope));
+                last = std::min(last, FloorDiv(base, -slope));
+            } else if (base < 0 || base > minor_limit) {
+                return;
+            }
+            if (first > last)
+                return;
+
+            // indexed from the framebuffer itself: major0 may lie before the canvas
+            int64_t minor = base + first * slope;
+            for (int64_t i = first; i <= last; i++, minor += slope)
+                pixels[(major0 + i) * major_stride + (minor >> kFractionBits) * minor_stride] = line.color;
+        }
+    }
+    Canvas::Canvas(int w, int h, const char *title, bool headless)
+        : CanvasWidth(w), CanvasHeight(h), ViewWidth(1.0f), ViewHeight(1.0f), Distance(1.0f),
+          background(WHITE), headless(headless),
+          // Clear to white initially
+          framebuffer(static_cast<size_t>(w) * h, WHITE) {
+        if (headless)
+            return;
+
         InitWindow(CanvasWidth, CanvasHeight, title);
         SetTargetFPS(60);
 
-        // Create render texture for double buffering and pixel manipulation
-        renderTexture = LoadRenderTexture(CanvasWidth, CanvasHeight);
-
-        // Clear to white initially
-        BeginTextureMode(renderTexture);
-        ClearBackground(WHITE);
-        EndTextureMode();
+        // Texture the framebuffer is uploaded to on every Present
+        Image image = GenImageColor(CanvasWidth, CanvasHeight, WHITE);
+        texture = LoadTextureFromImage(image);
+        UnloadImage(image);
     }
 
     Canvas::~Canvas() {
-        UnloadRenderTexture(renderTexture);
+        if (headless)
+            return;
+
+        UnloadTexture(texture);
         CloseWindow();
     }
 
@@ -63,9 +136,7 @@ namespace graphics {
     void Canvas::PutPixel(int x, int y, const Color& color) {
         // Standard screen coordinates: (0,0) at top-left
         if (IsInBounds(x, y)) {
-            BeginTextureMode(renderTexture);
-            DrawPixel(x, y, color);
-            EndTextureMode();
+            framebuffer[static_cast<size_t>(y) * CanvasWidth + x] = color;
         }
     }
 
@@ -77,33 +148,52 @@ namespace graphics {
         PutPixel(screenX, screenY, color);
     }
 
+    void Canvas::DrawLine(int x0, int y0, int x1, int y1, const Color& color) {
+        DrawClippedLine(framebuffer.data(), CanvasWidth, CanvasHeight, {x0, y0, x1, y1, color});
+    }
+
+    void Canvas::DrawLines(const LineSegment* segments, size_t count) {
+        GRAPHICS_PROFILE_ZONE("DrawLines");
+        Color* pixels = framebuffer.data();
+        for (size_t i = 0; i < count; i++)
+            DrawClippedLine(pixels, CanvasWidth, CanvasHeight, segments[i]);
+    }
+
     Vector3 Canvas::CanvasToViewPort(int x, int y) {
         // Match JavaScript exactly: viewport_size = 1
         const Vector3 result{
             static_cast<float>(x) * ViewWidth / static_cast<float>(CanvasWidth),
-            -(static_cast<float>(y) * ViewHeight / static_cast<float>(CanvasHeight)),
+            static_cast<float>(y) * ViewHeight / static_cast<float>(CanvasHeight),
+            Distance};
+        return result;
+    }
+
+    Vector3 Canvas::CanvasToViewPort(float x, float y) {
+        const Vector3 result{
+            x * ViewWidth / static_cast<float>(CanvasWidth),
+            y * ViewHeight / static_cast<float>(CanvasHeight),
             Distance};
         return result;
     }
 
     void Canvas::Clear(Color color) {
         background = color;
-        BeginTextureMode(renderTexture);
-        ClearBackground(color);
-        EndTextureMode();
+        std::fill(framebuffer.begin(), framebuffer.end(), color);
     }
 
     void Canvas::Present() {
+        GRAPHICS_PROFILE_ZONE("Present");
+        if (headless)
+            return;
+
+        // Framebuffer rows are already top to bottom, no flipping needed
+        // (unlike a render texture, which OpenGL stores upside down)
+        UpdateTexture(texture, framebuffer.data());
+
         BeginDrawing();
         ClearBackground(WHITE);
 
-        // Draw the render texture to screen (try without flipping first)
-        DrawTextureRec(
-            renderTexture.texture,
-            (Rectangle){0, 0, static_cast<float>(CanvasWidth), static_cast<float>(CanvasHeight)},
-            (Vector2){0, 0},
-            WHITE
-        );
+        DrawTexture(texture, 0, 0, WHITE);
 
         // Optional: Show FPS counter
         DrawFPS(10, 10);
@@ -112,6 +202,8 @@ namespace graphics {
     }
 
     bool Canvas::ShouldClose() const {
+        if (headless)
+            return false;
         return WindowShouldClose();
     }
 
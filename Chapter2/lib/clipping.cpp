@@ -0,0 +1,255 @@
+#include "graphics/clipping.hpp"
+#include "graphics/profiler.hpp"
+#include "graphics/simd.hpp"
+#include "graphics/stats.hpp"
+
+#include <algorithm>
+#include <iterator>
+
+using namespace graphics;
+
+namespace {
+    // outcode bits: outside the frustum, then outside the guard band
+    enum : uint16_t {
+        kLeft = 1 << 0,
+        kRight = 1 << 1,
+        kBottom = 1 << 2,
+        kTop = 1 << 3,
+        kNear = 1 << 4,
+        kGuardLeft = 1 << 5,
+        kGuardRight = 1 << 6,
+        kGuardBottom = 1 << 7,
+        kGuardTop = 1 << 8,
+    };
+    constexpr uint16_t kFrustum = kLeft | kRight | kBottom | kTop | kNear;
+    constexpr uint16_t kMustClip = kNear | kGuardLeft | kGuardRight | kGuardBottom | kGuardTop;
+    constexpr uint16_t kClipPlanes[] = {kNear, kGuardLeft, kGuardRight, kGuardBottom, kGuardTop};
+
+    // a polygon clipped by n planes has at most 3 + n corners
+    constexpr int kMaxCorners = 3 + static_cast<int>(std::size(kClipPlanes));
+
+    struct Corner {
+        float x, y, z, w;
+        float intensity;
+        float u, v;
+    };
+
+    /**
+     * Signed distance of a corner to one of the clip planes, >= 0 on the inner side.
+     */
+    float PlaneDistance(const Corner& corner, uint16_t plane, float guard_x, float guard_y) {
+        switch (plane) {
+            case kNear: return corner.z;
+            case kGuardLeft: return corner.x + guard_x * corner.w;
+            case kGuardRight: return guard_x * corner.w - corner.x;
+            case kGuardBottom: return corner.y + guard_y * corner.w;
+            default: return guard_y * corner.w - corner.y;
+        }
+    }
+
+    Corner Lerp(const Corner& a, const Corner& b, float t) {
+        return {a.x + (b.x - a.x) * t, a.y + (b.y - a.y) * t, a.z + (b.z - a.z) * t, a.w + (b.w - a.w) * t,
+                a.intensity + (b.intensity - a.intensity) * t, a.u + (b.u - a.u) * t, a.v + (b.v - a.v) * t};
+    }
+
+    /**
+     * Keeps the part of a convex polygon on the inner side of a plane
+     * (Sutherland-Hodgman). Returns the new number of corners.
+     */
+    int ClipPolygon(const Corner* in, int count, Corner* out, uint16_t plane, float guard_x, float guard_y) {
+        int written = 0;
+        for (int i = 0; i < count; i++) {
+            const Corner& current = in[i];
+            const Corner& next = in[(i + 1) % count];
+            const float d0 = PlaneDistance(current, plane, guard_x, guard_y);
+            const float d1 = PlaneDistance(next, plane, guard_x, guard_y);
+            if (d0 >= 0.0f)
+                out[written++] = current;
+            if ((d0 >= 0.0f) != (d1 >= 0.0f))
+                out[written++] = Lerp(current, next, d0 / (d0 - d1));
+        }
+        return written;
+    }
+
+    /**
+     * One bit per triangle, for the count <= 8 triangles of an index list,
+     * set if the triangle faces away from the camera or is seen edge on.
+     * The determinant of the corners' (x, y, w) has the sign of the winding
+     * on the screen, counter-clockwise positive, and unlike the projected
+     * area it stays valid for corners behind the camera (Olano and Greer,
+     * "Triangle Scan Conversion using 2D Homogeneous Coordinates").
+     */
+    int BackFacing(const ClipVertexBuffer& vertices, const uint32_t* indices, size_t count) {
+        using namespace simd;
+        uint32_t corners[3][kWidth] = {};
+        for (size_t lane = 0; lane < count; lane++)
+            for (int k = 0; k < 3; k++)
+                corners[k][lane] = indices[3 * lane + k];
+        Float8 x[3], y[3], w[3];
+        for (int k = 0; k < 3; k++) {
+            x[k] = Gather(vertices.x.data(), corners[k]);
+            y[k] = Gather(vertices.y.data(), corners[k]);
+            w[k] = Gather(vertices.w.data(), corners[k]);
+        }
+        const Float8 determinant = x[0] * MulSub(y[1], w[2], y[2] * w[1]) - y[0] * MulSub(x[1], w[2], x[2] * w[1]) +
+                                   w[0] * MulSub(x[1], y[2], x[2] * y[1]);
+        return MoveMask(determinant <= Float8::Zero()) & ((1 << count) - 1);
+    }
+
+    /**
+     * Perspective division and viewport transform of the clipper's canvas.
+     */
+    struct ScreenMapping {
+        float center_x, center_y;
+        float half_width, half_height;
+
+        [[nodiscard]] ScreenVertex Project(const Corner& corner) const {
+            const float inv_w = 1.0f / corner.w;
+            return {center_x + corner.x * inv_w * half_width, center_y - corner.y * inv_w * half_height,
+                    corner.z * inv_w, inv_w, corner.intensity, corner.u, corner.v};
+        }
+    };
+}
+
+Matrix graphics::ProjectionFromViewPort(const Canvas& canvas, float near) {
+    const float d = canvas.GetDistance();
+    Matrix projection{};
+    projection.m0 = 2.0f * d / canvas.GetViewWidth();
+    projection.m5 = 2.0f * d / canvas.GetViewHeight();
+    projection.m10 = 1.0f;
+    projection.m14 = -near;
+    projection.m11 = 1.0f;
+    return projection;
+}
+
+void ClipVertexBuffer::Resize(size_t vertex_count) {
+    const size_t padded = simd::PaddedSize(vertex_count);
+    count = vertex_count;
+    x.resize(padded, 0.0f);
+    y.resize(padded, 0.0f);
+    z.resize(padded, 0.0f);
+    w.resize(padded, 1.0f);
+    intensity.resize(padded, 1.0f);
+    u.resize(padded, 0.0f);
+    v.resize(padded, 0.0f);
+}
+
+Clipper::Clipper(const Canvas& canvas) : canvas(canvas) {}
+
+size_t Clipper::Clip(const ClipVertexBuffer& vertices, const uint32_t* indices, size_t triangle_count, Color color,
+                     const TextureMap* texture, std::vector<ScreenTriangle>& out) {
+    GRAPHICS_PROFILE_ZONE("Clip");
+    const Canvas& target = canvas.get();
+    const int width = target.GetWidth();
+    const int height = target.GetHeight();
+    // The guard band spans as many pixels as the rasterizer's largest
+    // triangle, a little less so rounding cannot push one over
+    const float guard_x = std::max(1.0f, 0.99f * Rasterizer::kMaxExtent / static_cast<float>(width));
+    const float guard_y = std::max(1.0f, 0.99f * Rasterizer::kMaxExtent / static_cast<float>(height));
+
+    const ScreenMapping mapping{static_cast<float>(width / 2) + 0.5f, static_cast<float>(height / 2) + 0.5f,
+                                0.5f * static_cast<float>(width), 0.5f * static_cast<float>(height)};
+
+    // Outcodes and screen positions of all vertices, eight at a time. The
+    // positions are used only by triangles that need no clipping, whose
+    // vertices are all in front of the near plane.
+    {
+        GRAPHICS_PROFILE_ZONE("Outcodes");
+        using namespace simd;
+        const size_t padded = PaddedSize(vertices.count);
+        outcodes.resize(padded);
+        screen_x.resize(padded);
+        screen_y.resize(padded);
+        screen_z.resize(padded);
+        screen_inv_w.resize(padded);
+        const Float8 zero = Float8::Zero();
+        const Float8 band_x = Float8::Broadcast(guard_x);
+        const Float8 band_y = Float8::Broadcast(guard_y);
+        const Float8 one = Float8::Broadcast(1.0f);
+        const Float8 center_x = Float8::Broadcast(mapping.center_x);
+        const Float8 center_y = Float8::Broadcast(mapping.center_y);
+        const Float8 half_width = Float8::Broadcast(mapping.half_width);
+        const Float8 half_height = Float8::Broadcast(mapping.half_height);
+        const auto bit = [zero](Mask8 outside, uint16_t value) {
+            return Select(outside, Float8::Broadcast(value), zero);
+        };
+        float codes[kWidth];
+        for (size_t i = 0; i < padded; i += kWidth) {
+            const Float8 x = Float8::Load(vertices.x.data() + i);
+            const Float8 y = Float8::Load(vertices.y.data() + i);
+            const Float8 z = Float8::Load(vertices.z.data() + i);
+            const Float8 w = Float8::Load(vertices.w.data() + i);
+            const Float8 gx = band_x * w;
+            const Float8 gy = band_y * w;
+            // the bits add up exactly in float
+            const Float8 code = bit(x < zero - w, kLeft) + bit(x > w, kRight) + bit(y < zero - w, kBottom) +
+                                bit(y > w, kTop) + bit(z < zero, kNear) + bit(x < zero - gx, kGuardLeft) +
+                                bit(x > gx, kGuardRight) + bit(y < zero - gy, kGuardBottom) + bit(y > gy, kGuardTop);
+            code.Store(codes);
+            for (int lane = 0; lane < kWidth; lane++)
+                outcodes[i + lane] = static_cast<uint16_t>(codes[lane]);
+
+            const Float8 inv_w = one / w;
+            MulAdd(x * inv_w, half_width, center_x).Store(screen_x.data() + i);
+            (center_y - y * inv_w * half_height).Store(screen_y.data() + i);
+            (z * inv_w).Store(screen_z.data() + i);
+            inv_w.Store(screen_inv_w.data() + i);
+        }
+    }
+
+    const auto projected = [&](uint32_t index) {
+        return ScreenVertex{screen_x[index], screen_y[index], screen_z[index], screen_inv_w[index], vertices.intensity[index],
+                            vertices.u[index], vertices.v[index]};
+    };
+    const auto corner = [&vertices](uint32_t index) {
+        return Corner{vertices.x[index], vertices.y[index], vertices.z[index], vertices.w[index], vertices.intensity[index],
+                      vertices.u[index], vertices.v[index]};
+    };
+
+    const size_t first = out.size();
+    int back_facing = 0;
+    for (size_t t = 0; t < triangle_count; t++) {
+        const uint32_t* triangle = indices + 3 * t;
+        const size_t lane = t % simd::kWidth;
+        if (cull_back_faces && lane == 0)
+            back_facing = BackFacing(vertices, triangle, std::min<size_t>(simd::kWidth, triangle_count - t));
+        if (back_facing & (1 << lane)) {
+            GRAPHICS_STAT_INC(BackFaces);
+            continue;
+        }
+        const uint16_t c0 = outcodes[triangle[0]];
+        const uint16_t c1 = outcodes[triangle[1]];
+        const uint16_t c2 = outcodes[triangle[2]];
+        if (c0 & c1 & c2 & kFrustum) {
+            GRAPHICS_STAT_INC(TrianglesRejected);
+            continue;
+        }
+
+        const uint16_t crossed = (c0 | c1 | c2) & kMustClip;
+        if (!crossed) {
+            out.push_back({{projected(triangle[0]), projected(triangle[1]), projected(triangle[2])}, color, texture});
+            continue;
+        }
+
+        GRAPHICS_STAT_INC(TrianglesClipped);
+        Corner polygon[kMaxCorners] = {corner(triangle[0]), corner(triangle[1]), corner(triangle[2])};
+        Corner clipped[kMaxCorners];
+        int count = 3;
+        for (const uint16_t plane : kClipPlanes) {
+            if (!(crossed & plane))
+                continue;
+            count = ClipPolygon(polygon, count, clipped, plane, guard_x, guard_y);
+            std::copy(clipped, clipped + count, polygon);
+        }
+        if (count < 3)
+            continue;
+        const ScreenVertex pivot = mapping.Project(polygon[0]);
+        ScreenVertex previous = mapping.Project(polygon[1]);
+        for (int i = 2; i < count; i++) {
+            const ScreenVertex next = mapping.Project(polygon[i]);
+            out.push_back({{pivot, previous, next}, color, texture});
+            previous = next;
+        }
+    }
+    return out.size() - first;
+}
@@ -0,0 +1,87 @@
+#include "graphics/cost_map.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <iterator>
+
+namespace graphics {
+
+    void CostMap::Reset(int w, int h, CostMetric m) {
+        width = w;
+        height = h;
+        metric = m;
+        costs.assign(static_cast<size_t>(w) * h, 0);
+    }
+
+    std::vector<uint64_t> CostMap::TileCosts(int tile_size) const {
+        const int tiles_x = (width + tile_size - 1) / tile_size;
+        const int tiles_y = (height + tile_size - 1) / tile_size;
+
+        std::vector<uint64_t> tiles(static_cast<size_t>(tiles_x) * tiles_y, 0);
+        for (int y = 0; y < height; y++)
+            for (int x = 0; x < width; x++)
+                tiles[(y / tile_size) * tiles_x + x / tile_size] += Get(x, y);
+        return tiles;
+    }
+
+    Color HeatmapColor(float value) {
+        // black -> blue -> cyan -> green -> yellow -> red
+        static const Color ramp[] = {
+            {0, 0, 0, 255}, {0, 0, 255, 255}, {0, 255, 255, 255},
+            {0, 255, 0, 255}, {255, 255, 0, 255}, {255, 0, 0, 255},
+        };
+        constexpr int segments = static_cast<int>(std::size(ramp)) - 1;
+
+        const float position = std::clamp(value, 0.0f, 1.0f) * segments;
+        const int index = std::min(static_cast<int>(position), segments - 1);
+        const float f = position - static_cast<float>(index);
+
+        const Color& a = ramp[index];
+        const Color& b = ramp[index + 1];
+        return Color{
+            static_cast<unsigned char>(a.r + (b.r - a.r) * f),
+            static_cast<unsigned char>(a.g + (b.g - a.g) * f),
+            static_cast<unsigned char>(a.b + (b.b - a.b) * f),
+            255};
+    }
+
+    void CostMap::Draw(Canvas& canvas, int tile_size) const {
+        const int tiles_x = (width + tile_size - 1) / tile_size;
+        const std::vector<uint64_t> tiles = tile_size == 1 ? costs : TileCosts(tile_size);
+        if (tiles.empty())
+            return;
+
+        const auto [lowest, highest] = std::minmax_element(tiles.begin(), tiles.end());
+        const double low = std::log1p(static_cast<double>(*lowest));
+        const double range = std::log1p(static_cast<double>(*highest)) - low;
+
+        for (int y = 0; y < height; y++) {
+            for (int x = 0; x < width; x++) {
+                const uint64_t cost = tiles[(y / tile_size) * tiles_x + x / tile_size];
+                const double value = range > 0.0 ? (std::log1p(static_cast<double>(cost)) - low) / range : 0.0;
+                canvas.PutPixel(x, y, HeatmapColor(static_cast<float>(value)));
+            }
+        }
+    }
+
+    bool CostMap::ExportCsv(const std::string& path, int tile_size) const {
+        std::ofstream file(path);
+        if (!file)
+            return false;
+
+        const int tiles_x = (width + tile_size - 1) / tile_size;
+        const int tiles_y = (height + tile_size - 1) / tile_size;
+        const std::vector<uint64_t> tiles = tile_size == 1 ? costs : TileCosts(tile_size);
+
+        file << "# metric=" << (metric == CostMetric::Cycles ? "cycles" : "intersection_tests")
+             << " width=" << width << " height=" << height << " tile_size=" << tile_size << "\n";
+        for (int ty = 0; ty < tiles_y; ty++) {
+            for (int tx = 0; tx < tiles_x; tx++)
+                file << (tx ? "," : "") << tiles[ty * tiles_x + tx];
+            file << "\n";
+        }
+        return static_cast<bool>(file);
+    }
+
+} // namespace graphics
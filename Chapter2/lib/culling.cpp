@@ -0,0 +1,77 @@
+#include "graphics/culling.hpp"
+#include "graphics/profiler.hpp"
+#include "graphics/simd.hpp"
+#include "graphics/stats.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+using namespace graphics;
+
+void BoundingSphereBuffer::Resize(size_t sphere_count) {
+    const size_t padded = simd::PaddedSize(sphere_count);
+    count = sphere_count;
+    x.resize(padded, 0.0f);
+    y.resize(padded, 0.0f);
+    z.resize(padded, 0.0f);
+    radius.resize(padded, 0.0f);
+}
+
+Frustum::Frustum(const Matrix& to_clip) {
+    // rows of the matrix, the clip coordinates as functions of the point
+    const float row_x[4] = {to_clip.m0, to_clip.m4, to_clip.m8, to_clip.m12};
+    const float row_y[4] = {to_clip.m1, to_clip.m5, to_clip.m9, to_clip.m13};
+    const float row_z[4] = {to_clip.m2, to_clip.m6, to_clip.m10, to_clip.m14};
+    const float row_w[4] = {to_clip.m3, to_clip.m7, to_clip.m11, to_clip.m15};
+    // w + x, w - x, w + y, w - y and z, all >= 0 inside
+    const float signs[kPlaneCount][4] = {{1, 1, 0, 0}, {1, -1, 0, 0}, {1, 0, 1, 0}, {1, 0, -1, 0}, {0, 0, 0, 1}};
+    for (int plane = 0; plane < kPlaneCount; plane++) {
+        float coefficients[4];
+        for (int i = 0; i < 4; i++)
+            coefficients[i] = signs[plane][0] * row_w[i] + signs[plane][1] * row_x[i] + signs[plane][2] * row_y[i] +
+                              signs[plane][3] * row_z[i];
+        const float length = std::sqrt(coefficients[0] * coefficients[0] + coefficients[1] * coefficients[1] +
+                                       coefficients[2] * coefficients[2]);
+        const float scale = length > 0.0f ? 1.0f / length : 0.0f;
+        a[plane] = coefficients[0] * scale;
+        b[plane] = coefficients[1] * scale;
+        c[plane] = coefficients[2] * scale;
+        d[plane] = coefficients[3] * scale;
+    }
+}
+
+bool Frustum::Intersects(Vector3 center, float radius) const {
+    for (int plane = 0; plane < kPlaneCount; plane++)
+        if (a[plane] * center.x + b[plane] * center.y + c[plane] * center.z + d[plane] < -radius)
+            return false;
+    return true;
+}
+
+size_t Frustum::Cull(const BoundingSphereBuffer& spheres, std::vector<uint32_t>& visible) const {
+    GRAPHICS_PROFILE_ZONE("CullSpheres");
+    using namespace simd;
+    visible.clear();
+    const Float8 zero = Float8::Zero();
+    for (size_t i = 0; i < spheres.count; i += kWidth) {
+        const Float8 x = Float8::Load(spheres.x.data() + i);
+        const Float8 y = Float8::Load(spheres.y.data() + i);
+        const Float8 z = Float8::Load(spheres.z.data() + i);
+        const Float8 neg_radius = zero - Float8::Load(spheres.radius.data() + i);
+        const auto outside_plane = [&](int plane) {
+            const Float8 distance = MulAdd(Float8::Broadcast(a[plane]), x,
+                                           MulAdd(Float8::Broadcast(b[plane]), y,
+                                                  MulAdd(Float8::Broadcast(c[plane]), z, Float8::Broadcast(d[plane]))));
+            return distance < neg_radius;
+        };
+        Mask8 outside = outside_plane(0);
+        for (int plane = 1; plane < kPlaneCount; plane++)
+            outside = outside | outside_plane(plane);
+        const int bits = ~MoveMask(outside);
+        const size_t lanes = std::min<size_t>(kWidth, spheres.count - i);
+        for (size_t lane = 0; lane < lanes; lane++)
+            if (bits & (1 << lane))
+                visible.push_back(static_cast<uint32_t>(i + lane));
+    }
+    GRAPHICS_STAT_ADD(SpheresCulled, spheres.count - visible.size());
+    return visible.size();
+}
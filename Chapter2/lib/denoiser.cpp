@@ -0,0 +1,144 @@
+#include "graphics/denoiser.hpp"
+#include "graphics/parallel.hpp"
+#include "graphics/profiler.hpp"
+#include "graphics/simd.hpp"
+
+#include <algorithm>
+
+using namespace graphics;
+
+namespace {
+    // B3-spline taps, the kernel of every pass is their outer product
+    constexpr float kKernel[5] = {1.0f / 16.0f, 1.0f / 4.0f, 3.0f / 8.0f, 1.0f / 4.0f, 1.0f / 16.0f};
+
+    // keeps black surfaces from dividing by zero; added back when remodulating
+    constexpr float kAlbedoEpsilon = 0.01f;
+
+    /**
+     * Padding needed around the image: the last pass reads 2 * 2^(iterations - 1)
+     * pixels away, and the last block of a row may run up to a vector past the border.
+     */
+    int MarginFor(int iterations) {
+        return std::max(1 << std::max(iterations, 1), simd::kWidth);
+    }
+}
+
+void Denoiser::Resize(int w, int h) {
+    width = w;
+    height = h;
+    margin = MarginFor(config.iterations);
+    stride = static_cast<int>(simd::PaddedSize(static_cast<size_t>(width) + 2 * margin));
+    const size_t size = static_cast<size_t>(stride) * (height + 2 * margin);
+
+    for (auto& planes : irradiance)
+        for (auto& plane : planes)
+            plane.assign(size, 0.0f);
+    for (int c = 0; c < 3; c++) {
+        normal[c].assign(size, 0.0f);
+        albedo[c].assign(size, 0.0f);
+    }
+    depth.assign(size, 0.0f);
+    valid.assign(size, 0.0f);
+}
+
+void Denoiser::FilterRow(int source, int step, float sigma_color, int y) {
+    using namespace simd;
+
+    const float* const in[3] = {irradiance[source][0].data(), irradiance[source][1].data(), irradiance[source][2].data()};
+    float* const out[3] = {irradiance[1 - source][0].data(), irradiance[1 - source][1].data(), irradiance[1 - source][2].data()};
+
+    const Float8 inv_color = Float8::Broadcast(1.0f / (sigma_color * sigma_color));
+    const Float8 inv_normal = Float8::Broadcast(1.0f / (config.sigma_normal * config.sigma_normal));
+    const Float8 inv_albedo = Float8::Broadcast(1.0f / (config.sigma_albedo * config.sigma_albedo));
+    const Float8 one = Float8::Broadcast(1.0f);
+    const Float8 zero = Float8::Zero();
+
+    for (int x = 0; x < width; x += kWidth) {
+        const size_t center = Index(x, y);
+        Float8 ci[3], cn[3], ca[3], color_scale[3];
+        for (int c = 0; c < 3; c++) {
+            ci[c] = Float8::Load(in[c] + center);
+            cn[c] = Float8::Load(normal[c].data() + center);
+            ca[c] = Float8::Load(albedo[c].data() + center);
+            // compare colors rather than irradiances, which dark albedos blow up
+            const Float8 modulation = ca[c] + Float8::Broadcast(kAlbedoEpsilon);
+            color_scale[c] = modulation * modulation * inv_color;
+        }
+        const Float8 cz = Float8::Load(depth.data() + center);
+        const Mask8 inside = Float8::Load(valid.data() + center) > zero;
+        // depth differences are relative, so far surfaces are not over-smoothed
+        const Float8 inv_depth = one / Max(cz * Float8::Broadcast(config.sigma_depth), Float8::Broadcast(1e-6f));
+
+        Float8 sum_w = zero;
+        Float8 sum[3] = {zero, zero, zero};
+        for (int ky = 0; ky < 5; ky++) {
+            for (int kx = 0; kx < 5; kx++) {
+                const ptrdiff_t offset = static_cast<ptrdiff_t>((ky - 2) * step) * stride + (kx - 2) * step;
+                const size_t tap = static_cast<size_t>(static_cast<ptrdiff_t>(center) + offset);
+
+                Float8 ti[3];
+                Float8 distance = zero;
+                for (int c = 0; c < 3; c++) {
+                    ti[c] = Float8::Load(in[c] + tap);
+                    const Float8 di = ti[c] - ci[c];
+                    const Float8 dn = Float8::Load(normal[c].data() + tap) - cn[c];
+                    const Float8 da = Float8::Load(albedo[c].data() + tap) - ca[c];
+                    distance = MulAdd(di * di, color_scale[c], distance);
+                    distance = MulAdd(dn * dn, inv_normal, distance);
+                    distance = MulAdd(da * da, inv_albedo, distance);
+                }
+                const Float8 dz = (Float8::Load(depth.data() + tap) - cz) * inv_depth;
+                distance = MulAdd(dz, dz, distance);
+
+                const Float8 w = ExpNeg(distance) * Float8::Load(valid.data() + tap) * Float8::Broadcast(kKernel[ky] * kKernel[kx]);
+                sum_w = sum_w + w;
+                for (int c = 0; c < 3; c++)
+                    sum[c] = MulAdd(w, ti[c], sum[c]);
+            }
+        }
+
+        // the center tap always counts, except for padding lanes past the right border
+        const Float8 inv_w = one / Max(sum_w, Float8::Broadcast(1e-20f));
+        for (int c = 0; c < 3; c++)
+            Select(inside, sum[c] * inv_w, zero).Store(out[c] + center);
+    }
+}
+
+void Denoiser::Denoise(const DenoiserInput& input, float* const (&output)[3], int threads) {
+    GRAPHICS_PROFILE_ZONE("Denoise");
+    if (input.width != width || input.height != height || MarginFor(config.iterations) != margin)
+        Resize(input.width, input.height);
+
+    ParallelFor(height, threads, [&](int y) {
+        for (int x = 0; x < width; x++) {
+            const size_t from = static_cast<size_t>(y) * width + x;
+            const size_t to = Index(x, y);
+            for (int c = 0; c < 3; c++) {
+                normal[c][to] = input.normal[c][from];
+                albedo[c][to] = input.albedo[c][from];
+                irradiance[0][c][to] = input.color[c][from] / (input.albedo[c][from] + kAlbedoEpsilon);
+            }
+            depth[to] = input.depth[from];
+            valid[to] = 1.0f;
+        }
+    });
+
+    int source = 0;
+    for (int pass = 0; pass < config.iterations; pass++) {
+        const int step = 1 << pass;
+        const float sigma_color = config.sigma_color * input.noise / static_cast<float>(step);
+        ParallelFor(height, threads, [&](int y) {
+            FilterRow(source, step, sigma_color, y);
+        });
+        source = 1 - source;
+    }
+
+    ParallelFor(height, threads, [&](int y) {
+        for (int x = 0; x < width; x++) {
+            const size_t from = Index(x, y);
+            const size_t to = static_cast<size_t>(y) * width + x;
+            for (int c = 0; c < 3; c++)
+                output[c][to] = irradiance[source][c][from] * (input.albedo[c][to] + kAlbedoEpsilon);
+        }
+    });
+}
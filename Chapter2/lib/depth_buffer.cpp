@@ -0,0 +1,61 @@
+#include "graphics/depth_buffer.hpp"
+#include "graphics/simd.hpp"
+
+#include <algorithm>
+#include <limits>
+
+using namespace graphics;
+
+namespace {
+    constexpr float kLaneOffsets[simd::kWidth] = {0, 1, 2, 3, 4, 5, 6, 7};
+    static_assert(simd::kWidth == DepthBuffer::kTileSize, "a tile row is one SIMD vector");
+}
+
+void DepthBuffer::Resize(int w, int h) {
+    width = w;
+    height = h;
+    tiles_x = (w + kTileSize - 1) / kTileSize;
+    tiles_y = (h + kTileSize - 1) / kTileSize;
+    stride = tiles_x * kTileSize;
+    depth.resize(static_cast<size_t>(stride) * tiles_y * kTileSize);
+    tile_min.resize(static_cast<size_t>(tiles_x) * tiles_y);
+    tile_max.resize(tile_min.size());
+    Clear();
+}
+
+void DepthBuffer::Clear() {
+    std::fill(depth.begin(), depth.end(), kFar);
+    std::fill(tile_min.begin(), tile_min.end(), kFar);
+    std::fill(tile_max.begin(), tile_max.end(), kFar);
+}
+
+void DepthBuffer::UpdateTile(int tx, int ty) {
+    using namespace simd;
+    const int x = tx * kTileSize;
+    const int y = ty * kTileSize;
+    const int rows = std::min(kTileSize, height - y);
+    // padding lanes past the right border count for neither bound
+    const Mask8 valid = Float8::Load(kLaneOffsets) < Float8::Broadcast(static_cast<float>(width - x));
+    const Float8 infinity = Float8::Broadcast(std::numeric_limits<float>::infinity());
+
+    Float8 low = infinity;
+    Float8 high = Float8::Zero() - infinity;
+    for (int row = 0; row < rows; row++) {
+        const Float8 values = Float8::Load(Row(y + row) + x);
+        low = Min(low, Select(valid, values, infinity));
+        high = Max(high, Select(valid, values, Float8::Zero() - infinity));
+    }
+
+    float lows[kWidth], highs[kWidth];
+    low.Store(lows);
+    high.Store(highs);
+    SetTileBounds(tx, ty, *std::min_element(lows, lows + kWidth), *std::max_element(highs, highs + kWidth));
+}
+
+bool DepthBuffer::Occluded(int x0, int y0, int x1, int y1, float depth) const {
+    for (int ty = y0 / kTileSize; ty <= y1 / kTileSize; ty++)
+        for (int tx = x0 / kTileSize; tx <= x1 / kTileSize; tx++)
+            if (depth < TileMax(tx, ty))
+                return false;
+    return true;
+}
@@ -0,0 +1,110 @@
+#include "graphics/lights.hpp"
+#include "graphics/simd.hpp"
+#include "raymath.h"
+
+#include <cmath>
+#include <iterator>
+
+namespace graphics {
+
+    void LightList::Add(const Light& light) {
+        if (light.type == LightType::Ambient) {
+            ambient += light.intensity;
+            return;
+        }
+
+        const std::size_t padded = simd::PaddedSize(count + 1);
+        if (padded != x.size()) {
+            // padding lanes: zero intensity, and zero vectors so they never pass the n_dot_l > 0 test
+            x.resize(padded, 0.0f);
+            y.resize(padded, 0.0f);
+            z.resize(padded, 0.0f);
+            w.resize(padded, 0.0f);
+            intensity.resize(padded, 0.0f);
+        }
+
+        x[count] = light.vector.x;
+        y[count] = light.vector.y;
+        z[count] = light.vector.z;
+        w[count] = light.type == LightType::Point ? 1.0f : 0.0f;
+        intensity[count] = light.intensity;
+        count++;
+    }
+
+    void LightList::Clear() {
+        ambient = 0.0f;
+        count = 0;
+        x.clear();
+        y.clear();
+        z.clear();
+        w.clear();
+        intensity.clear();
+    }
+
+    Light LightList::Get(std::size_t index) const {
+        return {w[index] != 0.0f ? LightType::Point : LightType::Directional, intensity[index], {x[index], y[index], z[index]}};
+    }
+
+    void LightList::ComputeTerms(const Vector3& point, const Vector3& normal, const Vector3& view, float specular, float* terms) const {
+        using namespace simd;
+
+        const Float8 px = Float8::Broadcast(point.x), py = Float8::Broadcast(point.y), pz = Float8::Broadcast(point.z);
+        const Float8 nx = Float8::Broadcast(normal.x), ny = Float8::Broadcast(normal.y), nz = Float8::Broadcast(normal.z);
+        const Float8 vx = Float8::Broadcast(view.x), vy = Float8::Broadcast(view.y), vz = Float8::Broadcast(view.z);
+        const Float8 view_length = Float8::Broadcast(Vector3Length(view));
+        const Float8 zero = Float8::Zero();
+        const Float8 two = Float8::Broadcast(2.0f);
+        const bool shiny = specular != -1.0f;
+        const auto exponent = static_cast<unsigned>(std::lround(std::fmax(specular, 0.0f)));
+        // cosines below this give highlights under 1e-6; zeroing them keeps the
+        // repeated squaring in PowInt away from denormals, which are very slow
+        const Float8 cutoff = Float8::Broadcast(shiny && exponent > 0 ? std::exp2(std::log2(1e-6f) / static_cast<float>(exponent)) : 0.0f);
+
+        for (std::size_t i = 0; i < x.size(); i += kWidth) {
+            const Float8 w8 = Float8::Load(&w[i]);
+            const Float8 i8 = Float8::Load(&intensity[i]);
+
+            // L = light - w * P: towards a point light, or the directional light's own vector
+            const Float8 lx = Float8::Load(&x[i]) - w8 * px;
+            const Float8 ly = Float8::Load(&y[i]) - w8 * py;
+            const Float8 lz = Float8::Load(&z[i]) - w8 * pz;
+            const Float8 l_length = Sqrt(MulAdd(lx, lx, MulAdd(ly, ly, lz * lz)));
+
+            // Diffuse: N is a unit vector, so <N, L> / (|N| |L|) = <N, L> / |L|
+            const Float8 n_dot_l = MulAdd(nx, lx, MulAdd(ny, ly, nz * lz));
+            const Mask8 lit = n_dot_l > zero;
+            Float8 term = Select(lit, i8 * n_dot_l / l_length, zero);
+
+            if (shiny) {
+                // R = 2 N <N, L> - L, and |R| = |L| because N is a unit vector
+                const Float8 rx = MulSub(two * nx, n_dot_l, lx);
+                const Float8 ry = MulSub(two * ny, n_dot_l, ly);
+                const Float8 rz = MulSub(two * nz, n_dot_l, lz);
+                const Float8 r_dot_v = MulAdd(rx, vx, MulAdd(ry, vy, rz * vz));
+                const Float8 cosine = r_dot_v / (l_length * view_length);
+                const Mask8 reflects = (r_dot_v > zero) & (cosine > cutoff);
+                term = term + Select(reflects, i8 * PowInt(Select(reflects, cosine, zero), exponent), zero);
+            }
+
+            term.Store(&terms[i]);
+        }
+    }
+
+    float LightList::ComputeLighting(const Vector3& point, const Vector3& normal, const Vector3& view, float specular) const {
+        float terms[256];
+        std::vector<float> heap_terms;
+        float* out = terms;
+        if (x.size() > std::size(terms)) {
+            heap_terms.resize(x.size());
+            out = heap_terms.data();
+        }
+
+        ComputeTerms(point, normal, view, specular, out);
+
+        float total = ambient;
+        for (std::size_t i = 0; i < x.size(); i++)
+            total += out[i];
+        return total;
+    }
+
+} // namespace graphics
@@ -0,0 +1,320 @@
+#include "graphics/mesh.hpp"
+#include "graphics/profiler.hpp"
+#include "graphics/simd.hpp"
+#include "graphics/stats.hpp"
+#include "raymath.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+using namespace graphics;
+
+namespace {
+    constexpr int kCacheSize = VertexStage::kCacheSize;
+    constexpr uint32_t kNone = std::numeric_limits<uint32_t>::max();
+
+    static_assert(kCacheSize % simd::kWidth == 0, "the cache is searched eight entries at a time");
+    static_assert((kCacheSize & (kCacheSize - 1)) == 0, "FIFO positions wrap with a mask");
+
+    /**
+     * The post-transform cache: the last kCacheSize vertices that missed,
+     * each with the slot its transformed copy went to. With AVX2 a lookup
+     * compares all the entries at once, without the unpredictable branches
+     * of a loop that stops at the match. Without it the entries are
+     * compared one by one, newest first, and the scan stops at the match:
+     * in a reordered mesh most hits are among the last few vertices cached,
+     * and only misses pay for all of them.
+     */
+    class FifoCache {
+        uint32_t vertices[kCacheSize];
+        uint32_t slots[kCacheSize];
+        int next = 0;
+
+    public:
+        FifoCache() { std::fill_n(vertices, kCacheSize, kNone); }
+
+        [[nodiscard]] uint32_t Find(uint32_t vertex) const {
+#if GRAPHICS_SIMD_AVX2
+            uint32_t bits = 0;
+            for (int i = 0; i < kCacheSize; i += simd::kWidth)
+                bits |= static_cast<uint32_t>(simd::EqualMask(vertices + i, vertex)) << i;
+            if (bits == 0)
+                return kNone;
+            // a vertex is cached once at most, so one bit is set; a de Bruijn
+            // sequence times that power of two has its index in the top 5 bits
+            static constexpr int kBitIndex[32] = {0,  1,  28, 2,  29, 14, 24, 3,  30, 22, 20, 15, 25, 17, 4,  8,
+                                                  31, 27, 13, 23, 21, 19, 16, 7,  26, 12, 18, 6,  11, 5,  10, 9};
+            return slots[kBitIndex[((bits & (0u - bits)) * 0x077CB531u) >> 27]];
+#else
+            for (int age = 1; age <= kCacheSize; age++) {
+                const int entry = (next - age) & (kCacheSize - 1);
+                if (vertices[entry] == vertex)
+                    return slots[entry];
+            }
+            return kNone;
+#endif
+        }
+
+        void Insert(uint32_t vertex, uint32_t slot) {
+            vertices[next] = vertex;
+            slots[next] = slot;
+            next = next + 1 < kCacheSize ? next + 1 : 0;
+        }
+    };
+
+    // Forsyth's tuned scoring constants
+    constexpr float kCacheDecayPower = 1.5f;
+    constexpr float kLastTriangleScore = 0.75f;
+    constexpr float kValenceBoostScale = 2.0f;
+    constexpr float kValenceBoostPower = 0.5f;
+
+    /**
+     * Score of a vertex at a position of the modelled LRU cache (-1 when it
+     * is not cached) with some triangles left to draw. The corners of the
+     * last triangle score a bit less than the next few entries, so the order
+     * does not keep turning around one vertex; vertices with few triangles
+     * left get a boost, to finish them off and free their slot.
+     */
+    float VertexScore(int cache_position, uint32_t remaining) {
+        if (remaining == 0)
+            return -1.0f;
+        float score = 0.0f;
+        if (cache_position >= 0) {
+            if (cache_position < 3)
+                score = kLastTriangleScore;
+            else
+                score = std::pow(1.0f - static_cast<float>(cache_position - 3) / (kCacheSize - 3), kCacheDecayPower);
+        }
+        return score + kValenceBoostScale * std::pow(static_cast<float>(remaining), -kValenceBoostPower);
+    }
+
+    /**
+     * Triangle order by Forsyth's algorithm, as an index list.
+     */
+    std::vector<uint32_t> ForsythOrder(const std::vector<uint32_t>& indices, size_t vertex_count) {
+        const size_t triangle_count = indices.size() / 3;
+
+        // the triangles of each vertex; the first remaining[v] are still to draw
+        std::vector<uint32_t> remaining(vertex_count, 0);
+        for (const uint32_t index : indices)
+            remaining[index]++;
+        std::vector<size_t> first(vertex_count + 1, 0);
+        for (size_t v = 0; v < vertex_count; v++)
+            first[v + 1] = first[v] + remaining[v];
+        std::vector<uint32_t> triangles_of(indices.size());
+        {
+            std::vector<size_t> fill(first.begin(), first.end() - 1);
+            for (size_t i = 0; i < indices.size(); i++)
+                triangles_of[fill[indices[i]]++] = static_cast<uint32_t>(i / 3);
+        }
+
+        std::vector<int> cache_position(vertex_count, -1);
+        std::vector<float> vertex_score(vertex_count);
+        for (size_t v = 0; v < vertex_count; v++)
+            vertex_score[v] = VertexScore(-1, remaining[v]);
+
+        std::vector<float> triangle_score(triangle_count);
+        std::vector<bool> drawn(triangle_count, false);
+        uint32_t best = kNone;
+        float best_score = -1.0f;
+        for (size_t t = 0; t < triangle_count; t++) {
+            const uint32_t* corners = indices.data() + 3 * t;
+            triangle_score[t] = vertex_score[corners[0]] + vertex_score[corners[1]] + vertex_score[corners[2]];
+            if (triangle_score[t] > best_score) {
+                best_score = triangle_score[t];
+                best = static_cast<uint32_t>(t);
+            }
+        }
+
+        std::vector<uint32_t> order;
+        order.reserve(indices.size());
+        // the modelled cache, plus room for the three vertices pushed out by a triangle
+        uint32_t cache[kCacheSize + 3];
+        int cache_count = 0;
+        size_t next_undrawn = 0;
+        for (size_t drawn_count = 0; drawn_count < triangle_count; drawn_count++) {
+            if (best == kNone) {
+                // nothing cached has triangles left: start over from the next one in the input
+                while (drawn[next_undrawn])
+                    next_undrawn++;
+                best = static_cast<uint32_t>(next_undrawn);
+            }
+            drawn[best] = true;
+            const uint32_t* corners = indices.data() + 3 * best;
+            order.insert(order.end(), corners, corners + 3);
+
+            for (int c = 0; c < 3; c++) {
+                const uint32_t v = corners[c];
+                uint32_t* list = triangles_of.data() + first[v];
+                uint32_t* end = list + remaining[v];
+                uint32_t* found = std::find(list, end, best);
+                if (found != end) {
+                    std::swap(*found, *(end - 1));
+                    remaining[v]--;
+                }
+            }
+
+            // the corners move to the front of the cache, in order
+            uint32_t updated[kCacheSize + 3];
+            int updated_count = 0;
+            for (int c = 0; c < 3; c++)
+                if (std::find(updated, updated + updated_count, corners[c]) == updated + updated_count)
+                    updated[updated_count++] = corners[c];
+            for (int i = 0; i < cache_count; i++)
+                if (std::find(corners, corners + 3, cache[i]) == corners + 3)
+                    updated[updated_count++] = cache[i];
+
+            for (int i = 0; i < updated_count; i++) {
+                const uint32_t v = updated[i];
+                cache_position[v] = i < kCacheSize ? i : -1;
+                vertex_score[v] = VertexScore(cache_position[v], remaining[v]);
+            }
+            cache_count = std::min(updated_count, kCacheSize);
+            for (int i = 0; i < cache_count; i++)
+                cache[i] = updated[i];
+
+            // only the triangles of these vertices changed score; the next is the best of them
+            best = kNone;
+            best_score = -1.0f;
+            for (int i = 0; i < updated_count; i++) {
+                const uint32_t v = updated[i];
+                for (size_t k = first[v]; k < first[v] + remaining[v]; k++) {
+                    const uint32_t t = triangles_of[k];
+                    const uint32_t* other = indices.data() + 3 * t;
+                    triangle_score[t] = vertex_score[other[0]] + vertex_score[other[1]] + vertex_score[other[2]];
+                    if (triangle_score[t] > best_score) {
+                        best_score = triangle_score[t];
+                        best = t;
+                    }
+                }
+            }
+        }
+        return order;
+    }
+
+    void Permute(std::vector<float>& values, const std::vector<uint32_t>& new_index, size_t count) {
+        std::vector<float> permuted(values.size(), 0.0f);
+        for (size_t i = 0; i < count; i++)
+            permuted[new_index[i]] = values[i];
+        values.swap(permuted);
+    }
+}
+
+void Mesh::Resize(size_t count) {
+    const size_t padded = simd::PaddedSize(count);
+    vertex_count = count;
+    for (auto* values : {&x, &y, &z, &nx, &ny, &nz, &u, &v})
+        values->resize(padded, 0.0f);
+}
+
+Mesh Mesh::UvSphere(Vector3 center, float radius, int slices, int stacks) {
+    Mesh mesh;
+    const int columns = slices + 1;  // the seam is doubled, with u = 0 and u = 1
+    mesh.Resize(static_cast<size_t>(stacks + 1) * columns);
+    for (int i = 0; i <= stacks; i++) {
+        const float tex_v = static_cast<float>(i) / static_cast<float>(stacks);
+        const float theta = PI * tex_v;
+        for (int j = 0; j <= slices; j++) {
+            const float tex_u = static_cast<float>(j) / static_cast<float>(slices);
+            const float phi = 2.0f * PI * tex_u - PI;
+            const Vector3 normal{std::sin(theta) * std::cos(phi), std::cos(theta), std::sin(theta) * std::sin(phi)};
+            mesh.SetVertex(static_cast<size_t>(i) * columns + j, Vector3Add(center, Vector3Scale(normal, radius)), normal,
+                           tex_u, tex_v);
+        }
+    }
+
+    // quads of corners a, b above c, d; the triangle touching a pole by two corners is dropped
+    for (int i = 0; i < stacks; i++) {
+        for (int j = 0; j < slices; j++) {
+            const auto a = static_cast<uint32_t>(i * columns + j);
+            const uint32_t b = a + 1;
+            const uint32_t c = a + columns;
+            const uint32_t d = c + 1;
+            if (i > 0)
+                mesh.indices.insert(mesh.indices.end(), {a, c, b});
+            if (i < stacks - 1)
+                mesh.indices.insert(mesh.indices.end(), {b, c, d});
+        }
+    }
+    return mesh;
+}
+
+void graphics::OptimizeVertexCache(Mesh& mesh) {
+    GRAPHICS_PROFILE_ZONE("OptimizeVertexCache");
+    mesh.indices = ForsythOrder(mesh.indices, mesh.vertex_count);
+
+    // vertices in order of first use, the unused ones last
+    std::vector<uint32_t> new_index(mesh.vertex_count, kNone);
+    uint32_t next = 0;
+    for (uint32_t& index : mesh.indices) {
+        if (new_index[index] == kNone)
+            new_index[index] = next++;
+        index = new_index[index];
+    }
+    for (uint32_t& index : new_index)
+        if (index == kNone)
+            index = next++;
+
+    for (auto* values : {&mesh.x, &mesh.y, &mesh.z, &mesh.nx, &mesh.ny, &mesh.nz, &mesh.u, &mesh.v})
+        Permute(*values, new_index, mesh.vertex_count);
+}
+
+float graphics::AverageCacheMissRatio(const uint32_t* indices, size_t triangle_count) {
+    if (triangle_count == 0)
+        return 0.0f;
+    FifoCache cache;
+    size_t misses = 0;
+    for (size_t i = 0; i < 3 * triangle_count; i++) {
+        if (cache.Find(indices[i]) == kNone) {
+            cache.Insert(indices[i], 0);
+            misses++;
+        }
+    }
+    return static_cast<float>(misses) / static_cast<float>(triangle_count);
+}
+
+size_t VertexStage::Process(const Mesh& mesh, const Matrix& to_clip, ClipVertexBuffer& out,
+                            std::vector<uint32_t>& out_indices) const {
+    GRAPHICS_PROFILE_ZONE("VertexStage");
+    const size_t index_count = mesh.GetTriangleCount() * 3;
+    out_indices.resize(index_count);
+    // most vertices miss once; grown below when some miss again
+    size_t capacity = std::min(mesh.vertex_count, index_count);
+    out.Resize(capacity);
+
+    FifoCache cache;
+    uint32_t transformed = 0;
+    for (size_t i = 0; i < index_count; i++) {
+        const uint32_t vertex = mesh.indices[i];
+        uint32_t slot = cache.Find(vertex);
+        if (slot == kNone) {
+            if (transformed == capacity) {
+                capacity = std::min(2 * capacity, index_count);
+                out.Resize(capacity);
+            }
+            slot = transformed++;
+            cache.Insert(vertex, slot);
+
+            const Vector3 position{mesh.x[vertex], mesh.y[vertex], mesh.z[vertex]};
+            out.x[slot] = to_clip.m0 * position.x + to_clip.m4 * position.y + to_clip.m8 * position.z + to_clip.m12;
+            out.y[slot] = to_clip.m1 * position.x + to_clip.m5 * position.y + to_clip.m9 * position.z + to_clip.m13;
+            out.z[slot] = to_clip.m2 * position.x + to_clip.m6 * position.y + to_clip.m10 * position.z + to_clip.m14;
+            out.w[slot] = to_clip.m3 * position.x + to_clip.m7 * position.y + to_clip.m11 * position.z + to_clip.m15;
+            if (lights) {
+                const Vector3 normal{mesh.nx[vertex], mesh.ny[vertex], mesh.nz[vertex]};
+                out.intensity[slot] = lights->ComputeLighting(position, normal, Vector3Subtract(camera, position), -1.0f);
+            } else {
+                out.intensity[slot] = 1.0f;
+            }
+            out.u[slot] = mesh.u[vertex];
+            out.v[slot] = mesh.v[vertex];
+        } else {
+            GRAPHICS_STAT_INC(VertexCacheHits);
+        }
+        out_indices[i] = slot;
+    }
+    out.Resize(transformed);
+    GRAPHICS_STAT_ADD(VerticesTransformed, transformed);
+    return transformed;
+}
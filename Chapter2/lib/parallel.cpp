@@ -0,0 +1,78 @@
+#include "graphics/parallel.hpp"
+
+#include <condition_variable>
+#include <mutex>
+#include <vector>
+
+using namespace graphics;
+
+namespace {
+    // whether the calling thread is running a job, to run nested calls inline
+    thread_local bool in_job = false;
+
+    /**
+     * Threads kept between ParallelFor calls. Each call publishes its job
+     * with the number of helpers it wants; idle threads claim one of those
+     * slots each and run the job. The caller runs it too, then withdraws the
+     * slots nobody claimed, so it never waits for a thread to wake up only
+     * to find the work gone, and waits for the ones that did start.
+     */
+    class WorkerPool {
+        std::mutex dispatch;  // one job at a time
+        std::mutex mutex;     // guards everything below
+        std::condition_variable wake;
+        std::condition_variable finished;
+        std::vector<std::thread> threads;
+        const std::function<void()>* job = nullptr;
+        int unclaimed = 0;
+        int running = 0;
+
+        void Work() {
+            in_job = true;
+            std::unique_lock<std::mutex> lock(mutex);
+            for (;;) {
+                wake.wait(lock, [&] { return unclaimed > 0; });
+                unclaimed--;
+                running++;
+                const std::function<void()>& current = *job;
+                lock.unlock();
+                current();
+                lock.lock();
+                if (--running == 0)
+                    finished.notify_one();
+            }
+        }
+
+    public:
+        void Run(int helpers, const std::function<void()>& work) {
+            std::lock_guard<std::mutex> turn(dispatch);
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                while (static_cast<int>(threads.size()) < helpers)
+                    threads.emplace_back([this] { Work(); });
+                job = &work;
+                unclaimed = helpers;
+            }
+            wake.notify_all();
+
+            in_job = true;
+            work();
+            in_job = false;
+
+            std::unique_lock<std::mutex> lock(mutex);
+            unclaimed = 0;
+            finished.wait(lock, [&] { return running == 0; });
+            job = nullptr;
+        }
+    };
+}
+
+void detail::RunOnWorkers(int helpers, const std::function<void()>& job) {
+    if (in_job || helpers <= 0) {
+        job();
+        return;
+    }
+    // never destroyed: the threads stay blocked in Work until the process exits
+    static WorkerPool* const pool = new WorkerPool();
+    pool->Run(helpers, job);
+}
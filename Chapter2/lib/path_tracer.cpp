@@ -0,0 +1,280 @@
+#include "graphics/path_tracer.hpp"
+#include "graphics/parallel.hpp"
+#include "graphics/profiler.hpp"
+#include "graphics/sampling.hpp"
+#include "graphics/stats.hpp"
+#include "raymath.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <limits>
+
+using namespace graphics;
+
+namespace {
+    constexpr float kPi = 3.14159265358979f;
+
+    // depth guide of pixels that see the background, far from every surface
+    constexpr float kBackgroundDepth = 1e6f;
+
+    /**
+     * Draws a direction around a unit normal with density cos(theta) / pi.
+     *
+     * A point picked uniformly on the unit disk and lifted to the hemisphere
+     * has exactly that density (Malley's method). The tangent frame is the
+     * branchless one from Duff et al., "Building an Orthonormal Basis, Revisited".
+     */
+    Vector3 CosineSample(const Vector3& normal, float u1, float u2) {
+        const float sign = std::copysign(1.0f, normal.z);
+        const float a = -1.0f / (sign + normal.z);
+        const float b = normal.x * normal.y * a;
+        const Vector3 tangent{1.0f + sign * normal.x * normal.x * a, sign * b, -sign * normal.x};
+        const Vector3 bitangent{b, sign + normal.y * normal.y * a, -normal.y};
+
+        const float r = std::sqrt(u1);
+        const float phi = 2.0f * kPi * u2;
+        const float x = r * std::cos(phi);
+        const float y = r * std::sin(phi);
+        const float z = std::sqrt(std::max(0.0f, 1.0f - u1));
+        return Vector3Add(Vector3Add(Vector3Scale(tangent, x), Vector3Scale(bitangent, y)), Vector3Scale(normal, z));
+    }
+}
+
+PathTracer::PathTracer(Canvas& canvas, Raytracer& raytracer) : canvas(canvas), raytracer(raytracer) {
+    Reset();
+}
+
+void PathTracer::Reset() {
+    width = canvas.get().GetWidth();
+    height = canvas.get().GetHeight();
+    const size_t pixels = static_cast<size_t>(width) * height;
+    sum_r.assign(pixels, 0.0f);
+    sum_g.assign(pixels, 0.0f);
+    sum_b.assign(pixels, 0.0f);
+    samples.assign(pixels, 0);
+    for (int c = 0; c < 3; c++) {
+        sum_normal[c].assign(pixels, 0.0f);
+        sum_albedo[c].assign(pixels, 0.0f);
+    }
+    sum_depth.assign(pixels, 0.0f);
+    pass = 0;
+}
+
+void PathTracer::TracePath(const Vector3& origin, const Vector3& direction, uint32_t pixel, uint32_t sample, float (&rgb)[3], SurfaceFeatures& features) const {
+    const Raytracer& scene = raytracer.get();
+    const std::vector<Sphere>& spheres = scene.GetSpheres();
+    const LightList& lights = scene.GetLights();
+    const float pixel_angle = canvas.get().GetPixelAngle();
+    const sampling::SampleTable& table = sampling::SampleTable::Instance();
+    // the bounce directions come from the table, the yes/no decisions from the generator
+    sampling::Pcg32 random(pixel, sample);
+
+    rgb[0] = rgb[1] = rgb[2] = 0.0f;
+    float throughput[3] = {1.0f, 1.0f, 1.0f};
+    Vector3 ray_origin = origin;
+    Vector3 ray_direction = direction;
+    float t_min = 1.0f;
+    // until the first diffuse bounce the path is what the camera sees, directly or in mirrors
+    bool diffuse = false;
+
+    for (int bounce = 0; bounce <= config.max_bounces; bounce++) {
+        const Intersection hit = scene.ClosestIntersection(ray_origin, ray_direction, t_min, std::numeric_limits<float>::infinity());
+        if (bounce == 0) {
+            if (hit.sphere < 0) {
+                const Color background = canvas.get().GetBackground();
+                features = {{0, 0, 0}, kBackgroundDepth, {background.r / 255.0f, background.g / 255.0f, background.b / 255.0f}};
+            } else {
+                const Sphere& sphere = spheres[hit.sphere];
+                const Vector3 point = Vector3Add(ray_origin, Vector3Scale(ray_direction, hit.t));
+                const Vector3 normal = Vector3Normalize(Vector3Subtract(point, sphere.center));
+                const Color base = SurfaceColor(sphere, normal, hit.t * Vector3Length(ray_direction) * pixel_angle);
+                features = {normal, hit.t, {base.r / 255.0f, base.g / 255.0f, base.b / 255.0f}};
+            }
+        }
+
+        if (hit.sphere < 0) {
+            if (!diffuse) {
+                const Color background = canvas.get().GetBackground();
+                rgb[0] += throughput[0] * background.r / 255.0f;
+                rgb[1] += throughput[1] * background.g / 255.0f;
+                rgb[2] += throughput[2] * background.b / 255.0f;
+            } else {
+                // the sky: ambient light, now coming from every open direction
+                for (int c = 0; c < 3; c++)
+                    rgb[c] += throughput[c] * lights.Ambient();
+            }
+            return;
+        }
+        if (bounce == config.max_bounces)
+            return;
+
+        const Sphere& sphere = spheres[hit.sphere];
+        const Vector3 point = Vector3Add(ray_origin, Vector3Scale(ray_direction, hit.t));
+        const Vector3 outward = Vector3Normalize(Vector3Subtract(point, sphere.center));
+        const Vector3 normal = Vector3DotProduct(outward, ray_direction) > 0.0f ? Vector3Negate(outward) : outward;
+
+        if (random.Next() < sphere.reflective) {
+            // mirror, chosen with probability r: on average r times what the reflection sees
+            const Vector3 view = Vector3Negate(ray_direction);
+            ray_direction = Vector3Subtract(Vector3Scale(normal, 2.0f * Vector3DotProduct(normal, view)), view);
+            GRAPHICS_STAT_INC(ReflectionRays);
+        } else {
+            const Color base = SurfaceColor(sphere, outward, hit.t * Vector3Length(ray_direction) * pixel_angle);
+            const float albedo[3] = {base.r / 255.0f, base.g / 255.0f, base.b / 255.0f};
+            for (int c = 0; c < 3; c++)
+                throughput[c] *= albedo[c];
+
+            // next event estimation: the light each point or directional light
+            // sends directly, as the book's diffuse term
+            for (size_t i = 0; i < lights.Size(); i++) {
+                const Vector3 towards_light = lights.VectorFrom(i, point);
+                const float n_dot_l = Vector3DotProduct(normal, towards_light);
+                if (n_dot_l <= 0.0f)
+                    continue;
+                if (scene.Occluded(point, towards_light, Raytracer::kSurfaceEpsilon, lights.ShadowDistance(i)))
+                    continue;
+                const float irradiance = lights.Get(i).intensity * n_dot_l / Vector3Length(towards_light);
+                for (int c = 0; c < 3; c++)
+                    rgb[c] += throughput[c] * irradiance;
+            }
+
+            // the BRDF albedo / pi times cos(theta) over the pdf cos(theta) / pi leaves the albedo, already applied
+            const sampling::Sample2D u = table.Get(pixel, sample, 1 + static_cast<uint32_t>(bounce));
+            ray_direction = CosineSample(normal, u.u, u.v);
+            diffuse = true;
+            GRAPHICS_STAT_INC(BounceRays);
+        }
+        ray_origin = point;
+        t_min = Raytracer::kSurfaceEpsilon;
+
+        if (bounce >= config.roulette_depth) {
+            const float survival = std::min(std::max({throughput[0], throughput[1], throughput[2]}), config.max_survival);
+            if (random.Next() >= survival)
+                return;
+            for (float& channel : throughput)
+                channel /= survival;
+        }
+    }
+}
+
+bool PathTracer::RenderPass(const Vector3& origin, double max_seconds) {
+    GRAPHICS_PROFILE_ZONE("PathTracer::RenderPass");
+    Canvas& target = canvas.get();
+    if (target.GetWidth() != width || target.GetHeight() != height)
+        Reset();
+
+    stats::BeginFrame();
+    interrupted.store(false, std::memory_order_relaxed);
+    const auto start = std::chrono::steady_clock::now();
+    const uint32_t sample_index = pass++;
+    // rotate the first row so that cut short passes do not always refine the same rows
+    const int first_row = static_cast<int>((sample_index * 7919u) % static_cast<uint32_t>(height));
+
+    std::atomic<int> rows_done{0};
+    ParallelFor(height, raytracer.get().GetThreadCount(), [&](int i) {
+        if (interrupted.load(std::memory_order_relaxed))
+            return;
+        if (max_seconds > 0.0 && std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count() > max_seconds) {
+            interrupted.store(true, std::memory_order_relaxed);
+            return;
+        }
+
+        const int py = (first_row + i) % height;
+        for (int px = 0; px < width; px++) {
+            const size_t index = static_cast<size_t>(py) * width + px;
+            // the pixel's own count, not the pass, keeps its Sobol points consecutive across cut short passes;
+            // dimension 0 of the sample table places the camera ray in the pixel
+            const uint32_t sample = samples[index];
+            const sampling::Sample2D jitter = sampling::SampleTable::Instance().Get(static_cast<uint32_t>(index), sample, 0);
+            const float x = static_cast<float>(px - width / 2) + jitter.u - 0.5f;
+            const float y = static_cast<float>(height / 2 - py) + jitter.v - 0.5f;
+
+            float rgb[3];
+            SurfaceFeatures features;
+            TracePath(origin, target.CanvasToViewPort(x, y), static_cast<uint32_t>(index), sample, rgb, features);
+            GRAPHICS_STAT_INC(PrimaryRays);
+
+            sum_r[index] += rgb[0];
+            sum_g[index] += rgb[1];
+            sum_b[index] += rgb[2];
+            sum_normal[0][index] += features.normal.x;
+            sum_normal[1][index] += features.normal.y;
+            sum_normal[2][index] += features.normal.z;
+            sum_depth[index] += features.depth;
+            for (int c = 0; c < 3; c++)
+                sum_albedo[c][index] += features.albedo[c];
+            const uint32_t count = ++samples[index];
+            // the denoiser draws the whole image once the pass is over
+            if (denoise)
+                continue;
+
+            const float scale = 255.0f / static_cast<float>(count);
+            target.PutPixel(px, py, Color{
+                static_cast<unsigned char>(std::min(sum_r[index] * scale + 0.5f, 255.0f)),
+                static_cast<unsigned char>(std::min(sum_g[index] * scale + 0.5f, 255.0f)),
+                static_cast<unsigned char>(std::min(sum_b[index] * scale + 0.5f, 255.0f)),
+                255});
+        }
+        rows_done.fetch_add(1, std::memory_order_relaxed);
+    });
+
+    if (denoise)
+        DrawDenoised();
+
+    stats::EndFrame();
+    return rows_done.load() == height;
+}
+
+void PathTracer::DrawDenoised() {
+    const size_t pixels = static_cast<size_t>(width) * height;
+    for (int c = 0; c < 3; c++) {
+        mean_color[c].resize(pixels);
+        mean_normal[c].resize(pixels);
+        mean_albedo[c].resize(pixels);
+        filtered[c].resize(pixels);
+    }
+    mean_depth.resize(pixels);
+
+    const int threads = raytracer.get().GetThreadCount();
+    ParallelFor(height, threads, [&](int y) {
+        for (size_t i = static_cast<size_t>(y) * width; i < static_cast<size_t>(y + 1) * width; i++) {
+            const float inv = samples[i] > 0 ? 1.0f / static_cast<float>(samples[i]) : 0.0f;
+            mean_color[0][i] = sum_r[i] * inv;
+            mean_color[1][i] = sum_g[i] * inv;
+            mean_color[2][i] = sum_b[i] * inv;
+            // an average of unit normals is shorter across edges, which the filter treats as a difference
+            for (int c = 0; c < 3; c++) {
+                mean_normal[c][i] = sum_normal[c][i] * inv;
+                mean_albedo[c][i] = sum_albedo[c][i] * inv;
+            }
+            mean_depth[i] = sum_depth[i] * inv;
+        }
+    });
+
+    DenoiserInput input;
+    input.width = width;
+    input.height = height;
+    input.depth = mean_depth.data();
+    // the noise of an average falls with the square root of its sample count
+    input.noise = 1.0f / std::sqrt(static_cast<float>(std::max(pass, 1u)));
+    for (int c = 0; c < 3; c++) {
+        input.color[c] = mean_color[c].data();
+        input.normal[c] = mean_normal[c].data();
+        input.albedo[c] = mean_albedo[c].data();
+    }
+    float* const output[3] = {filtered[0].data(), filtered[1].data(), filtered[2].data()};
+    denoiser.Denoise(input, output, threads);
+
+    Canvas& target = canvas.get();
+    ParallelFor(height, threads, [&](int y) {
+        for (int x = 0; x < width; x++) {
+            const size_t i = static_cast<size_t>(y) * width + x;
+            target.PutPixel(x, y, Color{
+                static_cast<unsigned char>(std::clamp(filtered[0][i] * 255.0f + 0.5f, 0.0f, 255.0f)),
+                static_cast<unsigned char>(std::clamp(filtered[1][i] * 255.0f + 0.5f, 0.0f, 255.0f)),
+                static_cast<unsigned char>(std::clamp(filtered[2][i] * 255.0f + 0.5f, 0.0f, 255.0f)),
+                255});
+        }
+    });
+}
@@ -0,0 +1,131 @@
+#include "graphics/profiler.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <vector>
+
+namespace graphics::profiler {
+
+    namespace {
+        struct Registry {
+            std::mutex mutex;
+            std::vector<std::unique_ptr<ThreadBuffer>> buffers;
+            // buffers whose thread exited, reused before allocating new ones
+            std::vector<ThreadBuffer*> free;
+
+            // calibration point for Timestamp()
+            uint64_t start_ticks = Timestamp();
+            std::chrono::steady_clock::time_point start_clock = std::chrono::steady_clock::now();
+        };
+
+        Registry& GetRegistry() {
+            static Registry registry;
+            return registry;
+        }
+    }
+
+    ThreadBuffer* AcquireBuffer() {
+        Registry& registry = GetRegistry();
+        std::lock_guard<std::mutex> lock(registry.mutex);
+
+        if (!registry.free.empty()) {
+            // lowest id first, so worker N keeps landing on the same row
+            auto lowest = std::min_element(registry.free.begin(), registry.free.end(),
+                                           [](const ThreadBuffer* a, const ThreadBuffer* b) { return a->id < b->id; });
+            ThreadBuffer* buffer = *lowest;
+            registry.free.erase(lowest);
+            return buffer;
+        }
+
+        registry.buffers.push_back(std::make_unique<ThreadBuffer>());
+        registry.buffers.back()->id = static_cast<int>(registry.buffers.size()) - 1;
+        return registry.buffers.back().get();
+    }
+
+    BufferLease::~BufferLease() {
+        if (buffer == nullptr)
+            return;
+
+        Registry& registry = GetRegistry();
+        std::lock_guard<std::mutex> lock(registry.mutex);
+        registry.free.push_back(buffer);
+    }
+
+    double TicksPerMicrosecond() {
+#if defined(_MSC_VER) || defined(__x86_64__) || defined(__i386__)
+        Registry& registry = GetRegistry();
+
+        // make sure the measured interval is long enough to be precise
+        auto now = std::chrono::steady_clock::now();
+        while (now - registry.start_clock < std::chrono::milliseconds(10))
+            now = std::chrono::steady_clock::now();
+        const uint64_t ticks = Timestamp();
+
+        const double microseconds = std::chrono::duration<double, std::micro>(now - registry.start_clock).count();
+        return static_cast<double>(ticks - registry.start_ticks) / microseconds;
+#else
+        return 1000.0;
+#endif
+    }
+
+    std::string ChromeTraceJson() {
+        const double ticks_per_us = TicksPerMicrosecond();
+
+        Registry& registry = GetRegistry();
+        std::lock_guard<std::mutex> lock(registry.mutex);
+
+        // timestamps are written relative to the first event
+        uint64_t origin = std::numeric_limits<uint64_t>::max();
+        for (const auto& buffer : registry.buffers) {
+            const std::size_t count = buffer->count.load(std::memory_order_acquire);
+            for (std::size_t i = 0; i < count; i++)
+                origin = std::min(origin, buffer->events[i].begin);
+        }
+
+        std::ostringstream json;
+        json.precision(3);
+        json << std::fixed << "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [";
+
+        bool first = true;
+        for (const auto& buffer : registry.buffers) {
+            json << (first ? "" : ",") << "\n{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": " << buffer->id
+                 << ", \"args\": {\"name\": \"thread " << buffer->id
+                 << "\", \"dropped_events\": " << buffer->dropped.load(std::memory_order_relaxed) << "}}";
+            first = false;
+
+            const std::size_t count = buffer->count.load(std::memory_order_acquire);
+            for (std::size_t i = 0; i < count; i++) {
+                const Event& event = buffer->events[i];
+                json << ",\n{\"name\": \"" << event.name << "\", \"ph\": \"X\", \"pid\": 1, \"tid\": " << buffer->id
+                     << ", \"ts\": " << static_cast<double>(event.begin - origin) / ticks_per_us
+                     << ", \"dur\": " << static_cast<double>(event.end - event.begin) / ticks_per_us << "}";
+            }
+        }
+
+        json << "\n]}\n";
+        return json.str();
+    }
+
+    bool WriteChromeTrace(const std::string& path) {
+        std::ofstream file(path);
+        if (!file)
+            return false;
+        file << ChromeTraceJson();
+        return static_cast<bool>(file);
+    }
+
+    void Reset() {
+        Registry& registry = GetRegistry();
+        std::lock_guard<std::mutex> lock(registry.mutex);
+        for (const auto& buffer : registry.buffers) {
+            buffer->count.store(0, std::memory_order_relaxed);
+            buffer->dropped.store(0, std::memory_order_relaxed);
+        }
+    }
+
+} // namespace graphics::profiler
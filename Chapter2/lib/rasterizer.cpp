@@ -0,0 +1,458 @@
+#include "graphics/rasterizer.hpp"
+#include "graphics/parallel.hpp"
+#include "graphics/profiler.hpp"
+#include "graphics/simd.hpp"
+#include "graphics/stats.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+
+using namespace graphics;
+
+namespace {
+    // vertices are snapped to 1/16 of a pixel
+    constexpr int kSubpixelBits = 4;
+    constexpr int64_t kSubpixel = int64_t{1} << kSubpixelBits;
+    constexpr int kTile = Rasterizer::kTileSize;
+    // distance between the first and the last pixel center of a tile, in subpixels
+    constexpr int64_t kTileSpan = (kTile - 1) * kSubpixel;
+
+    constexpr float kLaneOffsets[simd::kWidth] = {0, 1, 2, 3, 4, 5, 6, 7};
+    static_assert(simd::kWidth == kTile, "a tile row is one SIMD vector");
+
+    /**
+     * Edge function E(X, Y) = a*X + b*Y + c of the edge from (x0, y0) to
+     * (x1, y1), in subpixels. With the corners ordered so the triangle's
+     * area is positive, E > 0 on the inner side.
+     */
+    struct Edge {
+        int64_t a, b, c;
+
+        [[nodiscard]] int64_t At(int64_t x, int64_t y) const { return a * x + b * y + c; }
+    };
+
+    Edge MakeEdge(int64_t x0, int64_t y0, int64_t x1, int64_t y1) {
+        Edge edge{y0 - y1, x1 - x0, x0 * y1 - y0 * x1};
+        // Top-left rule: in this winding, a > 0 is a left edge and a == 0, b > 0
+        // a top edge. Pixel centers exactly on any other edge belong to the
+        // neighbouring triangle, which the -1 excludes (all values are integers).
+        const bool top_left = edge.a > 0 || (edge.a == 0 && edge.b > 0);
+        if (!top_left)
+            edge.c -= 1;
+        return edge;
+    }
+
+    /**
+     * Plane f(X, Y) = f0 + dx * (X - x0) + dy * (Y - y0) through the values
+     * of an attribute at the three corners of a triangle, per subpixel.
+     */
+    struct Plane {
+        double f0, dx, dy;
+        int64_t x0, y0;
+
+        [[nodiscard]] double At(int64_t x, int64_t y) const {
+            return f0 + dx * static_cast<double>(x - x0) + dy * static_cast<double>(y - y0);
+        }
+    };
+
+    Plane MakePlane(const float (&f)[3], const int64_t (&x)[3], const int64_t (&y)[3], double inv_area) {
+        const double f1 = f[1] - f[0];
+        const double f2 = f[2] - f[0];
+        return {f[0],
+                (f1 * static_cast<double>(y[2] - y[0]) - f2 * static_cast<double>(y[1] - y[0])) * inv_area,
+                (f2 * static_cast<double>(x[1] - x[0]) - f1 * static_cast<double>(x[2] - x[0])) * inv_area,
+                x[0], y[0]};
+    }
+
+    int64_t Snap(float coordinate) {
+        return std::llround(coordinate * static_cast<float>(kSubpixel));
+    }
+
+    int64_t FloorDiv(int64_t a, int64_t b) {  // b > 0
+        return a >= 0 ? a / b : -((-a + b - 1) / b);
+    }
+
+    /**
+     * Subpixel coordinate of the center of a pixel.
+     */
+    int64_t PixelCenter(int pixel) {
+        return static_cast<int64_t>(pixel) * kSubpixel + kSubpixel / 2;
+    }
+}
+
+Rasterizer::Rasterizer(Canvas& canvas) : canvas(canvas), thread_count(DefaultThreadCount()) {}
+
+void Rasterizer::SetThreadCount(int threads) {
+    thread_count = threads < 1 ? DefaultThreadCount() : threads;
+}
+
+void Rasterizer::ClearDepth() {
+    const Canvas& target = canvas.get();
+    if (depth_buffer.GetWidth() != target.GetWidth() || depth_buffer.GetHeight() != target.GetHeight())
+        depth_buffer.Resize(target.GetWidth(), target.GetHeight());
+    else
+        depth_buffer.Clear();
+}
+
+void Rasterizer::FitDepthBuffer() {
+    const Canvas& target = canvas.get();
+    if (depth_test && (depth_buffer.GetWidth() != target.GetWidth() || depth_buffer.GetHeight() != target.GetHeight()))
+        ClearDepth();
+}
+
+void Rasterizer::DrawTriangle(const ScreenTriangle& triangle) {
+    GRAPHICS_STAT_INC(Triangles);
+    FitDepthBuffer();
+    const Canvas& target = canvas.get();
+    DrawTriangleIn(triangle, 0, 0, target.GetWidth() - 1, target.GetHeight() - 1);
+}
+
+void Rasterizer::DrawTriangleIn(const ScreenTriangle& triangle, int x0, int y0, int x1, int y1) {
+    const ScreenVertex* v = triangle.v;
+    const float min_x = std::min({v[0].x, v[1].x, v[2].x});
+    const float max_x = std::max({v[0].x, v[1].x, v[2].x});
+    const float min_y = std::min({v[0].y, v[1].y, v[2].y});
+    const float max_y = std::max({v[0].y, v[1].y, v[2].y});
+    // also rejects NaN coordinates
+    if (!(max_x - min_x <= kMaxExtent && max_y - min_y <= kMaxExtent))
+        return;
+
+    int64_t x[3], y[3];
+    float z[3], inv_w[3], shade[3], tex_u[3], tex_v[3];
+    for (int i = 0; i < 3; i++) {
+        x[i] = Snap(v[i].x);
+        y[i] = Snap(v[i].y);
+        z[i] = v[i].z;
+        inv_w[i] = v[i].inv_w;
+        shade[i] = v[i].intensity;
+        tex_u[i] = v[i].u;
+        tex_v[i] = v[i].v;
+    }
+    // twice the signed area; flip the winding so the inside is positive
+    const int64_t area = (y[0] - y[1]) * x[2] + (x[1] - x[0]) * y[2] + x[0] * y[1] - y[0] * x[1];
+    if (area == 0)
+        return;
+    if (area < 0) {
+        std::swap(x[1], x[2]);
+        std::swap(y[1], y[2]);
+        std::swap(z[1], z[2]);
+        std::swap(inv_w[1], inv_w[2]);
+        std::swap(shade[1], shade[2]);
+        std::swap(tex_u[1], tex_u[2]);
+        std::swap(tex_v[1], tex_v[2]);
+    }
+
+    // pixels whose centers can be inside, clamped to the rectangle; since it
+    // is made of whole tiles, no tile below crosses its borders
+    Canvas& target = canvas.get();
+    const int width = target.GetWidth();
+    const int height = target.GetHeight();
+    const int64_t half = kSubpixel / 2;
+    const int first_x = static_cast<int>(std::max<int64_t>(x0, -FloorDiv(half - *std::min_element(x, x + 3), kSubpixel)));
+    const int last_x = static_cast<int>(std::min<int64_t>(x1, FloorDiv(*std::max_element(x, x + 3) - half, kSubpixel)));
+    const int first_y = static_cast<int>(std::max<int64_t>(y0, -FloorDiv(half - *std::min_element(y, y + 3), kSubpixel)));
+    const int last_y = static_cast<int>(std::min<int64_t>(y1, FloorDiv(*std::max_element(y, y + 3) - half, kSubpixel)));
+    if (first_x > last_x || first_y > last_y)
+        return;
+
+    const float min_z = std::min({z[0], z[1], z[2]});
+    const float max_z = std::max({z[0], z[1], z[2]});
+    if (depth_test && depth_buffer.Occluded(first_x, first_y, last_x, last_y, min_z)) {
+        GRAPHICS_STAT_INC(TrianglesOccluded);
+        return;
+    }
+
+    const Edge edges[3] = {MakeEdge(x[0], y[0], x[1], y[1]), MakeEdge(x[1], y[1], x[2], y[2]), MakeEdge(x[2], y[2], x[0], y[0])};
+
+    const double inv_area = 1.0 / static_cast<double>(std::llabs(area));
+    const Plane depth_plane = MakePlane(z, x, y, inv_area);
+    // range of the plane over a tile, relative to its value at the tile's first pixel center
+    const double z_tile_low = std::min(0.0, depth_plane.dx * kTileSpan) + std::min(0.0, depth_plane.dy * kTileSpan);
+    const double z_tile_high = std::max(0.0, depth_plane.dx * kTileSpan) + std::max(0.0, depth_plane.dy * kTileSpan);
+
+    // Flat triangles scale their color once. Gouraud shaded and textured ones
+    // interpolate the intensity and texture coordinates, or each of them
+    // over w and 1 / w when the corners' w differ.
+    const TextureMap* const texture = triangle.texture;
+    const bool gouraud = shade[0] != shade[1] || shade[0] != shade[2];
+    const bool shaded = gouraud || texture;
+    const bool perspective = shaded && (inv_w[0] != inv_w[1] || inv_w[0] != inv_w[2]);
+    Color color = triangle.color;
+    if (!shaded && shade[0] != 1.0f) {
+        const auto scale = [&](unsigned char channel) {
+            return static_cast<unsigned char>(std::clamp(channel * shade[0] + 0.5f, 0.0f, 255.0f));
+        };
+        color = {scale(color.r), scale(color.g), scale(color.b), color.a};
+    }
+    Plane shade_plane{}, w_plane{}, u_plane{}, v_plane{};
+    if (shaded) {
+        if (perspective) {
+            for (int i = 0; i < 3; i++) {
+                shade[i] *= inv_w[i];
+                tex_u[i] *= inv_w[i];
+                tex_v[i] *= inv_w[i];
+            }
+        }
+        shade_plane = MakePlane(shade, x, y, inv_area);
+        w_plane = MakePlane(inv_w, x, y, inv_area);
+        u_plane = MakePlane(tex_u, x, y, inv_area);
+        v_plane = MakePlane(tex_v, x, y, inv_area);
+    }
+
+    using namespace simd;
+    Color* const pixels = target.GetFramebuffer();
+    uint32_t packed;
+    static_assert(sizeof(Color) == sizeof(packed), "a pixel is one 32-bit lane");
+    std::memcpy(&packed, &color, sizeof(packed));
+    const Float8 lanes = Float8::Load(kLaneOffsets);
+    const Float8 zero = Float8::Zero();
+    const Float8 z_step_x = Float8::Broadcast(static_cast<float>(depth_plane.dx * kSubpixel));
+    const Float8 z_step_y = Float8::Broadcast(static_cast<float>(depth_plane.dy * kSubpixel));
+    const Float8 shade_step_x = Float8::Broadcast(static_cast<float>(shade_plane.dx * kSubpixel));
+    const Float8 shade_step_y = Float8::Broadcast(static_cast<float>(shade_plane.dy * kSubpixel));
+    const Float8 w_step_x = Float8::Broadcast(static_cast<float>(w_plane.dx * kSubpixel));
+    const Float8 w_step_y = Float8::Broadcast(static_cast<float>(w_plane.dy * kSubpixel));
+    const Float8 u_step_x = Float8::Broadcast(static_cast<float>(u_plane.dx * kSubpixel));
+    const Float8 u_step_y = Float8::Broadcast(static_cast<float>(u_plane.dy * kSubpixel));
+    const Float8 v_step_x = Float8::Broadcast(static_cast<float>(v_plane.dx * kSubpixel));
+    const Float8 v_step_y = Float8::Broadcast(static_cast<float>(v_plane.dy * kSubpixel));
+    const Float8 one = Float8::Broadcast(1.0f);
+    // textures are in [0, 255] already, so the color becomes a factor
+    const float color_scale = texture ? 1.0f / 255.0f : 1.0f;
+    const Float8 red = Float8::Broadcast(color.r * color_scale);
+    const Float8 green = Float8::Broadcast(color.g * color_scale);
+    const Float8 blue = Float8::Broadcast(color.b * color_scale);
+    const Float8 texture_width = Float8::Broadcast(texture ? static_cast<float>(texture->GetWidth()) : 0.0f);
+    const Float8 texture_height = Float8::Broadcast(texture ? static_cast<float>(texture->GetHeight()) : 0.0f);
+
+    // range of each edge function over a tile, relative to its value at the tile's first pixel center
+    int64_t tile_min[3], tile_max[3];
+    for (int e = 0; e < 3; e++) {
+        tile_min[e] = std::min<int64_t>(0, edges[e].a * kTileSpan) + std::min<int64_t>(0, edges[e].b * kTileSpan);
+        tile_max[e] = std::max<int64_t>(0, edges[e].a * kTileSpan) + std::max<int64_t>(0, edges[e].b * kTileSpan);
+    }
+
+    const int tile_x0 = first_x / kTile * kTile;
+    for (int ty = first_y / kTile * kTile; ty <= last_y; ty += kTile) {
+        const int rows = std::min(kTile, height - ty);
+        int64_t origin[3];
+        for (int e = 0; e < 3; e++)
+            origin[e] = edges[e].At(PixelCenter(tile_x0), PixelCenter(ty)) - edges[e].a * kSubpixel * kTile;
+
+        for (int tx = tile_x0; tx <= last_x; tx += kTile) {
+            for (int e = 0; e < 3; e++)
+                origin[e] += edges[e].a * kSubpixel * kTile;
+
+            bool reject = false;
+            int inside = 0;
+            for (int e = 0; e < 3; e++) {
+                reject |= origin[e] + tile_max[e] < 0;
+                inside += origin[e] + tile_min[e] >= 0;
+            }
+            if (reject)
+                continue;
+
+            const int columns = std::min(kTile, width - tx);
+            const bool covered_all = inside == 3;
+            if (covered_all && !depth_test && !shaded) {
+                GRAPHICS_STAT_INC(TilesAccepted);
+                for (int row = 0; row < rows; row++)
+                    std::fill_n(pixels + static_cast<size_t>(ty + row) * width + tx, columns, color);
+                continue;
+            }
+
+            // the triangle's depths over the tile, and whether the depth buffer can tell them apart
+            const double tile_z = depth_plane.At(PixelCenter(tx), PixelCenter(ty));
+            const auto near_z = static_cast<float>(std::max<double>(tile_z + z_tile_low, min_z));
+            const auto far_z = static_cast<float>(std::min<double>(tile_z + z_tile_high, max_z));
+            const int tile_column = tx / kTile;
+            const int tile_row = ty / kTile;
+            bool depth_passes = true;
+            if (depth_test) {
+                if (near_z >= depth_buffer.TileMax(tile_column, tile_row)) {
+                    GRAPHICS_STAT_INC(TilesOccluded);
+                    continue;
+                }
+                depth_passes = far_z < depth_buffer.TileMin(tile_column, tile_row);
+            }
+            if (covered_all)
+                GRAPHICS_STAT_INC(TilesAccepted);
+            else
+                GRAPHICS_STAT_INC(TilesPartial);
+
+            // Edges crossing the tile are stepped in float, exact since they
+            // stay within a tile's span of zero. Edges the whole tile is
+            // inside of are left out as a constant 0, which always passes.
+            Float8 value[3], step_y[3];
+            for (int e = 0; e < 3; e++) {
+                if (origin[e] + tile_min[e] >= 0) {
+                    value[e] = zero;
+                    step_y[e] = zero;
+                } else {
+                    value[e] = MulAdd(lanes, Float8::Broadcast(static_cast<float>(edges[e].a * kSubpixel)),
+                                      Float8::Broadcast(static_cast<float>(origin[e])));
+                    step_y[e] = Float8::Broadcast(static_cast<float>(edges[e].b * kSubpixel));
+                }
+            }
+
+            // only the rows of the bounding box; tiles cut by the right border of the canvas go lane by lane
+            const int first_row = std::max(first_y - ty, 0);
+            const int end_row = std::min(last_y + 1 - ty, rows);
+            const Float8 start_row = Float8::Broadcast(static_cast<float>(first_row));
+            for (int e = 0; e < 3; e++)
+                value[e] = MulAdd(step_y[e], start_row, value[e]);
+            Float8 depth = MulAdd(z_step_y, start_row, MulAdd(lanes, z_step_x, Float8::Broadcast(static_cast<float>(tile_z))));
+            Float8 shading = zero, w = zero, tu = zero, tv = zero;
+            if (shaded) {
+                const int64_t first_x_center = PixelCenter(tx);
+                const int64_t first_y_center = PixelCenter(ty + first_row);
+                const auto start = [&](const Plane& plane, Float8 step_x) {
+                    return MulAdd(lanes, step_x, Float8::Broadcast(static_cast<float>(plane.At(first_x_center, first_y_center))));
+                };
+                shading = start(shade_plane, shade_step_x);
+                if (perspective)
+                    w = start(w_plane, w_step_x);
+                if (texture) {
+                    tu = start(u_plane, u_step_x);
+                    tv = start(v_plane, v_step_x);
+                }
+            }
+
+            Color* row_pixels = pixels + static_cast<size_t>(ty + first_row) * width + tx;
+            for (int row = first_row; row < end_row; row++, row_pixels += width) {
+                Mask8 covered = (value[0] >= zero) & (value[1] >= zero) & (value[2] >= zero);
+                if (depth_test) {
+                    // the padded depth rows always hold a whole tile
+                    float* row_depth = depth_buffer.Row(ty + row) + tx;
+                    const Float8 stored = Float8::Load(row_depth);
+                    if (!depth_passes)
+                        covered = covered & (depth < stored);
+                    Select(covered, depth, stored).Store(row_depth);
+                    depth = depth + z_step_y;
+                }
+                if (shaded) {
+                    // a / w over 1 / w gives back a, one division for all the attributes
+                    const Float8 to_attribute = perspective ? one / w : one;
+                    const Float8 intensity = shading * to_attribute;
+                    Float8 r = red * intensity, g = green * intensity, b = blue * intensity;
+                    if (texture) {
+                        const Float8 u = tu * to_attribute;
+                        const Float8 v = tv * to_attribute;
+                        // texels per pixel along x and y: da/dx = (d(a/w)/dx - a * d(1/w)/dx) * w
+                        const Float8 du_dx = (u_step_x - u * w_step_x) * to_attribute * texture_width;
+                        const Float8 dv_dx = (v_step_x - v * w_step_x) * to_attribute * texture_height;
+                        const Float8 du_dy = (u_step_y - u * w_step_y) * to_attribute * texture_width;
+                        const Float8 dv_dy = (v_step_y - v * w_step_y) * to_attribute * texture_height;
+                        const Float8 footprint2 = Max(MulAdd(du_dx, du_dx, dv_dx * dv_dx), MulAdd(du_dy, du_dy, dv_dy * dv_dy));
+                        float lane_u[kTile], lane_v[kTile], lane_footprint2[kTile];
+                        u.Store(lane_u);
+                        v.Store(lane_v);
+                        footprint2.Store(lane_footprint2);
+                        float texel_r[kTile] = {}, texel_g[kTile] = {}, texel_b[kTile] = {};
+                        const int bits = MoveMask(covered);
+                        for (int lane = 0; lane < columns; lane++) {
+                            if (!(bits & (1 << lane)))
+                                continue;
+                            const Color texel = texture->Sample(lane_u[lane], lane_v[lane], 0.5f * std::log2(lane_footprint2[lane]));
+                            texel_r[lane] = texel.r;
+                            texel_g[lane] = texel.g;
+                            texel_b[lane] = texel.b;
+                        }
+                        r = r * Float8::Load(texel_r);
+                        g = g * Float8::Load(texel_g);
+                        b = b * Float8::Load(texel_b);
+                        tu = tu + u_step_y;
+                        tv = tv + v_step_y;
+                    }
+                    shading = shading + shade_step_y;
+                    if (perspective)
+                        w = w + w_step_y;
+                    if (columns == kTile) {
+                        MaskedStoreRgb(reinterpret_cast<uint32_t*>(row_pixels), covered, r, g, b);
+                    } else {
+                        uint32_t staged[kTile] = {};
+                        MaskedStoreRgb(staged, covered, r, g, b);
+                        const int bits = MoveMask(covered);
+                        for (int lane = 0; lane < columns; lane++)
+                            if (bits & (1 << lane))
+                                std::memcpy(row_pixels + lane, staged + lane, sizeof(packed));
+                    }
+                } else if (columns == kTile) {
+                    MaskedFill(reinterpret_cast<uint32_t*>(row_pixels), covered, packed);
+                } else {
+                    const int bits = MoveMask(covered);
+                    for (int lane = 0; lane < columns; lane++)
+                        if (bits & (1 << lane))
+                            row_pixels[lane] = color;
+                }
+                for (int e = 0; e < 3; e++)
+                    value[e] = value[e] + step_y[e];
+            }
+
+            if (depth_test)
+                depth_buffer.UpdateTile(tile_column, tile_row);
+        }
+    }
+}
+
+void Rasterizer::DrawTriangles(const ScreenTriangle* triangles, size_t count) {
+    GRAPHICS_PROFILE_ZONE("DrawTriangles");
+    if (thread_count == 1 || count < 2) {
+        for (size_t i = 0; i < count; i++)
+            DrawTriangle(triangles[i]);
+        return;
+    }
+
+    GRAPHICS_STAT_ADD(Triangles, count);
+    FitDepthBuffer();
+    const Canvas& target = canvas.get();
+    const int width = target.GetWidth();
+    const int height = target.GetHeight();
+    const int bins_x = (width + kBinSize - 1) / kBinSize;
+    const int bins_y = (height + kBinSize - 1) / kBinSize;
+    const int bin_count = bins_x * bins_y;
+    const int binners = static_cast<int>(std::min<size_t>(thread_count, count));
+    if (bins.size() < static_cast<size_t>(binners) * bin_count)
+        bins.resize(static_cast<size_t>(binners) * bin_count);
+
+    ParallelFor(binners, thread_count, [&](int binner) {
+        GRAPHICS_PROFILE_ZONE("Bin");
+        std::vector<uint32_t>* lists = bins.data() + static_cast<size_t>(binner) * bin_count;
+        for (int bin = 0; bin < bin_count; bin++)
+            lists[bin].clear();
+        const size_t end = count * (binner + 1) / binners;
+        for (size_t i = count * binner / binners; i < end; i++) {
+            const ScreenVertex* v = triangles[i].v;
+            const float min_x = std::min({v[0].x, v[1].x, v[2].x});
+            const float max_x = std::max({v[0].x, v[1].x, v[2].x});
+            const float min_y = std::min({v[0].y, v[1].y, v[2].y});
+            const float max_y = std::max({v[0].y, v[1].y, v[2].y});
+            // the drawing skips these anyway
+            if (!(max_x - min_x <= kMaxExtent && max_y - min_y <= kMaxExtent))
+                continue;
+            // pixels whose centers can be inside, a pixel wider than exact for the snapping
+            const int first_x = std::max(0, static_cast<int>(std::floor(min_x - 0.5f)));
+            const int last_x = std::min(width - 1, static_cast<int>(std::floor(max_x - 0.5f)));
+            const int first_y = std::max(0, static_cast<int>(std::floor(min_y - 0.5f)));
+            const int last_y = std::min(height - 1, static_cast<int>(std::floor(max_y - 0.5f)));
+            if (first_x > last_x || first_y > last_y)
+                continue;
+            for (int by = first_y / kBinSize; by <= last_y / kBinSize; by++)
+                for (int bx = first_x / kBinSize; bx <= last_x / kBinSize; bx++)
+                    lists[by * bins_x + bx].push_back(static_cast<uint32_t>(i));
+        }
+    });
+
+    ParallelFor(bin_count, thread_count, [&](int bin) {
+        GRAPHICS_PROFILE_ZONE("DrawBin");
+        const int x0 = bin % bins_x * kBinSize;
+        const int y0 = bin / bins_x * kBinSize;
+        const int x1 = std::min(width, x0 + kBinSize) - 1;
+        const int y1 = std::min(height, y0 + kBinSize) - 1;
+        for (int binner = 0; binner < binners; binner++)
+            for (const uint32_t i : bins[static_cast<size_t>(binner) * bin_count + bin])
+                DrawTriangleIn(triangles[i], x0, y0, x1, y1);
+    });
+}
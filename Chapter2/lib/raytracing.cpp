@@ -1,18 +1,75 @@
 #include "graphics/raytracing.hpp"
+#include "graphics/parallel.hpp"
+#include "graphics/profiler.hpp"
+#include "graphics/scenes.hpp"
+#include "graphics/simd.hpp"
+#include "graphics/stats.hpp"
 #include "raymath.h"
 
-#include <limits>
+#include <algorithm>
+#include <atomic>
 #include <cmath>
+#include <cstdlib>
+#include <limits>
 
 
 using namespace graphics;
 
-Raytracer::Raytracer(Canvas &canvas)  : canvas(canvas) {
-    spheres[0] = {{0, -1, 3}, 1, Color{255, 0, 0, 255}};       // Red sphere
-    spheres[1] = {{-2, 0, 4}, 1, Color{0, 255, 0, 255}};       // Green sphere
-    spheres[2] = {{2, 0, 4}, 1, Color{0, 0, 255, 255}};        // Blue sphere
-    spheres[3] = {{0, -5001, 0}, 5000, Color{255, 255, 0, 255}}; // Yellow ground
-    spheres[4] = {{0, 2, 3}, 1, BLACK};
+namespace {
+    // intersection tests done by this thread, read by the cost heatmap
+    thread_local uint64_t thread_intersection_tests = 0;
+
+    // per-light intensities while shading a point
+    thread_local std::vector<float> light_terms;
+
+    // one canvas row between the stages of Render; ParallelFor keeps its threads, so these
+    // are reused from row to row and frame to frame
+    thread_local std::vector<Vector3> row_directions;
+    thread_local std::vector<Intersection> row_hits;
+    thread_local std::vector<Color> row_colors;
+
+    // every SetScene gets a new version, so no thread trusts a stale cache
+    std::atomic<uint64_t> next_scene_version{1};
+
+    /**
+     * Last sphere that blocked each light, for the calling thread.
+     * Entries are -1 when the light was last seen unoccluded. ParallelFor's
+     * threads outlive the frame, so a cache carries over to the next one
+     * until SetScene changes the version.
+     */
+    struct ShadowCache {
+        uint64_t scene_version = 0;
+        std::vector<int> last_occluder;
+    };
+    thread_local ShadowCache shadow_cache_entries;
+}
+
+Raytracer::Raytracer(Canvas &canvas)  : canvas(canvas), thread_count(DefaultThreadCount()) {
+    SetScene(scenes::BookScene());
+}
+
+void Raytracer::SetScene(Scene scene) {
+    spheres = std::move(scene.spheres);
+    lights = std::move(scene.lights);
+    textures = std::move(scene.textures);
+    scene_version = next_scene_version.fetch_add(1, std::memory_order_relaxed);
+
+    const size_t padded = simd::PaddedSize(spheres.size());
+    const float nan = std::numeric_limits<float>::quiet_NaN();
+    sphere_arrays.cx.assign(padded, nan);
+    sphere_arrays.cy.assign(padded, nan);
+    sphere_arrays.cz.assign(padded, nan);
+    sphere_arrays.radius2.assign(padded, nan);
+    for (size_t i = 0; i < spheres.size(); i++) {
+        sphere_arrays.cx[i] = spheres[i].center.x;
+        sphere_arrays.cy[i] = spheres[i].center.y;
+        sphere_arrays.cz[i] = spheres[i].center.z;
+        sphere_arrays.radius2[i] = spheres[i].radius * spheres[i].radius;
+    }
+}
+
+void Raytracer::SetThreadCount(int threads) {
+    thread_count = threads < 1 ? DefaultThreadCount() : threads;
 }
 
 std::pair<float, float> Raytracer::IntersectRaySphere(const Vector3& origin, const Vector3& direction, const Sphere& sphere) const {
@@ -34,26 +91,414 @@ std::pair<float, float> Raytracer::IntersectRaySphere(const Vector3& origin, con
     return {t1, t2};
 }
 
-Color Raytracer::TraceRay(const Vector3& origin, const Vector3& direction, float t_min, float t_max) {
-    
-    float closest_t = std::numeric_limits<float>::infinity();
-    Sphere * closest_sphere = nullptr;
+Intersection Raytracer::ClosestIntersection(const Vector3& origin, const Vector3& direction, float t_min, float t_max) const {
+    Intersection closest{-1, std::numeric_limits<float>::infinity()};
+    GRAPHICS_STAT_ADD(IntersectionTests, spheres.size());
+    thread_intersection_tests += spheres.size();
+
+    for (int i = 0; i < static_cast<int>(spheres.size()); i++) {
+        auto [fst, snd] = IntersectRaySphere(origin, direction, spheres[i]);
+
+        if (fst < closest.t && t_min < fst && fst < t_max) {
+            closest.t = fst;
+            closest.sphere = i;
+        }
+        if (snd < closest.t && t_min < snd && snd < t_max) {
+            closest.t = snd;
+            closest.sphere = i;
+        }
+    }
+
+    if (closest.sphere >= 0)
+        GRAPHICS_STAT_INC(Hits);
+    return closest;
+}
+
+int Raytracer::FindOccluder(const Vector3& origin, const Vector3& direction, float t_min, float t_max) const {
+    using namespace simd;
+
+    // Same quadratic as IntersectRaySphere, with k1 shared by all spheres
+    const float k1 = Vector3DotProduct(direction, direction);
+    const Float8 inv_2k1 = Float8::Broadcast(1.0f / (2.0f * k1));
+    const Float8 four_k1 = Float8::Broadcast(4.0f * k1);
+    const Float8 ox = Float8::Broadcast(origin.x), oy = Float8::Broadcast(origin.y), oz = Float8::Broadcast(origin.z);
+    const Float8 dx = Float8::Broadcast(direction.x), dy = Float8::Broadcast(direction.y), dz = Float8::Broadcast(direction.z);
+    const Float8 lower = Float8::Broadcast(t_min), upper = Float8::Broadcast(t_max);
+    const Float8 zero = Float8::Zero();
+    const Float8 two = Float8::Broadcast(2.0f);
+
+    const size_t padded = sphere_arrays.cx.size();
+    for (size_t i = 0; i < padded; i += kWidth) {
+        const Float8 ocx = ox - Float8::Load(&sphere_arrays.cx[i]);
+        const Float8 ocy = oy - Float8::Load(&sphere_arrays.cy[i]);
+        const Float8 ocz = oz - Float8::Load(&sphere_arrays.cz[i]);
+
+        const Float8 k2 = two * MulAdd(ocx, dx, MulAdd(ocy, dy, ocz * dz));
+        const Float8 k3 = MulAdd(ocx, ocx, MulAdd(ocy, ocy, ocz * ocz)) - Float8::Load(&sphere_arrays.radius2[i]);
+        const Float8 discriminant = MulSub(k2, k2, four_k1 * k3);
+        const Mask8 crosses = discriminant >= zero;
+        if (!Any(crosses))
+            continue;
 
-    for (auto & sphere : spheres) {
-        auto [fst, snd] = IntersectRaySphere(origin, direction, sphere);
+        const Float8 root = Sqrt(Max(discriminant, zero));
+        const Float8 t1 = (zero - k2 + root) * inv_2k1;
+        const Float8 t2 = (zero - k2 - root) * inv_2k1;
+        const Mask8 blocks = crosses & (((t1 > lower) & (t1 < upper)) | ((t2 > lower) & (t2 < upper)));
 
-        if (fst < closest_t && t_min < fst && fst < t_max) {
-            closest_t = fst;
-            closest_sphere = &sphere;
+        const int bits = MoveMask(blocks);
+        if (bits != 0) {
+            const size_t tested = std::min(i + kWidth, spheres.size());
+            GRAPHICS_STAT_ADD(IntersectionTests, tested);
+            thread_intersection_tests += tested;
+            int lane = 0;
+            while (!(bits & (1 << lane)))
+                lane++;
+            return static_cast<int>(i) + lane;
         }
-        if (snd < closest_t && t_min < snd && snd < t_max) {
-            closest_t = snd;
-            closest_sphere = &sphere;
+    }
+
+    GRAPHICS_STAT_ADD(IntersectionTests, spheres.size());
+    thread_intersection_tests += spheres.size();
+    return -1;
+}
+
+bool Raytracer::Occluded(const Vector3& origin, const Vector3& direction, float t_min, float t_max) const {
+    GRAPHICS_STAT_INC(ShadowRays);
+    const bool occluded = FindOccluder(origin, direction, t_min, t_max) >= 0;
+    if (occluded)
+        GRAPHICS_STAT_INC(Occlusions);
+    return occluded;
+}
+
+bool Raytracer::LightOccluded(const Vector3& point, size_t light) const {
+    const Vector3 towards_light = lights.VectorFrom(light, point);
+    const float t_max = lights.ShadowDistance(light);
+    if (!shadow_cache)
+        return Occluded(point, towards_light, kSurfaceEpsilon, t_max);
+
+    ShadowCache& cache = shadow_cache_entries;
+    if (cache.scene_version != scene_version || cache.last_occluder.size() != lights.Size()) {
+        cache.scene_version = scene_version;
+        cache.last_occluder.assign(lights.Size(), -1);
+    }
+
+    GRAPHICS_STAT_INC(ShadowRays);
+    const int cached = cache.last_occluder[light];
+    if (cached >= 0) {
+        GRAPHICS_STAT_INC(IntersectionTests);
+        thread_intersection_tests++;
+        auto [t1, t2] = IntersectRaySphere(point, towards_light, spheres[cached]);
+        if ((t1 > kSurfaceEpsilon && t1 < t_max) || (t2 > kSurfaceEpsilon && t2 < t_max)) {
+            GRAPHICS_STAT_INC(ShadowCacheHits);
+            GRAPHICS_STAT_INC(Occlusions);
+            return true;
         }
+        // only a cached occluder that was tested and let the ray through is a miss
+        GRAPHICS_STAT_INC(ShadowCacheMisses);
+    }
+
+    const int occluder = FindOccluder(point, towards_light, kSurfaceEpsilon, t_max);
+    // keep the last real blocker: an unoccluded ray says nothing about the next one
+    if (occluder >= 0) {
+        cache.last_occluder[light] = occluder;
+        GRAPHICS_STAT_INC(Occlusions);
+    }
+    return occluder >= 0;
+}
+
+Color graphics::SurfaceColor(const Sphere& sphere, const Vector3& normal, float footprint) {
+    if (!sphere.texture)
+        return sphere.color;
+    const TextureMap& texture = *sphere.texture;
+    const float u = 0.5f + std::atan2(normal.z, normal.x) * (0.5f / PI);
+    const float v = std::acos(std::clamp(normal.y, -1.0f, 1.0f)) * (1.0f / PI);
+    // texels per world unit: the equator spans the texture's width, a meridian half of it its height
+    const float density = std::max(static_cast<float>(texture.GetWidth()) / (2.0f * PI * sphere.radius),
+                                   static_cast<float>(texture.GetHeight()) / (PI * sphere.radius));
+    return texture.Sample(u, v, std::log2(footprint * density));
+}
+
+Color Raytracer::LocalColor(const Sphere& sphere, const Vector3& point, const Vector3& normal, const Vector3& view,
+                            float footprint) const {
+    const Color base = SurfaceColor(sphere, normal, footprint);
+    if (lights.Empty())
+        return base;
+
+    // unshadowed intensity of every light, then only the lights with some
+    // contribution pay for a shadow ray
+    light_terms.resize(simd::PaddedSize(lights.Size()));
+    lights.ComputeTerms(point, normal, view, sphere.specular, light_terms.data());
+
+    float intensity = lights.Ambient();
+    for (size_t i = 0; i < lights.Size(); i++) {
+        if (light_terms[i] <= 0.0f)
+            continue;
+        if (!LightOccluded(point, i))
+            intensity += light_terms[i];
     }
 
-    if (closest_sphere == nullptr)
-        return canvas.get().GetBackground();
-    return closest_sphere->color;
+    auto channel = [intensity](unsigned char value) {
+        return static_cast<unsigned char>(std::clamp(static_cast<float>(value) * intensity, 0.0f, 255.0f));
+    };
+    return Color{channel(base.r), channel(base.g), channel(base.b), base.a};
 }
 
+Color Raytracer::Shade(const Vector3& origin, const Vector3& direction, const Intersection& hit) {
+    RayState ray{origin, direction, 1.0f, 0};
+    Intersection current = hit;
+    float rgb[3] = {0.0f, 0.0f, 0.0f};
+    const float pixel_angle = canvas.get().GetPixelAngle();
+
+    auto accumulate = [&rgb](const Color& color, float weight) {
+        rgb[0] += static_cast<float>(color.r) * weight;
+        rgb[1] += static_cast<float>(color.g) * weight;
+        rgb[2] += static_cast<float>(color.b) * weight;
+    };
+
+    while (true) {
+        if (current.sphere < 0) {
+            accumulate(canvas.get().GetBackground(), ray.throughput);
+            break;
+        }
+
+        const Sphere& sphere = spheres[current.sphere];
+        const Vector3 point = Vector3Add(ray.origin, Vector3Scale(ray.direction, current.t));
+        const Vector3 normal = Vector3Normalize(Vector3Subtract(point, sphere.center));
+        const Vector3 view = Vector3Negate(ray.direction);
+        const float footprint = current.t * Vector3Length(ray.direction) * pixel_angle;
+        const Color local = LocalColor(sphere, point, normal, view, footprint);
+
+        const float r = sphere.reflective;
+        if (r <= 0.0f || ray.depth >= reflection.max_depth || ray.throughput * r < reflection.min_throughput) {
+            accumulate(local, ray.throughput);
+            break;
+        }
+
+        // local * (1 - r) now, the reflection adds the remaining r later
+        accumulate(local, ray.throughput * (1.0f - r));
+
+        // R = 2 N <N, V> - V, the view vector mirrored around the normal
+        const Vector3 reflected = Vector3Subtract(Vector3Scale(normal, 2.0f * Vector3DotProduct(normal, view)), view);
+        ray = {point, reflected, ray.throughput * r, ray.depth + 1};
+
+        GRAPHICS_STAT_INC(ReflectionRays);
+        current = ClosestIntersection(ray.origin, ray.direction, kSurfaceEpsilon, std::numeric_limits<float>::infinity());
+    }
+
+    return Color{
+        static_cast<unsigned char>(std::min(rgb[0] + 0.5f, 255.0f)),
+        static_cast<unsigned char>(std::min(rgb[1] + 0.5f, 255.0f)),
+        static_cast<unsigned char>(std::min(rgb[2] + 0.5f, 255.0f)),
+        255};
+}
+
+Color Raytracer::TraceRay(const Vector3& origin, const Vector3& direction, float t_min, float t_max) {
+    Intersection closest = ClosestIntersection(origin, direction, t_min, t_max);
+    return Shade(origin, direction, closest);
+}
+
+void Raytracer::SetAntiAliasing(AntiAliasing mode, const AdaptiveAAConfig& config) {
+    anti_aliasing = mode;
+    adaptive_config = config;
+}
+
+void Raytracer::SetOutput(RenderOutput mode, CostMetric metric, int tile_size) {
+    output = mode;
+    heatmap_tile_size = std::max(1, tile_size);
+    cost_map.Reset(0, 0, metric);
+}
+
+uint64_t Raytracer::CostCounter() const {
+    if (cost_map.GetMetric() == CostMetric::Cycles)
+        return profiler::Timestamp();
+    return thread_intersection_tests;
+}
+
+Raytracer::Sample Raytracer::TraceSample(const Vector3& origin, float x, float y) {
+    GRAPHICS_STAT_INC(PrimaryRays);
+    Vector3 direction = canvas.get().CanvasToViewPort(x, y);
+    Intersection closest = ClosestIntersection(origin, direction, 1, std::numeric_limits<float>::infinity());
+    return {Shade(origin, direction, closest), closest.sphere};
+}
+
+bool Raytracer::SamplesAgree(const Sample& a, const Sample& b) const {
+    if (a.sphere != b.sphere)
+        return false;
+
+    const int threshold = static_cast<int>(adaptive_config.color_threshold * 255.0f);
+    return std::abs(a.color.r - b.color.r) <= threshold &&
+           std::abs(a.color.g - b.color.g) <= threshold &&
+           std::abs(a.color.b - b.color.b) <= threshold;
+}
+
+void Raytracer::SampleArea(const Vector3& origin, float x, float y, float half, const Sample (&corners)[4], int depth, float (&rgb)[3]) {
+    const bool uniform = SamplesAgree(corners[0], corners[1]) &&
+                         SamplesAgree(corners[0], corners[2]) &&
+                         SamplesAgree(corners[0], corners[3]);
+
+    if (uniform || depth >= adaptive_config.max_depth) {
+        rgb[0] = rgb[1] = rgb[2] = 0.0f;
+        for (const auto& corner : corners) {
+            rgb[0] += corner.color.r * 0.25f;
+            rgb[1] += corner.color.g * 0.25f;
+            rgb[2] += corner.color.b * 0.25f;
+        }
+        return;
+    }
+
+    // Split in four quadrants, the new rays are the edge midpoints and the center:
+    //   c0 -- top -- c1
+    //   |      |     |
+    //  left - mid - right
+    //   |      |     |
+    //   c2 - bottom - c3
+    const Sample top = TraceSample(origin, x, y + half);
+    const Sample left = TraceSample(origin, x - half, y);
+    const Sample mid = TraceSample(origin, x, y);
+    const Sample right = TraceSample(origin, x + half, y);
+    const Sample bottom = TraceSample(origin, x, y - half);
+
+    const Sample quadrants[4][4] = {
+        {corners[0], top, left, mid},
+        {top, corners[1], mid, right},
+        {left, mid, corners[2], bottom},
+        {mid, right, bottom, corners[3]},
+    };
+    const float offsets[4][2] = {
+        {-half / 2, half / 2}, {half / 2, half / 2}, {-half / 2, -half / 2}, {half / 2, -half / 2}
+    };
+
+    rgb[0] = rgb[1] = rgb[2] = 0.0f;
+    for (int q = 0; q < 4; q++) {
+        float quadrant_rgb[3];
+        SampleArea(origin, x + offsets[q][0], y + offsets[q][1], half / 2, quadrants[q], depth + 1, quadrant_rgb);
+        rgb[0] += quadrant_rgb[0] * 0.25f;
+        rgb[1] += quadrant_rgb[1] * 0.25f;
+        rgb[2] += quadrant_rgb[2] * 0.25f;
+    }
+}
+
+void Raytracer::Render(const Vector3& origin) {
+    GRAPHICS_PROFILE_ZONE("Render");
+    // the wavefront stages don't measure pixel costs, the heatmap is always drawn per pixel
+    if (render_mode == RenderMode::Wavefront && output == RenderOutput::Color) {
+        RenderWavefront(origin);
+        return;
+    }
+
+    Canvas& target = canvas.get();
+    const int width = target.GetWidth();
+    const int height = target.GetHeight();
+    stats::BeginFrame();
+
+    const bool measure = output == RenderOutput::CostHeatmap;
+    if (measure)
+        cost_map.Reset(width, height, cost_map.GetMetric());
+
+    // First pass: one ray through each pixel center. Canvas pixel (px, py)
+    // is the point (px - Cw/2, Ch/2 - py) in the book's centered coordinates.
+    // Each row goes through the stages one after the other, so the profiler
+    // can tell how much of the frame each of them takes.
+    frame_samples.resize(static_cast<size_t>(width) * height);
+    ParallelFor(height, thread_count, [&](int py) {
+        std::vector<Vector3>& directions = row_directions;
+        std::vector<Intersection>& hits = row_hits;
+        directions.resize(width);
+        hits.resize(width);
+        const float y = static_cast<float>(height / 2 - py);
+
+        {
+            GRAPHICS_PROFILE_ZONE("GenerateRays");
+            for (int px = 0; px < width; px++)
+                directions[px] = target.CanvasToViewPort(static_cast<float>(px - width / 2), y);
+            GRAPHICS_STAT_ADD(PrimaryRays, width);
+        }
+        {
+            GRAPHICS_PROFILE_ZONE("Intersect");
+            for (int px = 0; px < width; px++) {
+                const uint64_t before = measure ? CostCounter() : 0;
+                hits[px] = ClosestIntersection(origin, directions[px], 1, std::numeric_limits<float>::infinity());
+                if (measure)
+                    cost_map.Add(px, py, CostCounter() - before);
+            }
+        }
+        {
+            GRAPHICS_PROFILE_ZONE("Shade");
+            for (int px = 0; px < width; px++) {
+                const uint64_t before = measure ? CostCounter() : 0;
+                frame_samples[py * width + px] = {Shade(origin, directions[px], hits[px]), hits[px].sphere};
+                if (measure)
+                    cost_map.Add(px, py, CostCounter() - before);
+            }
+        }
+    });
+
+    if (anti_aliasing == AntiAliasing::None) {
+        GRAPHICS_PROFILE_ZONE("PutPixel");
+        if (measure) {
+            cost_map.Draw(target, heatmap_tile_size);
+        } else {
+            for (int py = 0; py < height; py++)
+                for (int px = 0; px < width; px++)
+                    target.PutPixel(px, py, frame_samples[py * width + px].color);
+        }
+        stats::EndFrame();
+        return;
+    }
+
+    // Second pass: a pixel is on an edge if any of its 4-neighbours sees a
+    // different sphere or a different enough color. Only those get more rays.
+    ParallelFor(height, thread_count, [&](int py) {
+        std::vector<Color>& row = row_colors;
+        row.resize(width);
+
+        {
+            GRAPHICS_PROFILE_ZONE("AdaptiveRefine");
+            for (int px = 0; px < width; px++) {
+                const Sample& center = frame_samples[py * width + px];
+                const bool edge = (px > 0 && !SamplesAgree(center, frame_samples[py * width + px - 1])) ||
+                                  (px + 1 < width && !SamplesAgree(center, frame_samples[py * width + px + 1])) ||
+                                  (py > 0 && !SamplesAgree(center, frame_samples[(py - 1) * width + px])) ||
+                                  (py + 1 < height && !SamplesAgree(center, frame_samples[(py + 1) * width + px]));
+
+                if (!edge) {
+                    row[px] = center.color;
+                    continue;
+                }
+
+                const uint64_t before = measure ? CostCounter() : 0;
+                const float x = static_cast<float>(px - width / 2);
+                const float y = static_cast<float>(height / 2 - py);
+                const Sample corners[4] = {
+                    TraceSample(origin, x - 0.5f, y + 0.5f),
+                    TraceSample(origin, x + 0.5f, y + 0.5f),
+                    TraceSample(origin, x - 0.5f, y - 0.5f),
+                    TraceSample(origin, x + 0.5f, y - 0.5f),
+                };
+
+                float rgb[3];
+                SampleArea(origin, x, y, 0.5f, corners, 0, rgb);
+
+                row[px] = Color{
+                    static_cast<unsigned char>(rgb[0] + 0.5f),
+                    static_cast<unsigned char>(rgb[1] + 0.5f),
+                    static_cast<unsigned char>(rgb[2] + 0.5f),
+                    255};
+                if (measure)
+                    cost_map.Add(px, py, CostCounter() - before);
+            }
+        }
+        if (!measure) {
+            GRAPHICS_PROFILE_ZONE("PutPixel");
+            for (int px = 0; px < width; px++)
+                target.PutPixel(px, py, row[px]);
+        }
+    });
+
+    if (measure) {
+        GRAPHICS_PROFILE_ZONE("PutPixel");
+        cost_map.Draw(target, heatmap_tile_size);
+    }
+
+    stats::EndFrame();
+}
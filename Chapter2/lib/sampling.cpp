@@ -0,0 +1,37 @@
+#include "graphics/sampling.hpp"
+
+using namespace graphics::sampling;
+
+namespace {
+    /**
+     * First Sobol dimension: the bits of the index mirrored, i.e. the base 2
+     * radical inverse.
+     */
+    uint32_t SobolFirst(uint32_t index) {
+        return ReverseBits(index);
+    }
+
+    /**
+     * Second Sobol dimension, whose direction numbers are the rows of
+     * Pascal's triangle modulo 2.
+     */
+    uint32_t SobolSecond(uint32_t index) {
+        uint32_t result = 0;
+        for (uint32_t direction = 1u << 31; index != 0; index >>= 1, direction ^= direction >> 1)
+            if (index & 1u)
+                result ^= direction;
+        return result;
+    }
+}
+
+SampleTable::SampleTable() : points(2 * static_cast<size_t>(kSize)) {
+    for (uint32_t i = 0; i < kSize; i++) {
+        points[2 * static_cast<size_t>(i)] = SobolFirst(i);
+        points[2 * static_cast<size_t>(i) + 1] = SobolSecond(i);
+    }
+}
+
+const SampleTable& SampleTable::Instance() {
+    static const SampleTable table;
+    return table;
+}
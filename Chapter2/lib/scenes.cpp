@@ -0,0 +1,112 @@
+#include "graphics/scenes.hpp"
+
+#include <cmath>
+#include <memory>
+#include <random>
+
+namespace graphics::scenes {
+
+    void AddBookLights(Scene& scene) {
+        scene.lights.AddAmbient(0.2f);
+        scene.lights.AddPoint(0.6f, {2, 1, 0});
+        scene.lights.AddDirectional(0.2f, {1, 4, 4});
+    }
+
+    Scene BookScene() {
+        Scene scene;
+        scene.spheres = {
+            {{0, -1, 3}, 1, Color{255, 0, 0, 255}, 500, 0.2f},          // Red sphere, shiny, a bit reflective
+            {{-2, 0, 4}, 1, Color{0, 255, 0, 255}, 10, 0.4f},           // Green sphere, somewhat shiny, more reflective
+            {{2, 0, 4}, 1, Color{0, 0, 255, 255}, 500, 0.3f},           // Blue sphere, shiny
+            {{0, -5001, 0}, 5000, Color{255, 255, 0, 255}, 1000, 0.5f}, // Yellow ground, very shiny, half mirror
+            {{0, 2, 3}, 1, BLACK},
+        };
+        AddBookLights(scene);
+        return scene;
+    }
+
+    Scene TexturedScene() {
+        Scene scene = BookScene();
+        // the three colored spheres get checkers of their color and white, 16 around the equator
+        for (int i = 0; i < 3; i++) {
+            auto texture = std::make_shared<const TextureMap>(TextureMap::Checkerboard(256, 16, scene.spheres[i].color, WHITE));
+            scene.spheres[i].texture = texture.get();
+            scene.textures.push_back(std::move(texture));
+        }
+        return scene;
+    }
+
+    Scene ManyLightsScene(int count) {
+        Scene scene = BookScene();
+        scene.lights.Clear();
+        scene.lights.AddAmbient(0.2f);
+
+        // a ring of point lights above the spheres, sharing the remaining intensity
+        const float intensity = 0.8f / static_cast<float>(count);
+        for (int i = 0; i < count; i++) {
+            const float angle = 2.0f * PI * static_cast<float>(i) / static_cast<float>(count);
+            scene.lights.AddPoint(intensity, {4.0f * std::cos(angle), 3.0f, 3.0f + 4.0f * std::sin(angle)});
+        }
+        return scene;
+    }
+
+    Scene RandomSpheres(std::size_t count, uint32_t seed) {
+        // box in front of the camera: x, y in [-10, 10], z in [5, 45]
+        constexpr float half_extent = 10.0f;
+        constexpr float near_z = 5.0f;
+        constexpr float far_z = 45.0f;
+        constexpr float volume = (2 * half_extent) * (2 * half_extent) * (far_z - near_z);
+
+        std::mt19937 generator(seed);
+        std::uniform_real_distribution<float> xy(-half_extent, half_extent);
+        std::uniform_real_distribution<float> z(near_z, far_z);
+        std::uniform_int_distribution<int> channel(32, 255);
+
+        // a third of the mean spacing between centers
+        const float radius = std::cbrt(volume / static_cast<float>(count == 0 ? 1 : count)) / 3.0f;
+
+        Scene scene;
+        scene.spheres.reserve(count);
+        for (std::size_t i = 0; i < count; i++) {
+            const Vector3 center{xy(generator), xy(generator), z(generator)};
+            const Color color{
+                static_cast<unsigned char>(channel(generator)),
+                static_cast<unsigned char>(channel(generator)),
+                static_cast<unsigned char>(channel(generator)),
+                255};
+            scene.spheres.push_back({center, radius, color, 100});
+        }
+        AddBookLights(scene);
+        return scene;
+    }
+
+    Scene SphereGrid(int columns, int rows) {
+        // the wall spans [-2, 2] x [-1.5, 1.5] at z = 4, roughly the view of a 1x1 viewport
+        constexpr float width = 4.0f;
+        constexpr float height = 3.0f;
+        constexpr float depth = 4.0f;
+
+        const float spacing = std::fmin(width / static_cast<float>(columns), height / static_cast<float>(rows));
+        const float radius = spacing / 2.0f;
+
+        Scene scene;
+        scene.spheres.reserve(static_cast<std::size_t>(columns) * rows);
+        for (int row = 0; row < rows; row++) {
+            for (int column = 0; column < columns; column++) {
+                const Vector3 center{
+                    (static_cast<float>(column) + 0.5f) * spacing - width / 2,
+                    (static_cast<float>(row) + 0.5f) * spacing - height / 2,
+                    depth};
+                const Color color{
+                    static_cast<unsigned char>(255 * column / columns),
+                    static_cast<unsigned char>(255 * row / rows),
+                    128,
+                    255};
+                scene.spheres.push_back({center, radius, color, 100});
+            }
+        }
+        AddBookLights(scene);
+        return scene;
+    }
+
+} // namespace graphics::scenes
@@ -0,0 +1,147 @@
+#include "graphics/stats.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <mutex>
+#include <sstream>
+#include <vector>
+
+namespace graphics::stats {
+
+    namespace {
+        struct Registry {
+            std::mutex mutex;
+            // counters of the threads that are alive
+            std::vector<ThreadCounters*> live;
+            // counters left behind by threads that already exited
+            uint64_t retired[kCounterCount]{};
+
+            // totals at BeginFrame and the frame being measured
+            uint64_t frame_start[kCounterCount]{};
+            std::chrono::steady_clock::time_point frame_clock{};
+            FrameStats last_frame{};
+        };
+
+        Registry& GetRegistry() {
+            static Registry registry;
+            return registry;
+        }
+
+        void SnapshotTotals(Registry& registry, uint64_t (&totals)[kCounterCount]) {
+            for (int i = 0; i < kCounterCount; i++)
+                totals[i] = registry.retired[i];
+            for (const ThreadCounters* counters : registry.live)
+                for (int i = 0; i < kCounterCount; i++)
+                    totals[i] += counters->values[i].load(std::memory_order_relaxed);
+        }
+    }
+
+    ThreadCounters::ThreadCounters() {
+        for (auto& value : values)
+            value.store(0, std::memory_order_relaxed);
+
+        Registry& registry = GetRegistry();
+        std::lock_guard<std::mutex> lock(registry.mutex);
+        registry.live.push_back(this);
+    }
+
+    ThreadCounters::~ThreadCounters() {
+        Registry& registry = GetRegistry();
+        std::lock_guard<std::mutex> lock(registry.mutex);
+        for (int i = 0; i < kCounterCount; i++)
+            registry.retired[i] += values[i].load(std::memory_order_relaxed);
+        registry.live.erase(std::remove(registry.live.begin(), registry.live.end(), this), registry.live.end());
+    }
+
+    uint64_t FrameStats::Rays() const {
+        return Get(Counter::PrimaryRays) + Get(Counter::ReflectionRays) + Get(Counter::BounceRays) + Get(Counter::ShadowRays);
+    }
+
+    double FrameStats::TestsPerRay() const {
+        const uint64_t rays = Rays();
+        return rays == 0 ? 0.0 : static_cast<double>(Get(Counter::IntersectionTests)) / static_cast<double>(rays);
+    }
+
+    double FrameStats::HitRate() const {
+        const uint64_t rays = Rays() - Get(Counter::ShadowRays);
+        return rays == 0 ? 0.0 : static_cast<double>(Get(Counter::Hits)) / static_cast<double>(rays);
+    }
+
+    double FrameStats::ShadowCacheHitRate() const {
+        const uint64_t lookups = Get(Counter::ShadowCacheHits) + Get(Counter::ShadowCacheMisses);
+        return lookups == 0 ? 0.0 : static_cast<double>(Get(Counter::ShadowCacheHits)) / static_cast<double>(lookups);
+    }
+
+    double FrameStats::MRaysPerSecond() const {
+        return seconds <= 0.0 ? 0.0 : static_cast<double>(Rays()) / seconds * 1e-6;
+    }
+
+    void BeginFrame() {
+        Registry& registry = GetRegistry();
+        std::lock_guard<std::mutex> lock(registry.mutex);
+        SnapshotTotals(registry, registry.frame_start);
+        registry.frame_clock = std::chrono::steady_clock::now();
+    }
+
+    const FrameStats& EndFrame() {
+        const auto now = std::chrono::steady_clock::now();
+
+        Registry& registry = GetRegistry();
+        std::lock_guard<std::mutex> lock(registry.mutex);
+
+        uint64_t totals[kCounterCount];
+        SnapshotTotals(registry, totals);
+
+        FrameStats& frame = registry.last_frame;
+        for (int i = 0; i < kCounterCount; i++)
+            frame.values[i] = totals[i] - registry.frame_start[i];
+        frame.seconds = std::chrono::duration<double>(now - registry.frame_clock).count();
+        return frame;
+    }
+
+    const FrameStats& LastFrame() {
+        return GetRegistry().last_frame;
+    }
+
+    const char* CounterName(Counter counter) {
+        switch (counter) {
+            case Counter::PrimaryRays: return "primary_rays";
+            case Counter::IntersectionTests: return "intersection_tests";
+            case Counter::Hits: return "hits";
+            case Counter::ReflectionRays: return "reflection_rays";
+            case Counter::BounceRays: return "bounce_rays";
+            case Counter::ShadowRays: return "shadow_rays";
+            case Counter::Occlusions: return "occlusions";
+            case Counter::ShadowCacheHits: return "shadow_cache_hits";
+            case Counter::ShadowCacheMisses: return "shadow_cache_misses";
+            case Counter::Triangles: return "triangles";
+            case Counter::TilesAccepted: return "tiles_accepted";
+            case Counter::TilesPartial: return "tiles_partial";
+            case Counter::TrianglesOccluded: return "triangles_occluded";
+            case Counter::TilesOccluded: return "tiles_occluded";
+            case Counter::TrianglesRejected: return "triangles_rejected";
+            case Counter::TrianglesClipped: return "triangles_clipped";
+            case Counter::BackFaces: return "back_faces";
+            case Counter::SpheresCulled: return "spheres_culled";
+            case Counter::VerticesTransformed: return "vertices_transformed";
+            case Counter::VertexCacheHits: return "vertex_cache_hits";
+            default: return "unknown";
+        }
+    }
+
+    std::string ToJson(const FrameStats& frame) {
+        std::ostringstream json;
+        json << "{\"enabled\": " << (Enabled() ? "true" : "false");
+        for (int i = 0; i < kCounterCount; i++)
+            json << ", \"" << CounterName(static_cast<Counter>(i)) << "\": " << frame.values[i];
+        json << ", \"rays\": " << frame.Rays()
+             << ", \"seconds\": " << frame.seconds
+             << ", \"tests_per_ray\": " << frame.TestsPerRay()
+             << ", \"hit_rate\": " << frame.HitRate()
+             << ", \"shadow_cache_hit_rate\": " << frame.ShadowCacheHitRate()
+             << ", \"mrays_per_second\": " << frame.MRaysPerSecond()
+             << "}";
+        return json.str();
+    }
+
+} // namespace graphics::stats
@@ -0,0 +1,119 @@
+#include "graphics/temporal.hpp"
+#include "graphics/parallel.hpp"
+#include "graphics/profiler.hpp"
+#include "graphics/stats.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <limits>
+
+using namespace graphics;
+
+namespace {
+    // past this the mean no longer visibly changes, and idle frames stay idle
+    constexpr uint32_t kMaxFrames = 1024;
+
+    /**
+     * Radical inverse of an index: its digits in a base, mirrored around the
+     * decimal point. Successive indices fill [0, 1) evenly at every scale.
+     */
+    float RadicalInverse(uint32_t index, uint32_t base) {
+        const float inv_base = 1.0f / static_cast<float>(base);
+        float scale = inv_base;
+        float result = 0.0f;
+        while (index > 0) {
+            result += static_cast<float>(index % base) * scale;
+            index /= base;
+            scale *= inv_base;
+        }
+        return result;
+    }
+}
+
+TemporalAccumulator::TemporalAccumulator(Canvas& canvas, Raytracer& raytracer)
+    : canvas(canvas), raytracer(raytracer) {}
+
+void TemporalAccumulator::Seed(const Vector3& origin) {
+    Canvas& target = canvas.get();
+    width = target.GetWidth();
+    height = target.GetHeight();
+    last_origin = origin;
+    scene_version = raytracer.get().GetSceneVersion();
+
+    const size_t pixels = static_cast<size_t>(width) * height;
+    const Color* image = target.GetFramebuffer();
+    sum_r.resize(pixels);
+    sum_g.resize(pixels);
+    sum_b.resize(pixels);
+    for (size_t i = 0; i < pixels; i++) {
+        sum_r[i] = image[i].r;
+        sum_g[i] = image[i].g;
+        sum_b[i] = image[i].b;
+    }
+    samples.assign(pixels, 1);
+    frame = 1;
+    seeded = true;
+}
+
+bool TemporalAccumulator::Accumulate(const Vector3& origin, double max_seconds) {
+    GRAPHICS_PROFILE_ZONE("TemporalAccumulator::Accumulate");
+    Raytracer& tracer = raytracer.get();
+    if (tracer.GetOutput() != RenderOutput::Color)
+        return false;
+
+    Canvas& target = canvas.get();
+    if (!seeded) {
+        Seed(origin);
+        return false;
+    }
+    const bool moved = origin.x != last_origin.x || origin.y != last_origin.y || origin.z != last_origin.z;
+    if (target.GetWidth() != width || target.GetHeight() != height || moved || tracer.GetSceneVersion() != scene_version) {
+        // a regular frame first: reacting to a change costs no more than before
+        tracer.Render(origin);
+        Seed(origin);
+        return true;
+    }
+    if (frame >= kMaxFrames)
+        return false;
+
+    stats::BeginFrame();
+    const auto start = std::chrono::steady_clock::now();
+    // the rendered frame sampled the pixel centers, offset 0 of the sequence
+    const float jitter_x = RadicalInverse(frame, 2) - 0.5f;
+    const float jitter_y = RadicalInverse(frame, 3) - 0.5f;
+    const int first_row = static_cast<int>((frame * 7919u) % static_cast<uint32_t>(height));
+    frame++;
+
+    ParallelFor(height, tracer.GetThreadCount(), [&](int i) {
+        if (interrupted.load(std::memory_order_relaxed))
+            return;
+        if (max_seconds > 0.0 && std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count() > max_seconds) {
+            interrupted.store(true, std::memory_order_relaxed);
+            return;
+        }
+
+        const int py = (first_row + i) % height;
+        const float y = static_cast<float>(height / 2 - py) + jitter_y;
+        for (int px = 0; px < width; px++) {
+            const size_t index = static_cast<size_t>(py) * width + px;
+            const float x = static_cast<float>(px - width / 2) + jitter_x;
+            const Color color = tracer.TraceRay(origin, target.CanvasToViewPort(x, y), 1, std::numeric_limits<float>::infinity());
+            GRAPHICS_STAT_INC(PrimaryRays);
+
+            sum_r[index] += color.r;
+            sum_g[index] += color.g;
+            sum_b[index] += color.b;
+            const float scale = 1.0f / static_cast<float>(++samples[index]);
+            target.PutPixel(px, py, Color{
+                static_cast<unsigned char>(std::min(sum_r[index] * scale + 0.5f, 255.0f)),
+                static_cast<unsigned char>(std::min(sum_g[index] * scale + 0.5f, 255.0f)),
+                static_cast<unsigned char>(std::min(sum_b[index] * scale + 0.5f, 255.0f)),
+                255});
+        }
+    });
+    // cleared only once honored: an Interrupt between two calls stops the next one
+    interrupted.store(false, std::memory_order_relaxed);
+
+    stats::EndFrame();
+    return true;
+}
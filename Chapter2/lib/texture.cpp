@@ -0,0 +1,128 @@
+#include "graphics/texture.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+using namespace graphics;
+
+namespace {
+    /**
+     * Wraps a texture coordinate into [0, 1), for repeating textures.
+     */
+    float Wrap(float coordinate) {
+        const float wrapped = coordinate - std::floor(coordinate);
+        // tiny negative values round up to 1
+        return wrapped < 1.0f ? wrapped : 0.0f;
+    }
+
+    unsigned char ToChannel(float value) {
+        return static_cast<unsigned char>(std::clamp(value + 0.5f, 0.0f, 255.0f));
+    }
+}
+
+TextureMap::TextureMap(const Color* pixels, int width, int height) {
+    // the chain: each level halves both sides, rounding down, down to 1x1
+    size_t size = 0;
+    for (int w = width, h = height;; w = std::max(1, w / 2), h = std::max(1, h / 2)) {
+        const int tiles_x = (w + kTileSize - 1) / kTileSize;
+        const int tiles_y = (h + kTileSize - 1) / kTileSize;
+        levels.push_back({w, h, tiles_x, size});
+        size += static_cast<size_t>(tiles_x) * tiles_y * kTileSize * kTileSize;
+        if (w == 1 && h == 1)
+            break;
+    }
+    texels.resize(size);
+
+    const Level& base = levels[0];
+    for (int y = 0; y < height; y++)
+        for (int x = 0; x < width; x++)
+            texels[Index(base, x, y)] = pixels[static_cast<size_t>(y) * width + x];
+
+    // box filter; a level of odd size repeats its last row or column
+    for (size_t l = 1; l < levels.size(); l++) {
+        const Level& source = levels[l - 1];
+        const Level& level = levels[l];
+        for (int y = 0; y < level.height; y++) {
+            const int y0 = std::min(2 * y, source.height - 1);
+            const int y1 = std::min(2 * y + 1, source.height - 1);
+            for (int x = 0; x < level.width; x++) {
+                const int x0 = std::min(2 * x, source.width - 1);
+                const int x1 = std::min(2 * x + 1, source.width - 1);
+                const Color c[4] = {texels[Index(source, x0, y0)], texels[Index(source, x1, y0)],
+                                    texels[Index(source, x0, y1)], texels[Index(source, x1, y1)]};
+                const auto average = [&c](unsigned char Color::*channel) {
+                    return static_cast<unsigned char>((c[0].*channel + c[1].*channel + c[2].*channel + c[3].*channel + 2) / 4);
+                };
+                texels[Index(level, x, y)] = {average(&Color::r), average(&Color::g), average(&Color::b), average(&Color::a)};
+            }
+        }
+    }
+}
+
+TextureMap TextureMap::Checkerboard(int size, int checks, Color a, Color b) {
+    std::vector<Color> pixels(static_cast<size_t>(size) * size);
+    for (int y = 0; y < size; y++)
+        for (int x = 0; x < size; x++)
+            pixels[static_cast<size_t>(y) * size + x] = ((x * checks / size + y * checks / size) % 2) ? b : a;
+    return {pixels.data(), size, size};
+}
+
+void TextureMap::Bilinear(const Level& level, float u, float v, float* rgba) const {
+    // texel centers are at half-integer positions
+    const float x = Wrap(u) * static_cast<float>(level.width) - 0.5f;
+    const float y = Wrap(v) * static_cast<float>(level.height) - 0.5f;
+    const float fx0 = std::floor(x);
+    const float fy0 = std::floor(y);
+    const float fx = x - fx0;
+    const float fy = y - fy0;
+    int x0 = static_cast<int>(fx0);
+    int y0 = static_cast<int>(fy0);
+    if (x0 < 0)
+        x0 += level.width;
+    if (y0 < 0)
+        y0 += level.height;
+    const int x1 = x0 + 1 < level.width ? x0 + 1 : 0;
+    const int y1 = y0 + 1 < level.height ? y0 + 1 : 0;
+
+    const Color c00 = texels[Index(level, x0, y0)];
+    const Color c10 = texels[Index(level, x1, y0)];
+    const Color c01 = texels[Index(level, x0, y1)];
+    const Color c11 = texels[Index(level, x1, y1)];
+    const float w00 = (1.0f - fx) * (1.0f - fy);
+    const float w10 = fx * (1.0f - fy);
+    const float w01 = (1.0f - fx) * fy;
+    const float w11 = fx * fy;
+    rgba[0] = c00.r * w00 + c10.r * w10 + c01.r * w01 + c11.r * w11;
+    rgba[1] = c00.g * w00 + c10.g * w10 + c01.g * w01 + c11.g * w11;
+    rgba[2] = c00.b * w00 + c10.b * w10 + c01.b * w01 + c11.b * w11;
+    rgba[3] = c00.a * w00 + c10.a * w10 + c01.a * w01 + c11.a * w11;
+}
+
+Color TextureMap::Sample(float u, float v, float lod) const {
+    const float last = static_cast<float>(levels.size() - 1);
+    // magnified textures use level 0; NaN goes there too
+    lod = lod > 0.0f ? std::min(lod, last) : 0.0f;
+
+    if (filter == TextureFilter::Nearest) {
+        const Level& level = levels[static_cast<size_t>(lod + 0.5f)];
+        const int x = std::min(static_cast<int>(Wrap(u) * static_cast<float>(level.width)), level.width - 1);
+        const int y = std::min(static_cast<int>(Wrap(v) * static_cast<float>(level.height)), level.height - 1);
+        return texels[Index(level, x, y)];
+    }
+
+    float rgba[4];
+    if (filter == TextureFilter::Bilinear) {
+        Bilinear(levels[static_cast<size_t>(lod + 0.5f)], u, v, rgba);
+    } else {
+        const auto fine = static_cast<size_t>(lod);
+        const float blend = lod - static_cast<float>(fine);
+        Bilinear(levels[fine], u, v, rgba);
+        if (blend > 0.0f) {
+            float coarse[4];
+            Bilinear(levels[fine + 1], u, v, coarse);
+            for (int c = 0; c < 4; c++)
+                rgba[c] += (coarse[c] - rgba[c]) * blend;
+        }
+    }
+    return {ToChannel(rgba[0]), ToChannel(rgba[1]), ToChannel(rgba[2]), ToChannel(rgba[3])};
+}
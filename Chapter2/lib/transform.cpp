@@ -0,0 +1,86 @@
+#include "graphics/transform.hpp"
+#include "graphics/profiler.hpp"
+#include "graphics/simd.hpp"
+#include "graphics/stats.hpp"
+#include "raymath.h"
+
+#include <algorithm>
+#include <atomic>
+
+using namespace graphics;
+
+namespace {
+    // every camera change gets a new version, so no instance trusts a matrix cached for another
+    std::atomic<uint64_t> next_camera_version{1};
+}
+
+ViewProjection::ViewProjection()
+    : view(MatrixIdentity()), projection(MatrixIdentity()), view_projection(MatrixIdentity()),
+      version(next_camera_version.fetch_add(1, std::memory_order_relaxed)) {}
+
+void ViewProjection::SetView(const Matrix& matrix) {
+    view = matrix;
+    view_projection = MatrixMultiply(view, projection);
+    version = next_camera_version.fetch_add(1, std::memory_order_relaxed);
+}
+
+void ViewProjection::SetProjection(const Matrix& matrix) {
+    projection = matrix;
+    view_projection = MatrixMultiply(view, projection);
+    version = next_camera_version.fetch_add(1, std::memory_order_relaxed);
+}
+
+Instance::Instance(const Mesh& instance_mesh)
+    : mesh(instance_mesh), model(MatrixIdentity()), model_view_projection(MatrixIdentity()) {}
+
+const Matrix& Instance::GetModelViewProjection(const ViewProjection& camera) {
+    if (dirty || cached_version != camera.GetVersion()) {
+        model_view_projection = MatrixMultiply(model, camera.GetViewProjection());
+        cached_version = camera.GetVersion();
+        dirty = false;
+    }
+    return model_view_projection;
+}
+
+void graphics::TransformVertices(const Mesh& mesh, const Matrix& to_clip, ClipVertexBuffer& out) {
+    GRAPHICS_PROFILE_ZONE("TransformVertices");
+    using namespace simd;
+    out.Resize(mesh.vertex_count);
+
+    // one row of the matrix per output coordinate
+    const Float8 xx = Float8::Broadcast(to_clip.m0), xy = Float8::Broadcast(to_clip.m4);
+    const Float8 xz = Float8::Broadcast(to_clip.m8), xw = Float8::Broadcast(to_clip.m12);
+    const Float8 yx = Float8::Broadcast(to_clip.m1), yy = Float8::Broadcast(to_clip.m5);
+    const Float8 yz = Float8::Broadcast(to_clip.m9), yw = Float8::Broadcast(to_clip.m13);
+    const Float8 zx = Float8::Broadcast(to_clip.m2), zy = Float8::Broadcast(to_clip.m6);
+    const Float8 zz = Float8::Broadcast(to_clip.m10), zw = Float8::Broadcast(to_clip.m14);
+    const Float8 wx = Float8::Broadcast(to_clip.m3), wy = Float8::Broadcast(to_clip.m7);
+    const Float8 wz = Float8::Broadcast(to_clip.m11), ww = Float8::Broadcast(to_clip.m15);
+
+    // the padding is transformed too, and then reset to the buffer's point inside the frustum
+    for (size_t i = 0; i < mesh.vertex_count; i += kWidth) {
+        const Float8 x = Float8::Load(mesh.x.data() + i);
+        const Float8 y = Float8::Load(mesh.y.data() + i);
+        const Float8 z = Float8::Load(mesh.z.data() + i);
+        MulAdd(xx, x, MulAdd(xy, y, MulAdd(xz, z, xw))).Store(out.x.data() + i);
+        MulAdd(yx, x, MulAdd(yy, y, MulAdd(yz, z, yw))).Store(out.y.data() + i);
+        MulAdd(zx, x, MulAdd(zy, y, MulAdd(zz, z, zw))).Store(out.z.data() + i);
+        MulAdd(wx, x, MulAdd(wy, y, MulAdd(wz, z, ww))).Store(out.w.data() + i);
+    }
+    const size_t padded = out.x.size();
+    for (size_t i = mesh.vertex_count; i < padded; i++) {
+        out.x[i] = 0.0f;
+        out.y[i] = 0.0f;
+        out.z[i] = 0.0f;
+        out.w[i] = 1.0f;
+    }
+
+    std::fill_n(out.intensity.begin(), padded, 1.0f);
+    std::copy_n(mesh.u.begin(), padded, out.u.begin());
+    std::copy_n(mesh.v.begin(), padded, out.v.begin());
+    GRAPHICS_STAT_ADD(VerticesTransformed, mesh.vertex_count);
+}
+
+void graphics::TransformVertices(Instance& instance, const ViewProjection& camera, ClipVertexBuffer& out) {
+    TransformVertices(instance.GetMesh(), instance.GetModelViewProjection(camera), out);
+}
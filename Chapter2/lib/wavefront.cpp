@@ -0,0 +1,465 @@
+#include "graphics/raytracing.hpp"
+#include "graphics/parallel.hpp"
+#include "graphics/profiler.hpp"
+#include "graphics/simd.hpp"
+#include "graphics/stats.hpp"
+#include "graphics/wavefront.hpp"
+#include "raymath.h"
+
+#include <algorithm>
+#include <chrono>
+#include <limits>
+
+using namespace graphics;
+using namespace graphics::wavefront;
+
+namespace {
+    // queue items handled by one task of a stage
+    constexpr size_t kChunkSize = 1024;
+
+    template <typename T>
+    void AppendVector(std::vector<T>& to, const std::vector<T>& from) {
+        to.insert(to.end(), from.begin(), from.end());
+    }
+
+    size_t ChunkCount(size_t items) {
+        return (items + kChunkSize - 1) / kChunkSize;
+    }
+
+    double SecondsSince(std::chrono::steady_clock::time_point start) {
+        return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    // bits per axis of the origin Morton code, the direction octant takes 3 more
+    constexpr int kMortonBits = 9;
+    constexpr int kKeyBits = 3 * kMortonBits + 3;
+
+    /**
+     * Spreads the low 9 bits of v so that two zero bits separate each of them,
+     * ready to be interleaved with the other two axes.
+     */
+    uint32_t SpreadBits(uint32_t v) {
+        v &= (1u << kMortonBits) - 1;
+        v = (v | (v << 16)) & 0x030000ffu;
+        v = (v | (v << 8)) & 0x0300f00fu;
+        v = (v | (v << 4)) & 0x030c30c3u;
+        v = (v | (v << 2)) & 0x09249249u;
+        return v;
+    }
+
+    /**
+     * Maps points of a box to cells of a 2^9 grid along each axis.
+     */
+    struct Quantizer {
+        float min[3];
+        float scale[3];
+
+        Quantizer(const std::vector<float>& x, const std::vector<float>& y, const std::vector<float>& z) : min{}, scale{} {
+            const std::vector<float>* axes[3] = {&x, &y, &z};
+            for (int a = 0; a < 3; a++) {
+                const auto [low, high] = std::minmax_element(axes[a]->begin(), axes[a]->end());
+                const float extent = axes[a]->empty() ? 0.0f : *high - *low;
+                min[a] = axes[a]->empty() ? 0.0f : *low;
+                scale[a] = extent > 0.0f ? static_cast<float>((1 << kMortonBits) - 1) / extent : 0.0f;
+            }
+        }
+
+        [[nodiscard]] uint32_t Key(float x, float y, float z, float dx, float dy, float dz) const {
+            const uint32_t octant = (dx < 0.0f ? 4u : 0u) | (dy < 0.0f ? 2u : 0u) | (dz < 0.0f ? 1u : 0u);
+            const auto cell = [this](float value, int axis) {
+                return static_cast<uint32_t>((value - min[axis]) * scale[axis]);
+            };
+            const uint32_t morton = (SpreadBits(cell(x, 0)) << 2) | (SpreadBits(cell(y, 1)) << 1) | SpreadBits(cell(z, 2));
+            return (octant << (3 * kMortonBits)) | morton;
+        }
+    };
+
+    /**
+     * Fills order with 0..n-1 sorted by keys: a stable LSD radix sort, 8 bits
+     * per pass. keys is left sorted too.
+     */
+    void RadixSort(std::vector<uint32_t>& keys, std::vector<uint32_t>& order,
+                   std::vector<uint32_t>& key_scratch, std::vector<uint32_t>& order_scratch) {
+        const size_t n = keys.size();
+        order.resize(n);
+        for (size_t i = 0; i < n; i++)
+            order[i] = static_cast<uint32_t>(i);
+        key_scratch.resize(n);
+        order_scratch.resize(n);
+
+        for (int shift = 0; shift < kKeyBits; shift += 8) {
+            size_t offsets[257] = {};
+            for (size_t i = 0; i < n; i++)
+                offsets[((keys[i] >> shift) & 0xff) + 1]++;
+            for (int digit = 0; digit < 256; digit++)
+                offsets[digit + 1] += offsets[digit];
+            for (size_t i = 0; i < n; i++) {
+                const size_t to = offsets[(keys[i] >> shift) & 0xff]++;
+                key_scratch[to] = keys[i];
+                order_scratch[to] = order[i];
+            }
+            keys.swap(key_scratch);
+            order.swap(order_scratch);
+        }
+    }
+}
+
+void RayQueue::Append(const RayQueue& other) {
+    AppendVector(ox, other.ox); AppendVector(oy, other.oy); AppendVector(oz, other.oz);
+    AppendVector(dx, other.dx); AppendVector(dy, other.dy); AppendVector(dz, other.dz);
+    AppendVector(throughput, other.throughput);
+    AppendVector(pixel, other.pixel);
+}
+
+void Raytracer::IntersectQueue(const RayQueue& rays, size_t begin, size_t end, float t_min, float* t, int* sphere) const {
+    using namespace simd;
+
+    const Float8 lower = Float8::Broadcast(t_min);
+    const Float8 inf = Float8::Broadcast(std::numeric_limits<float>::infinity());
+    const Float8 zero = Float8::Zero();
+    const Float8 two = Float8::Broadcast(2.0f);
+    const Float8 four = Float8::Broadcast(4.0f);
+    const Float8 one = Float8::Broadcast(1.0f);
+
+    for (size_t i = begin; i < end; i += kWidth) {
+        // the last block of the range is padded by repeating its last ray
+        float lanes[6][kWidth];
+        const float* sources[6] = {rays.ox.data(), rays.oy.data(), rays.oz.data(),
+                                   rays.dx.data(), rays.dy.data(), rays.dz.data()};
+        const size_t count = std::min<size_t>(kWidth, end - i);
+        for (int c = 0; c < 6; c++)
+            for (size_t lane = 0; lane < static_cast<size_t>(kWidth); lane++)
+                lanes[c][lane] = sources[c][i + std::min(lane, count - 1)];
+
+        const Float8 ox = Float8::Load(lanes[0]), oy = Float8::Load(lanes[1]), oz = Float8::Load(lanes[2]);
+        const Float8 dx = Float8::Load(lanes[3]), dy = Float8::Load(lanes[4]), dz = Float8::Load(lanes[5]);
+        const Float8 k1 = MulAdd(dx, dx, MulAdd(dy, dy, dz * dz));
+        const Float8 inv_2k1 = one / (two * k1);
+        const Float8 four_k1 = four * k1;
+
+        // sphere indices are kept as floats, exact up to 2^24 spheres
+        Float8 closest = inf;
+        Float8 closest_sphere = Float8::Broadcast(-1.0f);
+        for (size_t s = 0; s < spheres.size(); s++) {
+            const Float8 ocx = ox - Float8::Broadcast(sphere_arrays.cx[s]);
+            const Float8 ocy = oy - Float8::Broadcast(sphere_arrays.cy[s]);
+            const Float8 ocz = oz - Float8::Broadcast(sphere_arrays.cz[s]);
+
+            const Float8 k2 = two * MulAdd(ocx, dx, MulAdd(ocy, dy, ocz * dz));
+            const Float8 k3 = MulAdd(ocx, ocx, MulAdd(ocy, ocy, ocz * ocz)) - Float8::Broadcast(sphere_arrays.radius2[s]);
+            const Float8 discriminant = MulSub(k2, k2, four_k1 * k3);
+            const Mask8 crosses = discriminant >= zero;
+            if (!Any(crosses))
+                continue;
+
+            const Float8 root = Sqrt(Max(discriminant, zero));
+            const Float8 t1 = (zero - k2 + root) * inv_2k1;
+            const Float8 t2 = (zero - k2 - root) * inv_2k1;
+
+            // closest of the two roots that lies in (t_min, closest)
+            const Mask8 t1_ok = crosses & (t1 > lower) & (t1 < closest);
+            const Mask8 t2_ok = crosses & (t2 > lower) & (t2 < closest);
+            const Float8 candidate = Select(t2_ok, Select(t1_ok, Min(t1, t2), t2), t1);
+            const Mask8 closer = t1_ok | t2_ok;
+            closest = Select(closer, candidate, closest);
+            closest_sphere = Select(closer, Float8::Broadcast(static_cast<float>(s)), closest_sphere);
+        }
+
+        float t_out[kWidth], sphere_out[kWidth];
+        closest.Store(t_out);
+        closest_sphere.Store(sphere_out);
+        for (size_t lane = 0; lane < count; lane++) {
+            t[i + lane] = t_out[lane];
+            sphere[i + lane] = static_cast<int>(sphere_out[lane]);
+        }
+    }
+
+    GRAPHICS_STAT_ADD(IntersectionTests, (end - begin) * spheres.size());
+}
+
+void Raytracer::SortSecondaryRays(bool sort_rays, bool sort_shadows) {
+    GRAPHICS_PROFILE_ZONE("Wavefront::SortRays");
+    wavefront::Buffers& buffers = wavefront_buffers;
+
+    if (sort_rays && buffers.rays.Size() > 1) {
+        const RayQueue& rays = buffers.rays;
+        const Quantizer quantizer(rays.ox, rays.oy, rays.oz);
+        buffers.keys.resize(rays.Size());
+        for (size_t i = 0; i < rays.Size(); i++)
+            buffers.keys[i] = quantizer.Key(rays.ox[i], rays.oy[i], rays.oz[i], rays.dx[i], rays.dy[i], rays.dz[i]);
+        RadixSort(buffers.keys, buffers.order, buffers.key_scratch, buffers.order_scratch);
+
+        RayQueue& sorted = buffers.sorted_rays;
+        const std::vector<uint32_t>& order = buffers.order;
+        auto gather = [&order](auto& to, const auto& from) {
+            to.resize(order.size());
+            for (size_t k = 0; k < order.size(); k++)
+                to[k] = from[order[k]];
+        };
+        gather(sorted.ox, rays.ox); gather(sorted.oy, rays.oy); gather(sorted.oz, rays.oz);
+        gather(sorted.dx, rays.dx); gather(sorted.dy, rays.dy); gather(sorted.dz, rays.dz);
+        gather(sorted.throughput, rays.throughput);
+        gather(sorted.pixel, rays.pixel);
+        std::swap(buffers.rays, sorted);
+        sort_report.sorted_rays += buffers.rays.Size();
+    }
+
+    if (sort_shadows) {
+        // only the tracing order of the shadow rays changes: the resolve stage
+        // expects each surface's shadow rays next to each other
+        const SurfaceQueue& surfaces = buffers.surfaces;
+        const ShadowQueue& shadows = buffers.shadows;
+        const Quantizer quantizer(surfaces.px, surfaces.py, surfaces.pz);
+        buffers.keys.resize(shadows.Size());
+        for (size_t i = 0; i < shadows.Size(); i++) {
+            const int surface = shadows.surface[i];
+            const Vector3 point{surfaces.px[surface], surfaces.py[surface], surfaces.pz[surface]};
+            const Vector3 towards_light = lights.VectorFrom(static_cast<size_t>(shadows.light[i]), point);
+            buffers.keys[i] = quantizer.Key(point.x, point.y, point.z, towards_light.x, towards_light.y, towards_light.z);
+        }
+        RadixSort(buffers.keys, buffers.order, buffers.key_scratch, buffers.order_scratch);
+        sort_report.sorted_rays += shadows.Size();
+    }
+}
+
+void Raytracer::RenderWavefront(const Vector3& origin) {
+    Canvas& target = canvas.get();
+    const int width = target.GetWidth();
+    const int height = target.GetHeight();
+    const size_t pixels = static_cast<size_t>(width) * height;
+    stats::BeginFrame();
+    sort_report = {};
+
+    // color reaching each pixel, summed over the waves in the same order as
+    // Shade sums the bounces of a path
+    wavefront::Buffers& buffers = wavefront_buffers;
+    std::vector<float>& accum_r = buffers.accum_r;
+    std::vector<float>& accum_g = buffers.accum_g;
+    std::vector<float>& accum_b = buffers.accum_b;
+    accum_r.assign(pixels, 0.0f);
+    accum_g.assign(pixels, 0.0f);
+    accum_b.assign(pixels, 0.0f);
+    const Color background = target.GetBackground();
+    const float pixel_angle = target.GetPixelAngle();
+
+    RayQueue& rays = buffers.rays;
+    {
+        GRAPHICS_PROFILE_ZONE("Wavefront::Generate");
+        rays.ox.assign(pixels, origin.x); rays.oy.assign(pixels, origin.y); rays.oz.assign(pixels, origin.z);
+        rays.dx.resize(pixels); rays.dy.resize(pixels); rays.dz.resize(pixels);
+        rays.throughput.assign(pixels, 1.0f);
+        rays.pixel.resize(pixels);
+        ParallelFor(height, thread_count, [&](int py) {
+            const float y = static_cast<float>(height / 2 - py);
+            for (int px = 0; px < width; px++) {
+                const size_t i = static_cast<size_t>(py) * width + px;
+                const Vector3 direction = target.CanvasToViewPort(static_cast<float>(px - width / 2), y);
+                rays.dx[i] = direction.x; rays.dy[i] = direction.y; rays.dz[i] = direction.z;
+                rays.pixel[i] = static_cast<int>(i);
+            }
+        });
+        GRAPHICS_STAT_ADD(PrimaryRays, pixels);
+    }
+
+    std::vector<float>& hit_t = buffers.hit_t;
+    std::vector<int>& hit_sphere = buffers.hit_sphere;
+    std::vector<ChunkOutput>& outputs = buffers.chunks;
+    SurfaceQueue& surfaces = buffers.surfaces;
+    ShadowQueue& shadows = buffers.shadows;
+
+    // primary rays start at the projection plane, reflections just off the surface
+    float t_min = 1.0f;
+    for (int depth = 0; rays.Size() > 0; depth++) {
+        const size_t count = rays.Size();
+        const int chunks = static_cast<int>(ChunkCount(count));
+
+        {
+            GRAPHICS_PROFILE_ZONE("Wavefront::Intersect");
+            const auto start = std::chrono::steady_clock::now();
+            hit_t.resize(count);
+            hit_sphere.resize(count);
+            ParallelFor(chunks, thread_count, [&](int chunk) {
+                const size_t begin = chunk * kChunkSize;
+                IntersectQueue(rays, begin, std::min(begin + kChunkSize, count), t_min, hit_t.data(), hit_sphere.data());
+            });
+            if (depth > 0)
+                sort_report.trace_seconds += SecondsSince(start);
+        }
+
+        {
+            GRAPHICS_PROFILE_ZONE("Wavefront::Shade");
+            // never shrunk, so the chunk queues keep their memory for the next waves and frames
+            if (outputs.size() < static_cast<size_t>(chunks))
+                outputs.resize(chunks);
+            ParallelFor(chunks, thread_count, [&](int chunk) {
+                ChunkOutput& out = outputs[chunk];
+                out.surfaces.Clear();
+                out.shadows.Clear();
+                out.reflections.Clear();
+                std::vector<float>& terms = out.terms;
+                terms.resize(simd::PaddedSize(lights.Size()));
+
+                const size_t begin = chunk * kChunkSize;
+                const size_t end = std::min(begin + kChunkSize, count);
+                for (size_t i = begin; i < end; i++) {
+                    const int pixel = rays.pixel[i];
+                    const float throughput = rays.throughput[i];
+
+                    // each pixel has at most one ray per wave, so no two chunks write the same pixel
+                    if (hit_sphere[i] < 0) {
+                        accum_r[pixel] += static_cast<float>(background.r) * throughput;
+                        accum_g[pixel] += static_cast<float>(background.g) * throughput;
+                        accum_b[pixel] += static_cast<float>(background.b) * throughput;
+                        continue;
+                    }
+                    GRAPHICS_STAT_INC(Hits);
+
+                    const Sphere& sphere = spheres[hit_sphere[i]];
+                    const Vector3 direction{rays.dx[i], rays.dy[i], rays.dz[i]};
+                    const Vector3 point = Vector3Add(Vector3{rays.ox[i], rays.oy[i], rays.oz[i]}, Vector3Scale(direction, hit_t[i]));
+                    const Vector3 normal = Vector3Normalize(Vector3Subtract(point, sphere.center));
+                    const Vector3 view = Vector3Negate(direction);
+
+                    const float r = sphere.reflective;
+                    const bool reflects = r > 0.0f && depth < reflection.max_depth && throughput * r >= reflection.min_throughput;
+
+                    SurfaceQueue& surface = out.surfaces;
+                    const int surface_index = static_cast<int>(surface.Size());
+                    surface.pixel.push_back(pixel);
+                    surface.px.push_back(point.x);
+                    surface.py.push_back(point.y);
+                    surface.pz.push_back(point.z);
+                    surface.weight.push_back(reflects ? throughput * (1.0f - r) : throughput);
+                    const Color base = SurfaceColor(sphere, normal, hit_t[i] * Vector3Length(direction) * pixel_angle);
+                    surface.r.push_back(base.r);
+                    surface.g.push_back(base.g);
+                    surface.b.push_back(base.b);
+                    surface.first_shadow.push_back(static_cast<int>(out.shadows.Size()));
+
+                    if (lights.Empty()) {
+                        surface.ambient.push_back(1.0f);
+                        surface.shadow_count.push_back(-1);
+                    } else {
+                        // one shadow ray per light that would add something
+                        lights.ComputeTerms(point, normal, view, sphere.specular, terms.data());
+                        int emitted = 0;
+                        for (size_t l = 0; l < lights.Size(); l++) {
+                            if (terms[l] <= 0.0f)
+                                continue;
+                            out.shadows.surface.push_back(surface_index);
+                            out.shadows.light.push_back(static_cast<int>(l));
+                            out.shadows.term.push_back(terms[l]);
+                            emitted++;
+                        }
+                        surface.ambient.push_back(lights.Ambient());
+                        surface.shadow_count.push_back(emitted);
+                    }
+
+                    if (reflects) {
+                        // R = 2 N <N, V> - V
+                        const Vector3 reflected = Vector3Subtract(Vector3Scale(normal, 2.0f * Vector3DotProduct(normal, view)), view);
+                        out.reflections.Push(point.x, point.y, point.z, reflected.x, reflected.y, reflected.z, throughput * r, pixel);
+                        GRAPHICS_STAT_INC(ReflectionRays);
+                    }
+                }
+            });
+
+            // gather the chunk queues, shifting the indices each chunk's queues use into the others
+            surfaces.Clear();
+            shadows.Clear();
+            rays.Clear();
+            for (int chunk = 0; chunk < chunks; chunk++) {
+                const ChunkOutput& out = outputs[chunk];
+                const int shadow_offset = static_cast<int>(shadows.Size());
+                const int surface_offset = static_cast<int>(surfaces.Size());
+                for (int first : out.surfaces.first_shadow)
+                    surfaces.first_shadow.push_back(first + shadow_offset);
+                for (int surface : out.shadows.surface)
+                    shadows.surface.push_back(surface + surface_offset);
+                AppendVector(surfaces.pixel, out.surfaces.pixel);
+                AppendVector(surfaces.px, out.surfaces.px);
+                AppendVector(surfaces.py, out.surfaces.py);
+                AppendVector(surfaces.pz, out.surfaces.pz);
+                AppendVector(surfaces.weight, out.surfaces.weight);
+                AppendVector(surfaces.r, out.surfaces.r);
+                AppendVector(surfaces.g, out.surfaces.g);
+                AppendVector(surfaces.b, out.surfaces.b);
+                AppendVector(surfaces.ambient, out.surfaces.ambient);
+                AppendVector(surfaces.shadow_count, out.surfaces.shadow_count);
+
+                AppendVector(shadows.light, out.shadows.light);
+                AppendVector(shadows.term, out.shadows.term);
+
+                rays.Append(out.reflections);
+            }
+        }
+
+        if (ray_sorting) {
+            const auto start = std::chrono::steady_clock::now();
+            SortSecondaryRays(true, true);
+            sort_report.sort_seconds += SecondsSince(start);
+        }
+
+        {
+            GRAPHICS_PROFILE_ZONE("Wavefront::Shadow");
+            const auto start = std::chrono::steady_clock::now();
+            shadows.visible.resize(shadows.Size());
+            ParallelFor(static_cast<int>(ChunkCount(shadows.Size())), thread_count, [&](int chunk) {
+                const size_t begin = chunk * kChunkSize;
+                const size_t end = std::min(begin + kChunkSize, shadows.Size());
+                for (size_t k = begin; k < end; k++) {
+                    // sorted rays are traced in key order, the result goes back to their own slot
+                    const size_t i = ray_sorting ? buffers.order[k] : k;
+                    const int surface = shadows.surface[i];
+                    const Vector3 point{surfaces.px[surface], surfaces.py[surface], surfaces.pz[surface]};
+                    shadows.visible[i] = !LightOccluded(point, static_cast<size_t>(shadows.light[i]));
+                }
+            });
+            sort_report.trace_seconds += SecondsSince(start);
+        }
+
+        {
+            GRAPHICS_PROFILE_ZONE("Wavefront::Resolve");
+            ParallelFor(static_cast<int>(ChunkCount(surfaces.Size())), thread_count, [&](int chunk) {
+                const size_t begin = chunk * kChunkSize;
+                const size_t end = std::min(begin + kChunkSize, surfaces.Size());
+                for (size_t i = begin; i < end; i++) {
+                    // light reaching the surface, summed in light order as in LocalColor
+                    float intensity = surfaces.ambient[i];
+                    const int first = surfaces.first_shadow[i];
+                    for (int s = first; s < first + surfaces.shadow_count[i]; s++)
+                        if (shadows.visible[s])
+                            intensity += shadows.term[s];
+
+                    // the local color is quantized like LocalColor's before being weighted
+                    auto channel = [intensity](float value) {
+                        return static_cast<float>(static_cast<unsigned char>(std::clamp(value * intensity, 0.0f, 255.0f)));
+                    };
+                    const int pixel = surfaces.pixel[i];
+                    const float weight = surfaces.weight[i];
+                    accum_r[pixel] += channel(surfaces.r[i]) * weight;
+                    accum_g[pixel] += channel(surfaces.g[i]) * weight;
+                    accum_b[pixel] += channel(surfaces.b[i]) * weight;
+                }
+            });
+        }
+
+        t_min = kSurfaceEpsilon;
+    }
+
+    {
+        GRAPHICS_PROFILE_ZONE("PutPixel");
+        for (int py = 0; py < height; py++) {
+            for (int px = 0; px < width; px++) {
+                const size_t i = static_cast<size_t>(py) * width + px;
+                target.PutPixel(px, py, Color{
+                    static_cast<unsigned char>(std::min(accum_r[i] + 0.5f, 255.0f)),
+                    static_cast<unsigned char>(std::min(accum_g[i] + 0.5f, 255.0f)),
+                    static_cast<unsigned char>(std::min(accum_b[i] + 0.5f, 255.0f)),
+                    255});
+            }
+        }
+    }
+
+    stats::EndFrame();
+}
@@ -1,5 +1,11 @@
 #include "graphics/canvas.hpp"
+#include "graphics/path_tracer.hpp"
+#include "graphics/profiler.hpp"
 #include "graphics/raytracing.hpp"
+#include "graphics/scenes.hpp"
+#include "graphics/simd.hpp"
+#include "graphics/stats.hpp"
+#include "graphics/temporal.hpp"
 #include "raylib.h"
 #include <iostream>
 #include <limits>
@@ -8,6 +14,10 @@
 using namespace graphics;
 
 int main() {
+    if (!graphics::simd::CpuSupported()) {
+        std::cerr << graphics::simd::kCpuUnsupportedMessage << std::endl;
+        return 1;
+    }
     std::cout << "=== Graphics from Scratch - Simple Version ===" << std::endl;
     std::cout << "Canvas coordinate system: Center origin, Y+ points up" << std::endl;
     std::cout << "Press ESC or close window to exit" << std::endl;
@@ -20,6 +30,8 @@ int main() {
     Canvas canvas(canvasWidth, canvasHeight, "Computer Graphics from Scratch - Simple");
     canvas.SetViewPort(1.0f, 1.0f, 1.0f);
     Raytracer raytracer(canvas);
+    PathTracer path_tracer(canvas, raytracer);
+    TemporalAccumulator accumulator(canvas, raytracer);
 
     std::cout << "Canvas created: " << canvasWidth << "x" << canvasHeight << std::endl;
     std::cout << "ViewWidth: " << canvas.GetViewWidth() << ", ViewHeight: " << canvas.GetViewHeight() << std::endl;
@@ -27,21 +39,76 @@ int main() {
 
     canvas.Clear(WHITE);
 
-    for (int x = -canvas.GetWidth()/2; x <= canvas.GetWidth()/2; x += 1) {
-        for (int y = -canvas.GetHeight()/2; y <= canvas.GetHeight()/2; y += 1) {
-            Vector3 direction = canvas.CanvasToViewPort(x, y);
-            Color color = raytracer.TraceRay(CameraPosition, direction, 1, std::numeric_limits<float>::infinity());
-            canvas.PutPixelCentered(x, y, color);
-        }
-    }
-    
+    // Supersample only the pixels on sphere silhouettes
+    raytracer.SetAntiAliasing(AntiAliasing::Adaptive);
+    raytracer.Render(CameraPosition);
+
+    if (stats::Enabled())
+        std::cout << "Frame stats: " << stats::ToJson(stats::LastFrame()) << std::endl;
+
     canvas.Present();
 
     // Keep window open for viewing
+    bool heatmap = false;
+    bool path_tracing = false;
+    bool denoising = false;
+    bool textured = false;
     while (!canvas.ShouldClose()) {
+        // P switches to the progressive path tracer, which refines the image every frame
+        if (IsKeyPressed(KEY_P)) {
+            path_tracing = !path_tracing;
+            path_tracer.Reset();
+            if (!path_tracing) {
+                raytracer.Render(CameraPosition);
+                accumulator.Reset();
+            }
+        }
+        if (path_tracing) {
+            // a frame's worth of work at most, the window stays responsive
+            path_tracer.RenderPass(CameraPosition, 1.0 / 30.0);
+        }
+        // D toggles the denoiser of the path traced image
+        if (IsKeyPressed(KEY_D)) {
+            denoising = !denoising;
+            path_tracer.SetDenoising(denoising);
+            std::cout << "Denoising " << (denoising ? "on" : "off") << std::endl;
+        }
+
+        // H toggles the per-pixel cost heatmap, its raw values go to cost_heatmap.csv
+        if (IsKeyPressed(KEY_H)) {
+            heatmap = !heatmap;
+            raytracer.SetOutput(heatmap ? RenderOutput::CostHeatmap : RenderOutput::Color, CostMetric::Cycles);
+            raytracer.Render(CameraPosition);
+            accumulator.Reset();
+            if (heatmap && raytracer.GetCostMap().ExportCsv("cost_heatmap.csv"))
+                std::cout << "Pixel costs written to cost_heatmap.csv" << std::endl;
+        }
+        // W switches between per-pixel and wavefront rendering
+        if (IsKeyPressed(KEY_W)) {
+            const bool wavefront = raytracer.GetRenderMode() == RenderMode::PerPixel;
+            raytracer.SetRenderMode(wavefront ? RenderMode::Wavefront : RenderMode::PerPixel);
+            raytracer.Render(CameraPosition);
+            accumulator.Reset();
+            std::cout << (wavefront ? "Wavefront" : "Per-pixel") << " rendering"
+                      << (wavefront && heatmap ? " (per-pixel while the heatmap is shown)" : "") << std::endl;
+        }
+        // T switches between the plain and the textured book scene
+        if (IsKeyPressed(KEY_T)) {
+            textured = !textured;
+            raytracer.SetScene(textured ? scenes::TexturedScene() : scenes::BookScene());
+            path_tracer.Reset();
+            raytracer.Render(CameraPosition);
+            accumulator.Reset();
+        }
+        // while the view is still, spare frame time adds jittered samples to the image
+        if (!path_tracing)
+            accumulator.Accumulate(CameraPosition, 1.0 / 60.0);
         canvas.Present();
     }
 
+    if (profiler::Enabled() && profiler::WriteChromeTrace("graphics_trace.json"))
+        std::cout << "Profile written to graphics_trace.json (open it in chrome://tracing)" << std::endl;
+
     std::cout << "Graphics from Scratch project terminated successfully." << std::endl;
     return 0;
 }
@@ -0,0 +1,124 @@
+#include "check.hpp"
+#include "images.hpp"
+#include "graphics/canvas.hpp"
+
+#include <algorithm>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+using namespace graphics;
+
+namespace {
+
+    constexpr int kWidth = 64;
+    constexpr int kHeight = 48;
+    // room around the canvas for lines drawn without clipping
+    constexpr int kMargin = 200;
+
+    Color SegmentColor(size_t i) {
+        return Color{static_cast<unsigned char>(1 + i % 251), static_cast<unsigned char>(i / 251 % 256), 128, 255};
+    }
+
+    /**
+     * @brief Draws segments on a canvas with room for all of them, then crops it to the small canvas.
+     *
+     * Moving a line by whole pixels moves each of its pixels alike, so this is
+     * the same line drawn without clipping.
+     */
+    std::vector<Color> DrawUnclipped(const std::vector<LineSegment>& segments) {
+        Canvas large(kWidth + 2 * kMargin, kHeight + 2 * kMargin, "graphics_tests", true);
+        large.Clear(BLACK);
+        std::vector<LineSegment> moved = segments;
+        for (LineSegment& line : moved) {
+            line.x0 += kMargin, line.y0 += kMargin;
+            line.x1 += kMargin, line.y1 += kMargin;
+        }
+        large.DrawLines(moved.data(), moved.size());
+
+        std::vector<Color> cropped;
+        cropped.reserve(static_cast<size_t>(kWidth) * kHeight);
+        for (int y = 0; y < kHeight; y++)
+            for (int x = 0; x < kWidth; x++)
+                cropped.push_back(large.GetFramebuffer()[static_cast<size_t>(y + kMargin) * large.GetWidth() + x + kMargin]);
+        return cropped;
+    }
+
+    std::vector<Color> DrawClipped(const std::vector<LineSegment>& segments) {
+        Canvas canvas(kWidth, kHeight, "graphics_tests", true);
+        canvas.Clear(BLACK);
+        canvas.DrawLines(segments.data(), segments.size());
+        return tests::Pixels(canvas);
+    }
+
+    size_t LitPixels(const std::vector<Color>& image) {
+        return static_cast<size_t>(std::count_if(image.begin(), image.end(), [](Color c) { return c.r != 0; }));
+    }
+
+} // namespace
+
+GRAPHICS_TEST(Canvas, LineInsideCoversEachStep) {
+    // one pixel per step of the longer axis, both end points included
+    const LineSegment lines[] = {{3, 4, 40, 17, WHITE}, {50, 2, 45, 40, WHITE}, {10, 30, 10, 30, WHITE},
+                                 {0, 0, kWidth - 1, 0, WHITE}, {kWidth - 1, kHeight - 1, 0, 0, WHITE}};
+    for (const LineSegment& line : lines) {
+        Canvas canvas(kWidth, kHeight, "graphics_tests", true);
+        canvas.Clear(BLACK);
+        canvas.DrawLine(line.x0, line.y0, line.x1, line.y1, RED);
+        const std::vector<Color> image = tests::Pixels(canvas);
+        const size_t steps = static_cast<size_t>(std::max(std::abs(line.x1 - line.x0), std::abs(line.y1 - line.y0))) + 1;
+        GRAPHICS_CHECK(LitPixels(image) == steps);
+        GRAPHICS_CHECK(image[static_cast<size_t>(line.y0) * kWidth + line.x0].r != 0);
+        GRAPHICS_CHECK(image[static_cast<size_t>(line.y1) * kWidth + line.x1].r != 0);
+    }
+}
+
+GRAPHICS_TEST(Canvas, ReversedLineIsSameLine) {
+    std::mt19937 rng(1);
+    std::uniform_int_distribution<int> x(-kMargin, kWidth + kMargin - 1), y(-kMargin, kHeight + kMargin - 1);
+    for (int k = 0; k < 500; k++) {
+        const LineSegment forward{x(rng), y(rng), x(rng), y(rng), WHITE};
+        const LineSegment reversed{forward.x1, forward.y1, forward.x0, forward.y0, WHITE};
+        GRAPHICS_CHECK(tests::SameImage(DrawClipped({forward}), DrawClipped({reversed})));
+    }
+}
+
+GRAPHICS_TEST(Canvas, OffCanvasLinesDrawNothing) {
+    const std::vector<LineSegment> outside = {
+        {-50, 10, -1, 30, WHITE},                          // left of the canvas
+        {kWidth, 0, kWidth + 90, kHeight, WHITE},          // right
+        {5, -40, 60, -1, WHITE},                           // above, shallow
+        {20, kHeight, 22, kHeight + 150, WHITE},           // below, steep
+        {-30, 10, 10, -30, WHITE},                         // past the top-left corner
+        {kWidth - 5, -20, kWidth + 20, 5, WHITE},          // past the top-right corner
+        {-kMargin, -kMargin, -kMargin, -kMargin, WHITE},   // a single pixel
+    };
+    GRAPHICS_CHECK(LitPixels(DrawClipped(outside)) == 0);
+    GRAPHICS_CHECK(LitPixels(DrawUnclipped(outside)) == 0);
+}
+
+GRAPHICS_TEST(Canvas, ClippedLinesMatchUnclipped) {
+    // lines crossing the borders in every direction, steep and shallow, given either way round
+    std::vector<LineSegment> segments = {
+        {-100, 20, 150, 25, WHITE}, {150, 25, -100, 20, WHITE}, {30, -100, 33, 150, WHITE},
+        {33, 150, 30, -100, WHITE}, {-10, -10, kWidth + 10, kHeight + 10, WHITE}, {-kMargin, kHeight - 1, kWidth, kHeight - 1, WHITE},
+        {0, -kMargin, 0, kHeight + kMargin - 1, WHITE}, {kWidth - 1, kHeight + 3, kWidth + 40, -60, WHITE},
+    };
+    std::mt19937 rng(2);
+    std::uniform_int_distribution<int> x(-kMargin, kWidth + kMargin - 1), y(-kMargin, kHeight + kMargin - 1);
+    for (int k = 0; k < 3000; k++)
+        segments.push_back({x(rng), y(rng), x(rng), y(rng), WHITE});
+    for (size_t i = 0; i < segments.size(); i++)
+        segments[i].color = SegmentColor(i);
+
+    const std::vector<Color> clipped = DrawClipped(segments);
+    GRAPHICS_CHECK(tests::SameImage(clipped, DrawUnclipped(segments)));
+    GRAPHICS_CHECK(LitPixels(clipped) > static_cast<size_t>(kWidth * kHeight / 2));
+
+    // DrawLine is one segment of DrawLines
+    Canvas canvas(kWidth, kHeight, "graphics_tests", true);
+    canvas.Clear(BLACK);
+    for (const LineSegment& line : segments)
+        canvas.DrawLine(line.x0, line.y0, line.x1, line.y1, line.color);
+    GRAPHICS_CHECK(tests::SameImage(clipped, tests::Pixels(canvas)));
+}
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <vector>
+
+/**
+ * A minimal test registry for graphics_tests, with no dependency beyond the
+ * standard library.
+ *
+ * Each test is a function registered under a group and a name with
+ * GRAPHICS_TEST. ctest runs the executable once per group, so a failure is
+ * reported against the part of the library it belongs to; GRAPHICS_CHECK
+ * prints the failed condition and lets the test go on.
+ */
+namespace graphics::tests {
+
+    /**
+     * @struct TestCase
+     * @brief A registered test.
+     */
+    struct TestCase {
+        const char* group;
+        const char* name;
+        void (*run)();
+    };
+
+    /**
+     * @brief Every registered test, in registration order.
+     */
+    std::vector<TestCase>& Registry();
+
+    /**
+     * @brief Records a failed check.
+     */
+    void Fail(const char* file, int line, const char* condition);
+
+    /**
+     * @struct Registration
+     * @brief Adds a test to the registry when a static instance is constructed.
+     */
+    struct Registration {
+        Registration(const char* group, const char* name, void (*run)()) {
+            Registry().push_back({group, name, run});
+        }
+    };
+
+} // namespace graphics::tests
+
+/**
+ * @brief Defines a test function and registers it as group.name.
+ */
+#define GRAPHICS_TEST(group, name)                                                             \
+    static void group##_##name();                                                              \
+    static const graphics::tests::Registration group##_##name##_registration(#group, #name,    \
+                                                                             group##_##name); \
+    static void group##_##name()
+
+/**
+ * @brief Fails the running test, without stopping it, if the condition is false.
+ */
+#define GRAPHICS_CHECK(condition) \
+    ((condition) ? static_cast<void>(0) : graphics::tests::Fail(__FILE__, __LINE__, #condition))
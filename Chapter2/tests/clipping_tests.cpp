@@ -0,0 +1,295 @@
+#include "check.hpp"
+#include "graphics/canvas.hpp"
+#include "graphics/clipping.hpp"
+#include "graphics/rasterizer.hpp"
+#include "graphics/stats.hpp"
+
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <random>
+#include <vector>
+
+using namespace graphics;
+
+namespace {
+
+    constexpr int kWidth = 64;
+    constexpr int kHeight = 48;
+    constexpr float kNear = 0.5f;
+
+    using Point = std::array<float, 3>;
+    using Triangle = std::array<Point, 3>;
+
+    /**
+     * @brief Clip-space vertices of camera-space corners, as ProjectionFromViewPort maps them.
+     */
+    ClipVertexBuffer ToClipSpace(const Canvas& canvas, const std::vector<Point>& corners) {
+        const Matrix projection = ProjectionFromViewPort(canvas, kNear);
+        ClipVertexBuffer vertices;
+        vertices.Resize(corners.size());
+        for (size_t i = 0; i < corners.size(); i++) {
+            const auto& [x, y, z] = corners[i];
+            vertices.x[i] = projection.m0 * x;
+            vertices.y[i] = projection.m5 * y;
+            vertices.z[i] = z + projection.m14;
+            vertices.w[i] = z;
+        }
+        return vertices;
+    }
+
+    /**
+     * @struct RayTest
+     * @brief What the eye ray through a pixel center sees of a triangle.
+     */
+    struct RayTest {
+        bool hit;       ///< The ray meets the triangle in front of the near plane
+        double margin;  ///< Distance in pixels to the nearest edge or near plane line, where rounding decides
+    };
+
+    /**
+     * @brief Intersects the eye ray through a pixel center with a clip-space triangle, without clipping.
+     *
+     * Solves for the triangle's clip-space barycentric weights along the ray
+     * (x, y, w) = s * (ndc_x, ndc_y, 1), in double: the ray hits when all
+     * weights are >= 0 with s > 0, then z >= 0. Each weight, and z, is a
+     * linear function of the screen position up to the common factor, so its
+     * zero is a line on the screen.
+     */
+    RayTest TraceRay(const ClipVertexBuffer& vertices, const uint32_t* triangle, int px, int py) {
+        const double ndc_x = (px + 0.5 - (kWidth / 2 + 0.5)) / (0.5 * kWidth);
+        const double ndc_y = ((kHeight / 2 + 0.5) - (py + 0.5)) / (0.5 * kHeight);
+        double x[3], y[3], w[3], z[3];
+        for (int k = 0; k < 3; k++) {
+            x[k] = vertices.x[triangle[k]];
+            y[k] = vertices.y[triangle[k]];
+            z[k] = vertices.z[triangle[k]];
+            w[k] = vertices.w[triangle[k]];
+        }
+        // weights up to a common factor: the corners' cofactors applied to the ray's direction
+        double weights[3], gradient_x[3], gradient_y[3], sum = 0.0, determinant = 0.0;
+        double depth = 0.0, depth_x = 0.0, depth_y = 0.0;
+        RayTest test{true, std::numeric_limits<double>::infinity()};
+        for (int k = 0; k < 3; k++) {
+            const int a = (k + 1) % 3, b = (k + 2) % 3;
+            const double cx = y[a] * w[b] - w[a] * y[b];
+            const double cy = w[a] * x[b] - x[a] * w[b];
+            const double cw = x[a] * y[b] - y[a] * x[b];
+            weights[k] = cx * ndc_x + cy * ndc_y + cw;
+            gradient_x[k] = cx / (0.5 * kWidth);
+            gradient_y[k] = -cy / (0.5 * kHeight);
+            test.margin = std::fmin(test.margin, std::fabs(weights[k]) / std::hypot(gradient_x[k], gradient_y[k]));
+            sum += weights[k];
+            determinant += x[k] * cx;
+            depth += weights[k] * z[k];
+            depth_x += gradient_x[k] * z[k];
+            depth_y += gradient_y[k] * z[k];
+        }
+        test.margin = std::fmin(test.margin, std::fabs(depth) / std::hypot(depth_x, depth_y));
+        // with every weight >= 0, s = w of the point has the sign of the determinant over sum
+        for (int k = 0; k < 3; k++)
+            test.hit = test.hit && weights[k] / sum >= 0.0;
+        test.hit = test.hit && sum != 0.0 && determinant / sum > 0.0 && depth / sum >= 0.0;
+        return test;
+    }
+
+    /**
+     * @brief Clips and draws one triangle in white on black.
+     * @return The number of screen triangles the clipper produced
+     */
+    size_t Draw(Canvas& canvas, const ClipVertexBuffer& vertices, const uint32_t* triangle, bool cull_back_faces) {
+        Clipper clipper(canvas);
+        clipper.SetBackFaceCulling(cull_back_faces);
+        std::vector<ScreenTriangle> triangles;
+        clipper.Clip(vertices, triangle, 1, WHITE, nullptr, triangles);
+        for (const ScreenTriangle& screen : triangles)
+            for (const ScreenVertex& vertex : screen.v)
+                GRAPHICS_CHECK(std::isfinite(vertex.x) && std::isfinite(vertex.y) && std::isfinite(vertex.z));
+        canvas.Clear(BLACK);
+        Rasterizer rasterizer(canvas);
+        rasterizer.DrawTriangles(triangles.data(), triangles.size());
+        return triangles.size();
+    }
+
+    bool Drawn(const Canvas& canvas, int x, int y) {
+        return canvas.GetFramebuffer()[y * canvas.GetWidth() + x].r != 0;
+    }
+
+    /**
+     * @brief Pixels where a drawn triangle disagrees with the ray test, leaving out the ones too close to an edge.
+     * @param covered Receives the number of pixels the ray test finds covered
+     *
+     * Snapping to 1/16 of a pixel and clipping in float move the edges by
+     * less than a tenth of a pixel.
+     */
+    int Mismatches(const Canvas& canvas, const ClipVertexBuffer& vertices, const uint32_t* triangle, int& covered) {
+        int mismatches = 0;
+        covered = 0;
+        for (int py = 0; py < kHeight; py++) {
+            for (int px = 0; px < kWidth; px++) {
+                const RayTest test = TraceRay(vertices, triangle, px, py);
+                if (test.margin < 0.1)
+                    continue;
+                covered += test.hit;
+                mismatches += test.hit != Drawn(canvas, px, py);
+            }
+        }
+        return mismatches;
+    }
+
+    /**
+     * @brief Random camera-space triangles, each with corners on both sides of the near plane.
+     * @param behind Whether the far side of the near plane reaches behind the camera
+     */
+    std::vector<Point> CrossingNearPlane(int count, uint32_t seed, bool behind) {
+        std::mt19937 rng(seed);
+        std::uniform_real_distribution<float> front(kNear + 0.1f, 6.0f), back(behind ? -3.0f : 0.05f, kNear - 0.05f);
+        std::uniform_real_distribution<float> spread(-1.2f, 1.2f);
+        std::vector<Point> corners;
+        for (int t = 0; t < count; t++) {
+            for (int k = 0; k < 3; k++) {
+                const float z = k == 0 ? front(rng) : k == 1 ? back(rng) : (t % 2 ? front(rng) : back(rng));
+                const float scale = std::fabs(z) + 0.5f;
+                corners.push_back({spread(rng) * scale, spread(rng) * scale, z});
+            }
+        }
+        return corners;
+    }
+
+    std::vector<uint32_t> Sequence(size_t count) {
+        std::vector<uint32_t> indices(count);
+        for (size_t i = 0; i < count; i++)
+            indices[i] = static_cast<uint32_t>(i);
+        return indices;
+    }
+
+} // namespace
+
+GRAPHICS_TEST(Clipping, NearPlaneMatchesRayTest) {
+    Canvas canvas(kWidth, kHeight, "graphics_tests", true);
+    for (const bool behind : {false, true}) {
+        const std::vector<Point> corners = CrossingNearPlane(300, behind ? 2 : 1, behind);
+        const ClipVertexBuffer vertices = ToClipSpace(canvas, corners);
+        const std::vector<uint32_t> indices = Sequence(corners.size());
+        int mismatches = 0, drawn_triangles = 0;
+        for (size_t t = 0; t < corners.size() / 3; t++) {
+            Draw(canvas, vertices, &indices[3 * t], false);
+            int covered = 0;
+            mismatches += Mismatches(canvas, vertices, &indices[3 * t], covered);
+            drawn_triangles += covered > 0;
+        }
+        GRAPHICS_CHECK(mismatches == 0);
+        GRAPHICS_CHECK(drawn_triangles > 100);
+    }
+}
+
+GRAPHICS_TEST(Clipping, GuardPlanesMatchRayTest) {
+    // a corner far beyond each guard plane, where an unclipped triangle would be too big to draw,
+    // and two in view so the triangle is never rejected
+    Canvas canvas(kWidth, kHeight, "graphics_tests", true);
+    const Matrix projection = ProjectionFromViewPort(canvas, kNear);
+    const float far_x = 300.0f * kWidth, far_y = 300.0f * kHeight;
+    const Point beyond[4] = {{-far_x, 0.0f, 2.0f}, {far_x, 0.0f, 2.0f}, {0.0f, -far_y, 2.0f}, {0.0f, far_y, 2.0f}};
+    std::mt19937 rng(3);
+    std::uniform_real_distribution<float> in_view(-0.9f, 0.9f), depth(1.0f, 4.0f);
+    const auto visible_corner = [&] {
+        const float z = depth(rng);
+        return Point{in_view(rng) * z / projection.m0, in_view(rng) * z / projection.m5, z};
+    };
+    for (const Point& outside : beyond) {
+        int mismatches = 0, covered_total = 0;
+        for (int t = 0; t < 50; t++) {
+            const ClipVertexBuffer vertices = ToClipSpace(canvas, {outside, visible_corner(), visible_corner()});
+            const uint32_t triangle[3] = {0, 1, 2};
+            stats::BeginFrame();
+            Draw(canvas, vertices, triangle, false);
+            const uint64_t clipped = stats::EndFrame().Get(stats::Counter::TrianglesClipped);
+            if constexpr (stats::Enabled())
+                GRAPHICS_CHECK(clipped == 1);
+            int covered = 0;
+            mismatches += Mismatches(canvas, vertices, triangle, covered);
+            covered_total += covered;
+        }
+        GRAPHICS_CHECK(mismatches == 0);
+        GRAPHICS_CHECK(covered_total > 1000);
+    }
+}
+
+GRAPHICS_TEST(Clipping, RejectsTrianglesOutsideOnePlane) {
+    Canvas canvas(kWidth, kHeight, "graphics_tests", true);
+    // left, right, bottom, top, in front of the near plane, then behind it and behind the camera
+    const std::vector<Triangle> outside = {
+        Triangle{Point{-9.0f, 0.0f, 2.0f}, Point{-3.0f, 5.0f, 3.0f}, Point{-20.0f, -8.0f, 4.0f}},
+        Triangle{Point{9.0f, 0.0f, 2.0f}, Point{30.0f, 5.0f, 3.0f}, Point{20.0f, -8.0f, 4.0f}},
+        Triangle{Point{0.0f, -9.0f, 2.0f}, Point{5.0f, -30.0f, 3.0f}, Point{-8.0f, -20.0f, 4.0f}},
+        Triangle{Point{0.0f, 9.0f, 2.0f}, Point{5.0f, 30.0f, 3.0f}, Point{-8.0f, 20.0f, 4.0f}},
+        Triangle{Point{-1.0f, 0.0f, 0.4f}, Point{1.0f, 0.0f, 0.2f}, Point{0.0f, 1.0f, 0.1f}},
+        Triangle{Point{-1.0f, 0.0f, -1.0f}, Point{1.0f, 0.0f, 0.0f}, Point{0.0f, 1.0f, -2.0f}},
+    };
+    for (const Triangle& triangle : outside) {
+        const ClipVertexBuffer vertices = ToClipSpace(canvas, {triangle.begin(), triangle.end()});
+        const uint32_t indices[3] = {0, 1, 2};
+        Clipper clipper(canvas);
+        std::vector<ScreenTriangle> out;
+        GRAPHICS_CHECK(clipper.Clip(vertices, indices, 1, WHITE, nullptr, out) == 0);
+        GRAPHICS_CHECK(out.empty());
+    }
+}
+
+GRAPHICS_TEST(Clipping, CornersOnTheEyePlane) {
+    // w = 0 at a corner: its perspective division is infinite, only the clipped polygon may be drawn
+    Canvas canvas(kWidth, kHeight, "graphics_tests", true);
+    std::mt19937 rng(4);
+    std::uniform_real_distribution<float> spread(-1.0f, 1.0f), depth(1.0f, 4.0f);
+    int mismatches = 0, covered_total = 0;
+    for (int t = 0; t < 100; t++) {
+        const float z = depth(rng);
+        const std::vector<Point> corners = {
+            {spread(rng), spread(rng), 0.0f}, {spread(rng) * z, spread(rng) * z, z}, {spread(rng) * z, spread(rng) * z, t % 2 ? z : 0.0f}};
+        const ClipVertexBuffer vertices = ToClipSpace(canvas, corners);
+        const uint32_t triangle[3] = {0, 1, 2};
+        Draw(canvas, vertices, triangle, false);
+        int covered = 0;
+        mismatches += Mismatches(canvas, vertices, triangle, covered);
+        covered_total += covered;
+    }
+    GRAPHICS_CHECK(mismatches == 0);
+    GRAPHICS_CHECK(covered_total > 0);
+}
+
+GRAPHICS_TEST(Clipping, BackFacesWithCornersBehindTheCamera) {
+    Canvas canvas(kWidth, kHeight, "graphics_tests", true);
+
+    // counter-clockwise seen from the camera, though the projection of the corner behind it turns the
+    // projected triangle clockwise: the (x, y, w) determinant still finds the front face
+    const std::vector<Point> front = {{-1.0f, -1.0f, 2.0f}, {1.0f, -1.0f, 2.0f}, {0.0f, 1.0f, -1.0f}};
+    const ClipVertexBuffer vertices = ToClipSpace(canvas, front);
+    const uint32_t counter_clockwise[3] = {0, 1, 2}, clockwise[3] = {0, 2, 1};
+    GRAPHICS_CHECK(Draw(canvas, vertices, counter_clockwise, true) > 0);
+    GRAPHICS_CHECK(Draw(canvas, vertices, clockwise, true) == 0);
+
+    // a triangle faces the camera when the eye is on its front side: the camera-space corners'
+    // determinant is positive. Only that winding is drawn, as the ray test sees it
+    const std::vector<Point> corners = CrossingNearPlane(200, 5, true);
+    const ClipVertexBuffer crossing = ToClipSpace(canvas, corners);
+    int mismatches = 0, culled = 0;
+    for (uint32_t t = 0; t < corners.size() / 3; t++) {
+        const Point& a = corners[3 * t];
+        const Point& b = corners[3 * t + 1];
+        const Point& c = corners[3 * t + 2];
+        const double determinant = a[0] * (double(b[1]) * c[2] - double(b[2]) * c[1]) -
+                                   a[1] * (double(b[0]) * c[2] - double(b[2]) * c[0]) +
+                                   a[2] * (double(b[0]) * c[1] - double(b[1]) * c[0]);
+        const uint32_t counter_clockwise_order[3] = {3 * t, 3 * t + 1, 3 * t + 2};
+        const uint32_t clockwise_order[3] = {3 * t, 3 * t + 2, 3 * t + 1};
+        const uint32_t* front_face = determinant > 0.0 ? counter_clockwise_order : clockwise_order;
+        const uint32_t* back_face = determinant > 0.0 ? clockwise_order : counter_clockwise_order;
+        culled += Draw(canvas, crossing, back_face, true) == 0;
+        Draw(canvas, crossing, front_face, true);
+        int covered = 0;
+        mismatches += Mismatches(canvas, crossing, front_face, covered);
+    }
+    GRAPHICS_CHECK(mismatches == 0);
+    GRAPHICS_CHECK(culled == static_cast<int>(corners.size() / 3));
+}
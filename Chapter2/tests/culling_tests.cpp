@@ -0,0 +1,171 @@
+#include "check.hpp"
+#include "images.hpp"
+#include "graphics/canvas.hpp"
+#include "graphics/clipping.hpp"
+#include "graphics/culling.hpp"
+#include "graphics/mesh.hpp"
+#include "graphics/transform.hpp"
+#include "raymath.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <random>
+#include <vector>
+
+using namespace graphics;
+
+namespace {
+
+    /**
+     * @brief A camera turned a little to the side, behind and below the origin.
+     */
+    ViewProjection TurnedCamera(const Canvas& canvas) {
+        ViewProjection camera;
+        camera.SetProjection(ProjectionFromViewPort(canvas, 0.5f));
+        camera.SetView(MatrixMultiply(MatrixRotateY(0.3f), MatrixTranslate(0.5f, -0.3f, 4.0f)));
+        return camera;
+    }
+
+    /**
+     * @brief Random spheres in a box around the camera, most of them outside its frustum.
+     */
+    BoundingSphereBuffer RandomSpheres(size_t count, uint32_t seed) {
+        std::mt19937 rng(seed);
+        std::uniform_real_distribution<float> position(-15.0f, 15.0f), radius(0.1f, 3.0f);
+        BoundingSphereBuffer spheres;
+        spheres.Resize(count);
+        for (size_t i = 0; i < count; i++)
+            spheres.Set(i, {position(rng), position(rng), position(rng)}, radius(rng));
+        return spheres;
+    }
+
+    /**
+     * @brief The spheres Intersects keeps, one at a time.
+     */
+    std::vector<uint32_t> ScalarCull(const Frustum& frustum, const BoundingSphereBuffer& spheres) {
+        std::vector<uint32_t> visible;
+        for (size_t i = 0; i < spheres.count; i++)
+            if (frustum.Intersects({spheres.x[i], spheres.y[i], spheres.z[i]}, spheres.radius[i]))
+                visible.push_back(static_cast<uint32_t>(i));
+        return visible;
+    }
+
+    /**
+     * @brief Draws some instances of a mesh as one batch of triangles, in the order given.
+     */
+    std::vector<Color> DrawInstances(Canvas& canvas, std::vector<Instance>& instances, const ViewProjection& camera,
+                                     const std::vector<uint32_t>& drawn) {
+        ClipVertexBuffer all, one;
+        std::vector<uint32_t> indices;
+        for (const uint32_t i : drawn) {
+            TransformVertices(instances[i], camera, one);
+            const size_t first = all.count;
+            all.Resize(first + one.count);
+            for (size_t v = 0; v < one.count; v++) {
+                all.x[first + v] = one.x[v];
+                all.y[first + v] = one.y[v];
+                all.z[first + v] = one.z[v];
+                all.w[first + v] = one.w[v];
+            }
+            for (const uint32_t index : instances[i].GetMesh().indices)
+                indices.push_back(static_cast<uint32_t>(first + index));
+        }
+        return tests::DrawClipped(canvas, all, indices.data(), indices.size() / 3);
+    }
+
+} // namespace
+
+GRAPHICS_TEST(Culling, PointsMatchClipSpace) {
+    Canvas canvas(320, 240, "graphics_tests", true);
+    const ViewProjection camera = TurnedCamera(canvas);
+    const Matrix& to_clip = camera.GetViewProjection();
+    const Frustum frustum(to_clip);
+
+    std::mt19937 rng(1);
+    std::uniform_real_distribution<float> position(-10.0f, 10.0f);
+    int inside = 0, outside = 0;
+    for (int k = 0; k < 100000; k++) {
+        const Vector3 point{position(rng), position(rng), position(rng)};
+        const Vector3 clip = Vector3Transform(point, to_clip);
+        const float w = to_clip.m3 * point.x + to_clip.m7 * point.y + to_clip.m11 * point.z + to_clip.m15;
+        // the clip conditions of ProjectionFromViewPort, away from their planes where rounding decides
+        const float conditions[Frustum::kPlaneCount] = {w + clip.x, w - clip.x, w + clip.y, w - clip.y, clip.z};
+        const float closest = *std::min_element(conditions, conditions + Frustum::kPlaneCount, [](float a, float b) {
+            return std::fabs(a) < std::fabs(b);
+        });
+        if (std::fabs(closest) < 1e-3f)
+            continue;
+        const bool in_frustum = std::all_of(conditions, conditions + Frustum::kPlaneCount, [](float c) { return c >= 0.0f; });
+        GRAPHICS_CHECK(frustum.Intersects(point, 0.0f) == in_frustum);
+        (in_frustum ? inside : outside)++;
+    }
+    GRAPHICS_CHECK(inside > 1000 && outside > 1000);
+}
+
+GRAPHICS_TEST(Culling, SimdMatchesScalar) {
+    Canvas canvas(320, 240, "graphics_tests", true);
+    const Frustum frustum(TurnedCamera(canvas).GetViewProjection());
+    std::vector<uint32_t> visible;
+
+    // every count of a few blocks, most of them with a partial last block
+    for (size_t count = 0; count <= 40; count++) {
+        const BoundingSphereBuffer spheres = RandomSpheres(count, static_cast<uint32_t>(count));
+        GRAPHICS_CHECK(frustum.Cull(spheres, visible) == visible.size());
+        GRAPHICS_CHECK(visible == ScalarCull(frustum, spheres));
+    }
+    const BoundingSphereBuffer many = RandomSpheres(10001, 7);
+    frustum.Cull(many, visible);
+    GRAPHICS_CHECK(visible == ScalarCull(frustum, many));
+    GRAPHICS_CHECK(!visible.empty() && visible.size() < many.count / 2);
+}
+
+GRAPHICS_TEST(Culling, PaddingLanesNeverVisible) {
+    Canvas canvas(320, 240, "graphics_tests", true);
+    const Frustum frustum(TurnedCamera(canvas).GetViewProjection());
+
+    // a buffer shrunk to 13 spheres keeps three visible ones in its padding
+    BoundingSphereBuffer spheres;
+    spheres.Resize(16);
+    for (size_t i = 0; i < 16; i++)
+        spheres.Set(i, {0.0f, 0.0f, 0.0f}, 1.0f);
+    spheres.Resize(13);
+    std::vector<uint32_t> visible;
+    GRAPHICS_CHECK(frustum.Cull(spheres, visible) == 13);
+    GRAPHICS_CHECK(visible.back() == 12);
+
+    // and none at all
+    spheres.Resize(0);
+    GRAPHICS_CHECK(frustum.Cull(spheres, visible) == 0);
+    GRAPHICS_CHECK(visible.empty());
+}
+
+GRAPHICS_TEST(Culling, CulledImageMatchesUnculled) {
+    Canvas canvas(320, 240, "graphics_tests", true);
+    const ViewProjection camera = TurnedCamera(canvas);
+    const Mesh sphere = Mesh::UvSphere({0.0f, 0.0f, 0.0f}, 1.0f, 16, 8);
+
+    // 203 objects all around the camera: a count that leaves a partial block of bounding spheres
+    const BoundingSphereBuffer positions = RandomSpheres(203, 11);
+    std::vector<Instance> instances;
+    BoundingSphereBuffer bounds;
+    bounds.Resize(positions.count);
+    for (size_t i = 0; i < positions.count; i++) {
+        const Vector3 center{positions.x[i], positions.y[i], positions.z[i]};
+        instances.emplace_back(sphere);
+        instances.back().SetModel(MatrixTranslate(center.x, center.y, center.z));
+        bounds.Set(i, center, 1.0f);
+    }
+
+    std::vector<uint32_t> all(instances.size());
+    for (size_t i = 0; i < all.size(); i++)
+        all[i] = static_cast<uint32_t>(i);
+    std::vector<uint32_t> visible;
+    Frustum(camera.GetViewProjection()).Cull(bounds, visible);
+
+    const std::vector<Color> unculled = DrawInstances(canvas, instances, camera, all);
+    const std::vector<Color> culled = DrawInstances(canvas, instances, camera, visible);
+    GRAPHICS_CHECK(tests::SameImage(unculled, culled));
+    GRAPHICS_CHECK(visible.size() < all.size() / 2);
+    GRAPHICS_CHECK(std::count_if(culled.begin(), culled.end(), [](Color c) { return c.r != 0; }) > 1000);
+}
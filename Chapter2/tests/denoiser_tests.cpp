@@ -0,0 +1,172 @@
+#include "check.hpp"
+#include "graphics/denoiser.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <vector>
+
+using namespace graphics;
+
+namespace {
+
+    constexpr int kWidth = 64;
+    constexpr int kHeight = 48;
+    constexpr size_t kPixels = static_cast<size_t>(kWidth) * kHeight;
+
+    /**
+     * @brief The planes of a DenoiserInput, filled per pixel.
+     */
+    struct Image {
+        std::vector<float> color[3], normal[3], depth, albedo[3];
+        std::vector<float> output[3];
+
+        Image() {
+            for (int c = 0; c < 3; c++) {
+                color[c].assign(kPixels, 0.0f);
+                normal[c].assign(kPixels, 0.0f);
+                albedo[c].assign(kPixels, 0.0f);
+                output[c].assign(kPixels, 0.0f);
+            }
+            depth.assign(kPixels, 0.0f);
+        }
+
+        /**
+         * @brief Sets one pixel: a surface of some albedo and normal, lit by a noisy irradiance.
+         */
+        void Set(size_t i, const float (&surface)[3], const float (&facing)[3], float lighting) {
+            for (int c = 0; c < 3; c++) {
+                color[c][i] = surface[c] * lighting;
+                albedo[c][i] = surface[c];
+                normal[c][i] = facing[c];
+            }
+            depth[i] = 3.0f;
+        }
+
+        void Denoise(int threads) {
+            DenoiserInput input;
+            input.width = kWidth;
+            input.height = kHeight;
+            for (int c = 0; c < 3; c++) {
+                input.color[c] = color[c].data();
+                input.normal[c] = normal[c].data();
+                input.albedo[c] = albedo[c].data();
+            }
+            input.depth = depth.data();
+            float* const planes[3] = {output[0].data(), output[1].data(), output[2].data()};
+            Denoiser().Denoise(input, planes, threads);
+        }
+    };
+
+    /**
+     * @brief Mean and variance of one channel over a column range, all rows.
+     */
+    void Moments(const std::vector<float>& plane, int x0, int x1, double& mean, double& variance) {
+        double sum = 0.0, squares = 0.0;
+        int count = 0;
+        for (int y = 0; y < kHeight; y++) {
+            for (int x = x0; x < x1; x++) {
+                const double value = plane[static_cast<size_t>(y) * kWidth + x];
+                sum += value;
+                squares += value * value;
+                count++;
+            }
+        }
+        mean = sum / count;
+        variance = squares / count - mean * mean;
+    }
+
+    /**
+     * @brief Irradiance of one sample per pixel around a mean: mostly dim samples and a few bright ones.
+     */
+    struct NoisyLight {
+        std::mt19937 rng;
+        std::exponential_distribution<float> distribution{1.0f};
+
+        explicit NoisyLight(uint32_t seed) : rng(seed) {}
+
+        float operator()(float mean) { return mean * distribution(rng); }
+    };
+
+    constexpr float kFacingCamera[3] = {0.0f, 0.0f, -1.0f};
+
+} // namespace
+
+GRAPHICS_TEST(Denoiser, FlatPlaneGetsSmoother) {
+    Image image;
+    NoisyLight light(1);
+    const float surface[3] = {0.6f, 0.5f, 0.4f};
+    for (size_t i = 0; i < kPixels; i++)
+        image.Set(i, surface, kFacingCamera, light(0.8f));
+    image.Denoise(4);
+
+    for (int c = 0; c < 3; c++) {
+        double noisy_mean, noisy_variance, mean, variance;
+        Moments(image.color[c], 0, kWidth, noisy_mean, noisy_variance);
+        Moments(image.output[c], 0, kWidth, mean, variance);
+            // a tenth of the variance; the color weights trust the rare bright samples less, which
+        // costs a few percent of the light
+        GRAPHICS_CHECK(variance < 0.15 * noisy_variance);
+        GRAPHICS_CHECK(std::fabs(mean - noisy_mean) < 0.1 * noisy_mean);
+    }
+}
+
+GRAPHICS_TEST(Denoiser, SameImageWithAnyThreadCount) {
+    Image one, many;
+    NoisyLight light_one(2), light_many(2);
+    const float surface[3] = {0.3f, 0.7f, 0.5f};
+    for (size_t i = 0; i < kPixels; i++) {
+        one.Set(i, surface, kFacingCamera, light_one(1.0f));
+        many.Set(i, surface, kFacingCamera, light_many(1.0f));
+    }
+    one.Denoise(1);
+    many.Denoise(4);
+    for (int c = 0; c < 3; c++)
+        GRAPHICS_CHECK(one.output[c] == many.output[c]);
+}
+
+GRAPHICS_TEST(Denoiser, AlbedoEdgeKept) {
+    // a red and a blue surface side by side, in the same noisy light
+    Image image;
+    NoisyLight light(3);
+    const float red[3] = {0.9f, 0.1f, 0.1f}, blue[3] = {0.1f, 0.1f, 0.9f};
+    const int edge = kWidth / 2;
+    for (int y = 0; y < kHeight; y++)
+        for (int x = 0; x < kWidth; x++)
+            image.Set(static_cast<size_t>(y) * kWidth + x, x < edge ? red : blue, kFacingCamera, light(1.0f));
+    image.Denoise(4);
+
+    // the columns along the edge keep their own surface's color, as far from the edge
+    double red_near, red_far, blue_near, blue_far, variance;
+    Moments(image.output[2], edge - 1, edge, red_near, variance);
+    Moments(image.output[2], 0, edge - 8, red_far, variance);
+    Moments(image.output[0], edge, edge + 1, blue_near, variance);
+    Moments(image.output[0], edge + 8, kWidth, blue_far, variance);
+    GRAPHICS_CHECK(std::fabs(red_near - red_far) < 0.03);
+    GRAPHICS_CHECK(std::fabs(blue_near - blue_far) < 0.03);
+}
+
+GRAPHICS_TEST(Denoiser, NormalEdgeKept) {
+    // a fold between a dim face and a lit face of the same gray surface
+    Image image;
+    NoisyLight light(4);
+    const float gray[3] = {0.5f, 0.5f, 0.5f};
+    const float dim_facing[3] = {-0.8f, 0.0f, -0.6f}, lit_facing[3] = {0.8f, 0.0f, -0.6f};
+    const int edge = kWidth / 2;
+    for (int y = 0; y < kHeight; y++) {
+        for (int x = 0; x < kWidth; x++) {
+            const bool lit = x >= edge;
+            image.Set(static_cast<size_t>(y) * kWidth + x, gray, lit ? lit_facing : dim_facing, light(lit ? 1.0f : 0.1f));
+        }
+    }
+    image.Denoise(4);
+
+    double dim_near, dim_far, lit_near, lit_far, variance;
+    Moments(image.output[1], edge - 1, edge, dim_near, variance);
+    Moments(image.output[1], 0, edge - 8, dim_far, variance);
+    Moments(image.output[1], edge, edge + 1, lit_near, variance);
+    Moments(image.output[1], edge + 8, kWidth, lit_far, variance);
+    // no light bleeds into the dim side, which is ten times darker
+    GRAPHICS_CHECK(std::fabs(dim_near - dim_far) < 0.2 * dim_far);
+    GRAPHICS_CHECK(std::fabs(lit_near - lit_far) < 0.1 * lit_far);
+}
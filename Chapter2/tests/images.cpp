@@ -0,0 +1,29 @@
+#include "images.hpp"
+#include "graphics/rasterizer.hpp"
+
+#include <cstring>
+
+using namespace graphics;
+
+std::vector<Color> tests::Pixels(const Canvas& canvas) {
+    const Color* pixels = canvas.GetFramebuffer();
+    return {pixels, pixels + static_cast<size_t>(canvas.GetWidth()) * canvas.GetHeight()};
+}
+
+bool tests::SameImage(const std::vector<Color>& a, const std::vector<Color>& b) {
+    return a.size() == b.size() && std::memcmp(a.data(), b.data(), a.size() * sizeof(Color)) == 0;
+}
+
+std::vector<Color> tests::DrawClipped(Canvas& canvas, const ClipVertexBuffer& vertices, const uint32_t* indices,
+                                      size_t triangle_count) {
+    Clipper clipper(canvas);
+    clipper.SetBackFaceCulling(true);
+    std::vector<ScreenTriangle> triangles;
+    clipper.Clip(vertices, indices, triangle_count, WHITE, nullptr, triangles);
+    Rasterizer rasterizer(canvas);
+    rasterizer.SetDepthTest(true);
+    rasterizer.ClearDepth();
+    canvas.Clear(BLACK);
+    rasterizer.DrawTriangles(triangles.data(), triangles.size());
+    return Pixels(canvas);
+}
@@ -0,0 +1,37 @@
+#pragma once
+
+#include "raylib.h"
+#include "graphics/canvas.hpp"
+#include "graphics/clipping.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/**
+ * Helpers shared by the tests that compare rendered images.
+ */
+namespace graphics::tests {
+
+    /**
+     * @brief A copy of a canvas's framebuffer.
+     */
+    std::vector<Color> Pixels(const Canvas& canvas);
+
+    /**
+     * @brief Whether two images are equal, bit for bit.
+     */
+    bool SameImage(const std::vector<Color>& a, const std::vector<Color>& b);
+
+    /**
+     * @brief Draws clip-space triangles through the Clipper and Rasterizer onto a cleared canvas.
+     * @param canvas Canvas to draw on, cleared to black first
+     * @param vertices Clip-space vertices
+     * @param indices Three vertex indices per triangle
+     * @param triangle_count Number of triangles
+     * @return The image, with back faces culled and the depth test on
+     */
+    std::vector<Color> DrawClipped(Canvas& canvas, const ClipVertexBuffer& vertices, const uint32_t* indices,
+                                   size_t triangle_count);
+
+} // namespace graphics::tests
@@ -0,0 +1,57 @@
+#include "check.hpp"
+#include "graphics/simd.hpp"
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+
+/*
+ * graphics_tests - regression checks of graphics_lib.
+ *
+ * Usage: graphics_tests [group]
+ * Runs the tests of one group, or all of them, and exits with 1 if a check
+ * failed. ctest runs one group per test, for the SIMD paths the library was
+ * built with (GRAPHICS_ENABLE_AVX2 on or off).
+ */
+
+namespace {
+    int failures = 0;
+}
+
+std::vector<graphics::tests::TestCase>& graphics::tests::Registry() {
+    static std::vector<TestCase> registry;
+    return registry;
+}
+
+void graphics::tests::Fail(const char* file, int line, const char* condition) {
+    std::printf("  %s:%d: check failed: %s\n", file, line, condition);
+    failures++;
+}
+
+int main(int argc, char** argv) {
+    if (!graphics::simd::CpuSupported()) {
+        std::fprintf(stderr, "%s\n", graphics::simd::kCpuUnsupportedMessage);
+        return 1;
+    }
+    const char* group = argc > 1 ? argv[1] : nullptr;
+
+    int run = 0;
+    for (const auto& test : graphics::tests::Registry()) {
+        if (group && std::strcmp(group, test.group) != 0)
+            continue;
+        const int failures_before = failures;
+        const auto start = std::chrono::steady_clock::now();
+        std::printf("%s.%s\n", test.group, test.name);
+        test.run();
+        const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        std::printf("  %s (%.2f s)\n", failures == failures_before ? "ok" : "FAILED", seconds);
+        run++;
+    }
+
+    if (run == 0) {
+        std::printf("no tests in group %s\n", group ? group : "(all)");
+        return 1;
+    }
+    std::printf("%d tests, %d failed checks\n", run, failures);
+    return failures == 0 ? 0 : 1;
+}
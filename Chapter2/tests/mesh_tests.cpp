@@ -0,0 +1,115 @@
+#include "check.hpp"
+#include "images.hpp"
+#include "graphics/canvas.hpp"
+#include "graphics/clipping.hpp"
+#include "graphics/lights.hpp"
+#include "graphics/mesh.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <random>
+#include <set>
+#include <vector>
+
+using namespace graphics;
+
+namespace {
+
+    using Corner = std::array<float, 5>;
+    using Triangle = std::array<Corner, 3>;
+
+    /**
+     * @brief The triangles of a mesh by their corners' values, independent of vertex and triangle order.
+     *
+     * Each triangle is rotated to start at its smallest corner, which keeps its winding.
+     */
+    std::multiset<Triangle> Triangles(const Mesh& mesh) {
+        std::multiset<Triangle> triangles;
+        for (size_t t = 0; t < mesh.GetTriangleCount(); t++) {
+            Triangle triangle;
+            for (int c = 0; c < 3; c++) {
+                const uint32_t i = mesh.indices[3 * t + c];
+                triangle[c] = {mesh.x[i], mesh.y[i], mesh.z[i], mesh.u[i], mesh.v[i]};
+            }
+            std::rotate(triangle.begin(), std::min_element(triangle.begin(), triangle.end()), triangle.end());
+            triangles.insert(triangle);
+        }
+        return triangles;
+    }
+
+    /**
+     * @brief A sphere whose triangles are in random order, as a mesh with no locality at all.
+     */
+    Mesh ShuffledSphere() {
+        Mesh mesh = Mesh::UvSphere({0.3f, 0.2f, 5.0f}, 2.0f, 128, 64);
+        std::vector<size_t> order(mesh.GetTriangleCount());
+        for (size_t t = 0; t < order.size(); t++)
+            order[t] = t;
+        std::shuffle(order.begin(), order.end(), std::mt19937(1));
+        std::vector<uint32_t> indices;
+        for (const size_t t : order)
+            indices.insert(indices.end(), mesh.indices.begin() + 3 * t, mesh.indices.begin() + 3 * t + 3);
+        mesh.indices = indices;
+        return mesh;
+    }
+
+    /**
+     * @brief Draws a lit mesh through the vertex stage, clipper and rasterizer.
+     * @param transformed Receives the number of vertices the stage transformed
+     */
+    std::vector<Color> Render(const Mesh& mesh, Canvas& canvas, size_t& transformed) {
+        LightList lights;
+        lights.AddAmbient(0.2f);
+        lights.AddDirectional(0.8f, {-1.0f, 1.0f, -1.0f});
+        VertexStage stage;
+        stage.SetLighting(&lights, {0.0f, 0.0f, 0.0f});
+        ClipVertexBuffer vertices;
+        std::vector<uint32_t> indices;
+        transformed = stage.Process(mesh, ProjectionFromViewPort(canvas, 0.5f), vertices, indices);
+        return tests::DrawClipped(canvas, vertices, indices.data(), indices.size() / 3);
+    }
+
+} // namespace
+
+GRAPHICS_TEST(Mesh, OptimizeVertexCacheLowersAcmr) {
+    Canvas canvas(640, 480, "graphics_tests", true);
+    const Mesh strips = Mesh::UvSphere({0.3f, 0.2f, 5.0f}, 2.0f, 128, 64);
+    const Mesh shuffled = ShuffledSphere();
+    for (const Mesh* original : {&strips, &shuffled}) {
+        Mesh optimized = *original;
+        OptimizeVertexCache(optimized);
+        const size_t triangle_count = original->GetTriangleCount();
+        const float acmr_before = AverageCacheMissRatio(original->indices.data(), triangle_count);
+        const float acmr_after = AverageCacheMissRatio(optimized.indices.data(), triangle_count);
+
+        // the same triangles, each transformed about 0.7 times instead of once per strip or more
+        GRAPHICS_CHECK(Triangles(*original) == Triangles(optimized));
+        GRAPHICS_CHECK(acmr_after < 0.72f);
+        GRAPHICS_CHECK(acmr_after < acmr_before);
+
+        // the vertex stage transforms exactly the misses the ACMR counts, and draws the same image
+        size_t transformed_before = 0, transformed_after = 0;
+        const std::vector<Color> before = Render(*original, canvas, transformed_before);
+        const std::vector<Color> after = Render(optimized, canvas, transformed_after);
+        GRAPHICS_CHECK(transformed_before == static_cast<size_t>(std::lround(acmr_before * triangle_count)));
+        GRAPHICS_CHECK(transformed_after == static_cast<size_t>(std::lround(acmr_after * triangle_count)));
+        GRAPHICS_CHECK(tests::SameImage(before, after));
+    }
+}
+
+GRAPHICS_TEST(Mesh, AcmrOfKnownIndexLists) {
+    // one triangle per three new vertices misses every corner
+    const std::vector<uint32_t> separate = {0, 1, 2, 3, 4, 5, 6, 7, 8};
+    GRAPHICS_CHECK(AverageCacheMissRatio(separate.data(), 3) == 3.0f);
+
+    // a strip of n triangles needs n + 2 vertices
+    std::vector<uint32_t> strip;
+    for (uint32_t t = 0; t < 100; t++) {
+        if (t % 2 == 0)
+            strip.insert(strip.end(), {t, t + 1, t + 2});
+        else
+            strip.insert(strip.end(), {t + 1, t, t + 2});
+    }
+    GRAPHICS_CHECK(std::fabs(AverageCacheMissRatio(strip.data(), 100) - 1.02f) < 1e-6f);
+}
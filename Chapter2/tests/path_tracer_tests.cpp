@@ -0,0 +1,158 @@
+#include "check.hpp"
+#include "images.hpp"
+#include "graphics/canvas.hpp"
+#include "graphics/path_tracer.hpp"
+#include "graphics/raytracing.hpp"
+#include "graphics/scenes.hpp"
+
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <thread>
+#include <vector>
+
+using namespace graphics;
+
+namespace {
+
+    constexpr Vector3 kOrigin{0.0f, 0.0f, 0.0f};
+
+    /**
+     * @brief One matte sphere under ambient, point and directional light.
+     *
+     * A convex object alone lights nothing else, and sees the whole sky from
+     * each of its points, so the sky's light is exactly the book's ambient
+     * term: the path tracer computes the ray tracer's direct lighting.
+     */
+    Scene DirectLightOnly() {
+        Scene scene;
+        scene.spheres.push_back({{0.2f, -0.1f, 4.0f}, 1.2f, Color{200, 150, 90, 255}});
+        scene.lights.AddAmbient(0.1f);
+        scene.lights.AddPoint(0.6f, {2.0f, 1.0f, 0.0f});
+        scene.lights.AddDirectional(0.3f, {1.0f, 4.0f, 4.0f});
+        return scene;
+    }
+
+    /**
+     * @brief Whether a pixel and its eight neighbours all see a sphere, so no camera ray jittered inside it misses.
+     */
+    bool InsideSilhouette(const std::vector<Color>& image, int width, int height, int x, int y, Color background) {
+        for (int dy = -1; dy <= 1; dy++) {
+            for (int dx = -1; dx <= 1; dx++) {
+                const int nx = x + dx, ny = y + dy;
+                if (nx < 0 || ny < 0 || nx >= width || ny >= height)
+                    return false;
+                const Color c = image[static_cast<size_t>(ny) * width + nx];
+                if (c.r == background.r && c.g == background.g && c.b == background.b)
+                    return false;
+            }
+        }
+        return true;
+    }
+
+    /**
+     * @brief Mean absolute difference per channel between two images, over the pixels inside the silhouettes.
+     */
+    double MeanDifference(const std::vector<Color>& reference, const std::vector<Color>& image, int width, int height,
+                          Color background) {
+        double total = 0.0;
+        int pixels = 0;
+        for (int y = 0; y < height; y++) {
+            for (int x = 0; x < width; x++) {
+                if (!InsideSilhouette(reference, width, height, x, y, background))
+                    continue;
+                const size_t i = static_cast<size_t>(y) * width + x;
+                total += std::abs(reference[i].r - image[i].r) + std::abs(reference[i].g - image[i].g) +
+                         std::abs(reference[i].b - image[i].b);
+                pixels++;
+            }
+        }
+        return pixels == 0 ? 0.0 : total / (3.0 * pixels);
+    }
+
+    /**
+     * @brief Counts the pixels with no sample yet, and checks the others have one, row by row.
+     */
+    int EmptyPixels(const PathTracer& path_tracer, const Canvas& canvas) {
+        int empty = 0;
+        for (int y = 0; y < canvas.GetHeight(); y++) {
+            const uint32_t row = path_tracer.GetSampleCount(0, y);
+            GRAPHICS_CHECK(row <= 1);
+            for (int x = 0; x < canvas.GetWidth(); x++) {
+                // a pass only stops between rows
+                GRAPHICS_CHECK(path_tracer.GetSampleCount(x, y) == row);
+                empty += row == 0;
+            }
+        }
+        return empty;
+    }
+
+} // namespace
+
+GRAPHICS_TEST(PathTracer, ConvergesToDirectLighting) {
+    const int width = 160, height = 120;
+    Canvas canvas(width, height, "graphics_tests", true);
+    Raytracer raytracer(canvas);
+    raytracer.SetScene(DirectLightOnly());
+    raytracer.Render(kOrigin);
+    const std::vector<Color> direct = tests::Pixels(canvas);
+    const Color background = canvas.GetBackground();
+
+    PathTracer path_tracer(canvas, raytracer);
+    path_tracer.RenderPass(kOrigin);
+    const double one_sample = MeanDifference(direct, tests::Pixels(canvas), width, height, background);
+    for (int pass = 1; pass < 16; pass++)
+        GRAPHICS_CHECK(path_tracer.RenderPass(kOrigin));
+    const std::vector<Color> traced = tests::Pixels(canvas);
+    const double sixteen_samples = MeanDifference(direct, traced, width, height, background);
+
+    // only the camera rays' positions in the pixels are random here, the rest is the same light
+    GRAPHICS_CHECK(sixteen_samples < 1.0);
+    GRAPHICS_CHECK(sixteen_samples <= one_sample);
+
+    // the same samples with any number of threads
+    raytracer.SetThreadCount(1);
+    PathTracer single_thread(canvas, raytracer);
+    for (int pass = 0; pass < 16; pass++)
+        single_thread.RenderPass(kOrigin);
+    GRAPHICS_CHECK(tests::SameImage(traced, tests::Pixels(canvas)));
+}
+
+GRAPHICS_TEST(PathTracer, TimeBudgetStopsPass) {
+    Canvas canvas(320, 240, "graphics_tests", true);
+    Raytracer raytracer(canvas);
+    raytracer.SetScene(scenes::BookScene());
+    PathTracer path_tracer(canvas, raytracer);
+
+    // far less time than the rows take: the pass stops early and only whole rows got their sample
+    GRAPHICS_CHECK(!path_tracer.RenderPass(kOrigin, 1e-4));
+    const int empty = EmptyPixels(path_tracer, canvas);
+    GRAPHICS_CHECK(empty > 0);
+
+    // the next pass runs normally
+    GRAPHICS_CHECK(path_tracer.RenderPass(kOrigin));
+    GRAPHICS_CHECK(path_tracer.GetPassCount() == 2);
+    for (int y = 0; y < canvas.GetHeight(); y++)
+        for (int x = 0; x < canvas.GetWidth(); x++)
+            GRAPHICS_CHECK(path_tracer.GetSampleCount(x, y) >= 1);
+}
+
+GRAPHICS_TEST(PathTracer, InterruptStopsPass) {
+    Canvas canvas(640, 480, "graphics_tests", true);
+    Raytracer raytracer(canvas);
+    raytracer.SetScene(scenes::BookScene());
+    PathTracer path_tracer(canvas, raytracer);
+    path_tracer.SetConfig({64, 64, 1.0f});
+
+    // a pass that takes far longer than the wait, interrupted from another thread
+    bool completed = true;
+    std::thread pass([&] { completed = path_tracer.RenderPass(kOrigin); });
+    std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    path_tracer.Interrupt();
+    pass.join();
+    GRAPHICS_CHECK(!completed);
+    GRAPHICS_CHECK(EmptyPixels(path_tracer, canvas) > 0);
+
+    // the interrupt only ends the pass it hit
+    GRAPHICS_CHECK(path_tracer.RenderPass(kOrigin));
+}
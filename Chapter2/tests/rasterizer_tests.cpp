@@ -0,0 +1,352 @@
+#include "check.hpp"
+#include "graphics/canvas.hpp"
+#include "graphics/rasterizer.hpp"
+#include "graphics/stats.hpp"
+#include "graphics/texture.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <cstdint>
+#include <random>
+#include <utility>
+#include <vector>
+
+using namespace graphics;
+
+namespace {
+
+    /**
+     * @brief Whether a pixel is drawn by a triangle, tested on its own with 64-bit edge functions.
+     * @param weights Receives the corners' barycentric weights at the pixel's center, if it is drawn
+     *
+     * Snaps the corners to 1/16 of a pixel like the rasterizer, and applies
+     * the top-left rule to pixel centers exactly on an edge.
+     */
+    bool Covers(const ScreenTriangle& triangle, int px, int py, double weights[3]) {
+        int64_t x[3], y[3];
+        int order[3] = {0, 1, 2};
+        for (int i = 0; i < 3; i++) {
+            x[i] = std::llround(triangle.v[i].x * 16.0f);
+            y[i] = std::llround(triangle.v[i].y * 16.0f);
+        }
+        int64_t area = (x[1] - x[0]) * (y[2] - y[0]) - (x[2] - x[0]) * (y[1] - y[0]);
+        if (area == 0)
+            return false;
+        if (area < 0) {
+            std::swap(x[1], x[2]);
+            std::swap(y[1], y[2]);
+            std::swap(order[1], order[2]);
+            area = -area;
+        }
+
+        const int64_t center_x = px * 16 + 8;
+        const int64_t center_y = py * 16 + 8;
+        for (int edge = 0; edge < 3; edge++) {
+            const int next = (edge + 1) % 3;
+            const int64_t a = y[edge] - y[next];
+            const int64_t b = x[next] - x[edge];
+            const int64_t value = a * (center_x - x[edge]) + b * (center_y - y[edge]);
+            const bool top_left = a > 0 || (a == 0 && b > 0);
+            if (value < 0 || (value == 0 && !top_left))
+                return false;
+            // the edge opposite a corner weighs that corner
+            weights[order[(edge + 2) % 3]] = static_cast<double>(value) / static_cast<double>(area);
+        }
+        return true;
+    }
+
+    bool Drawn(const Canvas& canvas, int x, int y) {
+        return canvas.GetFramebuffer()[y * canvas.GetWidth() + x].r == 0;
+    }
+
+    /**
+     * @brief Depth of a triangle at a pixel it covers, interpolated in double.
+     */
+    double DepthAt(const ScreenTriangle& triangle, const double weights[3]) {
+        return weights[0] * triangle.v[0].z + weights[1] * triangle.v[1].z + weights[2] * triangle.v[2].z;
+    }
+
+    /**
+     * @brief Random triangles over and around a canvas, each with its index encoded in its color.
+     */
+    std::vector<ScreenTriangle> RandomTriangles(int count, float width, float height, float size, uint32_t seed) {
+        std::mt19937 rng(seed);
+        std::uniform_real_distribution<float> position_x(-size, width + size), position_y(-size, height + size);
+        std::uniform_real_distribution<float> offset(-size, size), depth(0.0f, 1.0f);
+        std::vector<ScreenTriangle> triangles(count);
+        for (int k = 0; k < count; k++) {
+            ScreenTriangle& triangle = triangles[k];
+            const float center_x = position_x(rng), center_y = position_y(rng);
+            for (auto& vertex : triangle.v)
+                vertex = {center_x + offset(rng), center_y + offset(rng), depth(rng)};
+            triangle.color = {static_cast<unsigned char>(k & 255), static_cast<unsigned char>(k >> 8), 7, 255};
+        }
+        return triangles;
+    }
+
+    /**
+     * @brief Index of the triangle that drew a pixel, -1 for the background.
+     */
+    int DrawnBy(const Canvas& canvas, int x, int y) {
+        const Color color = canvas.GetFramebuffer()[y * canvas.GetWidth() + x];
+        return color.b == 7 ? color.r + color.g * 256 : -1;
+    }
+
+} // namespace
+
+GRAPHICS_TEST(Rasterizer, EdgeFunctionsMatchBruteForce) {
+    const int width = 101, height = 77;
+    Canvas canvas(width, height, "graphics_tests", true);
+    Rasterizer rasterizer(canvas);
+
+    std::mt19937 rng(5);
+    std::uniform_real_distribution<float> position(-40.0f, 140.0f), offset(-8.0f, 8.0f);
+    const float scales[3] = {20.0f, 6.0f, 1.5f};
+    int mismatches = 0;
+    for (int k = 0; k < 3000; k++) {
+        ScreenTriangle triangle{};
+        triangle.color = BLACK;
+        const float center_x = position(rng), center_y = position(rng), scale = scales[k % 3];
+        for (auto& vertex : triangle.v)
+            vertex = {center_x + offset(rng) * scale, center_y + offset(rng) * scale};
+        // horizontal and vertical edges, and corners on pixel centers, exercise the fill rule
+        if (k % 10 == 0)
+            triangle.v[1].y = triangle.v[0].y;
+        if (k % 10 == 1)
+            triangle.v[2].x = triangle.v[1].x;
+        if (k % 10 == 2)
+            for (auto& vertex : triangle.v)
+                vertex = {std::floor(vertex.x) + 0.5f, std::floor(vertex.y) + 0.5f};
+
+        canvas.Clear(WHITE);
+        rasterizer.DrawTriangle(triangle);
+        double weights[3];
+        for (int y = 0; y < height; y++)
+            for (int x = 0; x < width; x++)
+                mismatches += Drawn(canvas, x, y) != Covers(triangle, x, y, weights);
+    }
+    GRAPHICS_CHECK(mismatches == 0);
+}
+
+GRAPHICS_TEST(Rasterizer, SharedEdgesCoverEachPixelOnce) {
+    const int width = 101, height = 77, cells = 9;
+    Canvas canvas(width, height, "graphics_tests", true);
+    Rasterizer rasterizer(canvas);
+
+    // a jittered grid reaching past the canvas, every cell split into two triangles
+    std::mt19937 rng(7);
+    std::uniform_real_distribution<float> jitter(-3.0f, 3.0f);
+    Vector2 grid[cells + 1][cells + 1];
+    for (int i = 0; i <= cells; i++) {
+        for (int j = 0; j <= cells; j++) {
+            const bool inner = i > 0 && i < cells && j > 0 && j < cells;
+            grid[i][j] = {-5.0f + j * (width + 10.0f) / cells + (inner ? jitter(rng) : 0.0f),
+                          -5.0f + i * (height + 10.0f) / cells + (inner ? jitter(rng) : 0.0f)};
+        }
+    }
+
+    std::vector<int> coverage(static_cast<size_t>(width) * height, 0);
+    const auto draw = [&](Vector2 a, Vector2 b, Vector2 c) {
+        ScreenTriangle triangle{};
+        triangle.v[0] = {a.x, a.y};
+        triangle.v[1] = {b.x, b.y};
+        triangle.v[2] = {c.x, c.y};
+        triangle.color = BLACK;
+        canvas.Clear(WHITE);
+        rasterizer.DrawTriangle(triangle);
+        for (int y = 0; y < height; y++)
+            for (int x = 0; x < width; x++)
+                coverage[static_cast<size_t>(y) * width + x] += Drawn(canvas, x, y);
+    };
+    for (int i = 0; i < cells; i++) {
+        for (int j = 0; j < cells; j++) {
+            draw(grid[i][j], grid[i][j + 1], grid[i + 1][j]);
+            draw(grid[i][j + 1], grid[i + 1][j + 1], grid[i + 1][j]);
+        }
+    }
+
+    int wrong = 0;
+    for (const int count : coverage)
+        wrong += count != 1;
+    GRAPHICS_CHECK(wrong == 0);
+}
+
+GRAPHICS_TEST(DepthTest, NearestTriangleWins) {
+    const int width = 203, height = 157;
+    Canvas canvas(width, height, "graphics_tests", true);
+    Rasterizer rasterizer(canvas);
+    rasterizer.SetThreadCount(1);
+    rasterizer.SetDepthTest(true);
+    rasterizer.ClearDepth();
+    canvas.Clear(WHITE);
+    const std::vector<ScreenTriangle> triangles = RandomTriangles(2000, width, height, 40.0f, 9);
+    rasterizer.DrawTriangles(triangles.data(), triangles.size());
+
+    // the nearest triangle at each pixel, by brute force
+    std::vector<double> nearest(static_cast<size_t>(width) * height, DepthBuffer::kFar);
+    std::vector<int> winner(nearest.size(), -1);
+    for (int k = 0; k < static_cast<int>(triangles.size()); k++) {
+        double weights[3];
+        for (int y = 0; y < height; y++) {
+            for (int x = 0; x < width; x++) {
+                const size_t pixel = static_cast<size_t>(y) * width + x;
+                if (Covers(triangles[k], x, y, weights) && DepthAt(triangles[k], weights) < nearest[pixel]) {
+                    nearest[pixel] = DepthAt(triangles[k], weights);
+                    winner[pixel] = k;
+                }
+            }
+        }
+    }
+
+    // float rounding may only swap triangles whose depths tie
+    int wrong_winners = 0;
+    double depth_error = 0.0;
+    for (int y = 0; y < height; y++) {
+        for (int x = 0; x < width; x++) {
+            const size_t pixel = static_cast<size_t>(y) * width + x;
+            const int drawn = DrawnBy(canvas, x, y);
+            double weights[3];
+            if (drawn != winner[pixel] &&
+                (drawn < 0 || !Covers(triangles[drawn], x, y, weights) ||
+                 std::fabs(DepthAt(triangles[drawn], weights) - nearest[pixel]) > 1e-5))
+                wrong_winners++;
+            depth_error = std::max(depth_error, std::fabs(rasterizer.GetDepthBuffer().Get(x, y) - nearest[pixel]));
+        }
+    }
+    GRAPHICS_CHECK(wrong_winners == 0);
+    GRAPHICS_CHECK(depth_error < 1e-5);
+}
+
+GRAPHICS_TEST(DepthTest, TileBoundsAndEarlyOuts) {
+    const int width = 203, height = 157;
+    Canvas canvas(width, height, "graphics_tests", true);
+    Rasterizer rasterizer(canvas);
+    rasterizer.SetThreadCount(1);
+    rasterizer.SetDepthTest(true);
+    rasterizer.ClearDepth();
+    canvas.Clear(WHITE);
+    const std::vector<ScreenTriangle> triangles = RandomTriangles(2000, width, height, 40.0f, 11);
+    rasterizer.DrawTriangles(triangles.data(), triangles.size());
+
+    // every tile's bounds hold all of its pixels
+    const DepthBuffer& depth = rasterizer.GetDepthBuffer();
+    const int tile = DepthBuffer::kTileSize;
+    int loose_bounds = 0;
+    for (int y = 0; y < height; y++)
+        for (int x = 0; x < width; x++)
+            loose_bounds += depth.Get(x, y) < depth.TileMin(x / tile, y / tile) ||
+                            depth.Get(x, y) > depth.TileMax(x / tile, y / tile);
+    GRAPHICS_CHECK(loose_bounds == 0);
+
+    // a quad over the whole canvas, then one behind it, which the tile bounds must reject
+    const auto quad = [&](float z, Color color) {
+        const ScreenVertex corners[4] = {{-8.0f, -8.0f, z}, {width + 8.0f, -8.0f, z},
+                                         {width + 8.0f, height + 8.0f, z}, {-8.0f, height + 8.0f, z}};
+        const ScreenTriangle halves[2] = {{{corners[0], corners[1], corners[2]}, color},
+                                          {{corners[0], corners[2], corners[3]}, color}};
+        rasterizer.DrawTriangles(halves, 2);
+    };
+    rasterizer.ClearDepth();
+    quad(0.25f, BLACK);
+    for (int ty = 0; ty * tile < height; ty++) {
+        for (int tx = 0; tx * tile < width; tx++) {
+            GRAPHICS_CHECK(depth.TileMin(tx, ty) == 0.25f && depth.TileMax(tx, ty) == 0.25f);
+        }
+    }
+    GRAPHICS_CHECK(depth.Occluded(0, 0, width - 1, height - 1, 0.5f));
+    GRAPHICS_CHECK(!depth.Occluded(0, 0, width - 1, height - 1, 0.125f));
+
+    stats::BeginFrame();
+    quad(0.5f, RED);
+    const stats::FrameStats& frame = stats::EndFrame();
+    if constexpr (stats::Enabled())
+        GRAPHICS_CHECK(frame.Get(stats::Counter::TrianglesOccluded) == 2 && frame.Get(stats::Counter::TilesPartial) == 0);
+    int changed = 0;
+    for (int y = 0; y < height; y++)
+        for (int x = 0; x < width; x++)
+            changed += !Drawn(canvas, x, y) || depth.Get(x, y) != 0.25f;
+    GRAPHICS_CHECK(changed == 0);
+}
+
+GRAPHICS_TEST(Shading, GouraudIsPerspectiveCorrect) {
+    const int width = 203, height = 157;
+    Canvas canvas(width, height, "graphics_tests", true);
+    Rasterizer rasterizer(canvas);
+
+    std::mt19937 rng(1);
+    std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+    int coverage_mismatches = 0, worst_error = 0;
+    for (int k = 0; k < 1000; k++) {
+        ScreenTriangle triangle{};
+        triangle.color = {200, 150, 100, 255};
+        for (auto& vertex : triangle.v) {
+            vertex.x = unit(rng) * 240.0f - 20.0f;
+            vertex.y = unit(rng) * 190.0f - 20.0f;
+            vertex.inv_w = 0.05f + unit(rng);
+            vertex.intensity = unit(rng) * 1.2f;
+        }
+
+        canvas.Clear(WHITE);
+        rasterizer.DrawTriangle(triangle);
+        for (int y = 0; y < height; y++) {
+            for (int x = 0; x < width; x++) {
+                double weights[3];
+                const Color drawn = canvas.GetFramebuffer()[y * width + x];
+                const bool background = drawn.r == 255 && drawn.g == 255 && drawn.b == 255;
+                if (!Covers(triangle, x, y, weights)) {
+                    coverage_mismatches += !background;
+                    continue;
+                }
+                // intensity / w and 1 / w are linear on the screen
+                double inv_w = 0.0, intensity = 0.0;
+                for (int i = 0; i < 3; i++) {
+                    inv_w += weights[i] * triangle.v[i].inv_w;
+                    intensity += weights[i] * triangle.v[i].intensity * triangle.v[i].inv_w;
+                }
+                const long expected = std::lround(std::clamp(200.0 * intensity / inv_w, 0.0, 255.0));
+                worst_error = std::max(worst_error, static_cast<int>(std::labs(expected - drawn.r)));
+            }
+        }
+    }
+    GRAPHICS_CHECK(coverage_mismatches == 0);
+    GRAPHICS_CHECK(worst_error <= 2);
+}
+
+GRAPHICS_TEST(Binning, SameImageWithAnyThreadCount) {
+    const int width = 643, height = 481;
+    const TextureMap texture = TextureMap::Checkerboard(64, 8, WHITE, RED);
+    std::vector<ScreenTriangle> triangles = RandomTriangles(5000, width, height, 80.0f, 3);
+    std::mt19937 rng(4);
+    std::uniform_real_distribution<float> unit(0.1f, 1.0f);
+    for (size_t k = 0; k < triangles.size(); k++) {
+        for (auto& vertex : triangles[k].v) {
+            vertex.inv_w = unit(rng);
+            vertex.intensity = unit(rng);
+            vertex.u = unit(rng);
+            vertex.v = unit(rng);
+        }
+        if (k % 3 == 0)
+            triangles[k].texture = &texture;
+    }
+
+    for (const bool depth_test : {false, true}) {
+        Canvas serial_canvas(width, height, "graphics_tests", true), binned_canvas(width, height, "graphics_tests", true);
+        Rasterizer serial(serial_canvas), binned(binned_canvas);
+        serial.SetThreadCount(1);
+        binned.SetThreadCount(4);
+        for (Rasterizer* rasterizer : {&serial, &binned}) {
+            rasterizer->SetDepthTest(depth_test);
+            rasterizer->ClearDepth();
+            rasterizer->DrawTriangles(triangles.data(), triangles.size());
+        }
+
+        const size_t pixels = static_cast<size_t>(width) * height;
+        GRAPHICS_CHECK(std::memcmp(serial_canvas.GetFramebuffer(), binned_canvas.GetFramebuffer(), pixels * sizeof(Color)) == 0);
+        int depth_differences = 0;
+        for (int y = 0; y < height; y++)
+            for (int x = 0; x < width; x++)
+                depth_differences += serial.GetDepthBuffer().Get(x, y) != binned.GetDepthBuffer().Get(x, y);
+        GRAPHICS_CHECK(depth_differences == 0);
+    }
+}
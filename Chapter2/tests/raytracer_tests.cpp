@@ -0,0 +1,195 @@
+#include "check.hpp"
+#include "images.hpp"
+#include "graphics/canvas.hpp"
+#include "graphics/raytracing.hpp"
+#include "graphics/scenes.hpp"
+#include "graphics/stats.hpp"
+#include "graphics/temporal.hpp"
+
+#include <algorithm>
+#include <cstdlib>
+#include <limits>
+#include <vector>
+
+using namespace graphics;
+
+namespace {
+
+    /**
+     * @brief Renders a scene for a few frames, so the threads' shadow caches carry over.
+     * @return The last frame
+     */
+    std::vector<Color> RenderFrames(Canvas& canvas, Raytracer& raytracer, int frames) {
+        for (int frame = 0; frame < frames; frame++)
+            raytracer.Render({0.0f, 0.0f, 0.0f});
+        return tests::Pixels(canvas);
+    }
+
+    /**
+     * @brief The mean color of a pixel's area, from a grid of rays across it.
+     */
+    Color Supersampled(Canvas& canvas, Raytracer& raytracer, int px, int py, int grid) {
+        const float x = static_cast<float>(px - canvas.GetWidth() / 2);
+        const float y = static_cast<float>(canvas.GetHeight() / 2 - py);
+        float rgb[3] = {};
+        for (int j = 0; j < grid; j++) {
+            for (int i = 0; i < grid; i++) {
+                const float dx = (i + 0.5f) / grid - 0.5f, dy = (j + 0.5f) / grid - 0.5f;
+                const Color c = raytracer.TraceRay({0.0f, 0.0f, 0.0f}, canvas.CanvasToViewPort(x + dx, y + dy), 1,
+                                                   std::numeric_limits<float>::infinity());
+                rgb[0] += c.r, rgb[1] += c.g, rgb[2] += c.b;
+            }
+        }
+        const float scale = 1.0f / static_cast<float>(grid * grid);
+        return Color{static_cast<unsigned char>(rgb[0] * scale + 0.5f), static_cast<unsigned char>(rgb[1] * scale + 0.5f),
+                     static_cast<unsigned char>(rgb[2] * scale + 0.5f), 255};
+    }
+
+    int ColorDifference(Color a, Color b) {
+        return std::max({std::abs(a.r - b.r), std::abs(a.g - b.g), std::abs(a.b - b.b)});
+    }
+
+} // namespace
+
+GRAPHICS_TEST(AntiAliasing, AdaptiveRefinesOnlyEdges) {
+    const int width = 160, height = 120;
+    Canvas canvas(width, height, "graphics_tests", true);
+    Raytracer raytracer(canvas);
+    raytracer.SetScene(scenes::BookScene());
+    const std::vector<Color> single = RenderFrames(canvas, raytracer, 1);
+    raytracer.SetAntiAliasing(AntiAliasing::Adaptive);
+    const std::vector<Color> adaptive = RenderFrames(canvas, raytracer, 1);
+
+    int uniform = 0, edges = 0, close = 0, worst = 0;
+    double single_error = 0.0, adaptive_error = 0.0;
+    for (int py = 1; py + 1 < height; py++) {
+        for (int px = 1; px + 1 < width; px++) {
+            const size_t i = static_cast<size_t>(py) * width + px;
+            int spread = 0;
+            for (const size_t n : {i - 1, i + 1, i - width, i + width})
+                spread = std::max(spread, ColorDifference(single[i], single[n]));
+
+            // a pixel its neighbours agree with keeps its one sample
+            if (spread == 0) {
+                uniform++;
+                GRAPHICS_CHECK(ColorDifference(adaptive[i], single[i]) == 0);
+                continue;
+            }
+            // silhouettes and shadow edges get the mean of their area, as far as a 5x5 grid of rays finds it
+            if (spread > 64) {
+                const Color reference = Supersampled(canvas, raytracer, px, py, 16);
+                const int error = ColorDifference(adaptive[i], reference);
+                edges++;
+                close += error <= 16;
+                worst = std::max(worst, error);
+                single_error += ColorDifference(single[i], reference);
+                adaptive_error += error;
+            }
+        }
+    }
+    GRAPHICS_CHECK(uniform > width * height / 3 && edges > 500);
+    GRAPHICS_CHECK(adaptive_error < 8.0 * edges);
+    GRAPHICS_CHECK(adaptive_error < 0.3 * single_error);
+    GRAPHICS_CHECK(close >= 0.9 * edges);
+    GRAPHICS_CHECK(worst <= 64);
+}
+
+GRAPHICS_TEST(ShadowCache, MatchesPlainOcclusion) {
+    Canvas canvas(160, 120, "graphics_tests", true);
+    for (const Scene& scene : {scenes::BookScene(), scenes::RandomSpheres(60, 3)}) {
+        Raytracer raytracer(canvas);
+        raytracer.SetThreadCount(4);
+        raytracer.SetScene(scene);
+
+        raytracer.SetShadowCache(false);
+        const std::vector<Color> plain = RenderFrames(canvas, raytracer, 1);
+
+        raytracer.SetShadowCache(true);
+        stats::BeginFrame();
+        const std::vector<Color> cached = RenderFrames(canvas, raytracer, 3);
+        const stats::FrameStats& frame = stats::EndFrame();
+        GRAPHICS_CHECK(tests::SameImage(plain, cached));
+
+        // only rays whose cached occluder was tested count as hits or misses
+        if constexpr (stats::Enabled()) {
+            const uint64_t tested = frame.Get(stats::Counter::ShadowCacheHits) +
+                                    frame.Get(stats::Counter::ShadowCacheMisses);
+            GRAPHICS_CHECK(frame.Get(stats::Counter::ShadowCacheHits) > 0);
+            GRAPHICS_CHECK(tested <= frame.Get(stats::Counter::ShadowRays));
+            GRAPHICS_CHECK(frame.Get(stats::Counter::ShadowCacheHits) <= frame.Get(stats::Counter::Occlusions));
+        }
+    }
+}
+
+GRAPHICS_TEST(Wavefront, MatchesPerPixel) {
+    Canvas canvas(160, 120, "graphics_tests", true);
+    // the book's ground is a sphere of radius 5000: near its horizon, k3 cancels to a few ulps and
+    // the two modes' differently rounded intersection code may pick another surface
+    const struct {
+        Scene scene;
+        float differing_fraction;
+        int worst;
+    } cases[] = {
+        {scenes::BookScene(), 0.02f, 255},
+        {scenes::RandomSpheres(60, 3), 0.001f, 1},
+    };
+    for (const auto& [scene, differing_fraction, worst] : cases) {
+        Raytracer raytracer(canvas);
+        raytracer.SetThreadCount(4);
+        raytracer.SetScene(scene);
+        const std::vector<Color> per_pixel = RenderFrames(canvas, raytracer, 1);
+
+        raytracer.SetRenderMode(RenderMode::Wavefront);
+        raytracer.SetRaySorting(false);
+        const std::vector<Color> unsorted = RenderFrames(canvas, raytracer, 1);
+        raytracer.SetRaySorting(true);
+        const std::vector<Color> sorted = RenderFrames(canvas, raytracer, 1);
+
+        // sorted rays write their results back to their own slots, so sorting changes no pixel
+        GRAPHICS_CHECK(tests::SameImage(unsorted, sorted));
+        size_t differing = 0;
+        for (size_t i = 0; i < per_pixel.size(); i++) {
+            const int difference = std::max({std::abs(per_pixel[i].r - sorted[i].r), std::abs(per_pixel[i].g - sorted[i].g),
+                                             std::abs(per_pixel[i].b - sorted[i].b)});
+            differing += difference > 0;
+            GRAPHICS_CHECK(difference <= worst);
+        }
+        GRAPHICS_CHECK(differing <= differing_fraction * per_pixel.size());
+    }
+}
+
+GRAPHICS_TEST(Wavefront, HeatmapDrawnPerPixel) {
+    Canvas canvas(160, 120, "graphics_tests", true);
+    Raytracer raytracer(canvas);
+    // a shadow cache kept from the last frame would change the counts
+    raytracer.SetShadowCache(false);
+    raytracer.SetOutput(RenderOutput::CostHeatmap, CostMetric::IntersectionTests);
+    const std::vector<Color> per_pixel = RenderFrames(canvas, raytracer, 1);
+    const CostMap expected = raytracer.GetCostMap();
+
+    // the wavefront stages measure no costs, so the heatmap and its values come from a per-pixel frame
+    raytracer.SetRenderMode(RenderMode::Wavefront);
+    GRAPHICS_CHECK(tests::SameImage(per_pixel, RenderFrames(canvas, raytracer, 1)));
+    const CostMap& costs = raytracer.GetCostMap();
+    GRAPHICS_CHECK(costs.GetWidth() == canvas.GetWidth() && costs.GetHeight() == canvas.GetHeight());
+    GRAPHICS_CHECK(costs.TileCosts(1) == expected.TileCosts(1));
+}
+
+GRAPHICS_TEST(Temporal, InterruptBetweenCallsStopsNextOne) {
+    Canvas canvas(160, 120, "graphics_tests", true);
+    Raytracer raytracer(canvas);
+    raytracer.SetScene(scenes::BookScene());
+    const std::vector<Color> rendered = RenderFrames(canvas, raytracer, 1);
+    TemporalAccumulator accumulator(canvas, raytracer);
+    accumulator.Accumulate({0.0f, 0.0f, 0.0f});
+
+    // the interrupt waits for the next call, which traces no row
+    accumulator.Interrupt();
+    accumulator.Accumulate({0.0f, 0.0f, 0.0f});
+    GRAPHICS_CHECK(tests::SameImage(rendered, tests::Pixels(canvas)));
+
+    // and ends with it: the call after refines the edges
+    GRAPHICS_CHECK(accumulator.Accumulate({0.0f, 0.0f, 0.0f}));
+    GRAPHICS_CHECK(!tests::SameImage(rendered, tests::Pixels(canvas)));
+    GRAPHICS_CHECK(accumulator.GetFrameCount() == 3);
+}
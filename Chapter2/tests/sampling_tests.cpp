@@ -0,0 +1,81 @@
+#include "check.hpp"
+#include "graphics/sampling.hpp"
+
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <vector>
+
+using namespace graphics::sampling;
+
+namespace {
+
+    constexpr uint32_t kPixels = 256;
+
+    /**
+     * @brief Root mean square error, over pixels, of per-pixel estimates of an integral.
+     * @param integrand Value of one sample of a pixel
+     * @param checkpoints Sample counts to measure at, increasing
+     * @param exact Value of the integral
+     */
+    template <typename Integrand>
+    std::vector<double> Rmse(Integrand integrand, const std::vector<uint32_t>& checkpoints, double exact) {
+        std::vector<double> squared_errors(checkpoints.size(), 0.0);
+        for (uint32_t pixel = 0; pixel < kPixels; pixel++) {
+            double sum = 0.0;
+            uint32_t sample = 0;
+            for (size_t i = 0; i < checkpoints.size(); i++) {
+                for (; sample < checkpoints[i]; sample++)
+                    sum += integrand(pixel, sample);
+                const double error = sum / checkpoints[i] - exact;
+                squared_errors[i] += error * error;
+            }
+        }
+        for (double& value : squared_errors)
+            value = std::sqrt(value / kPixels);
+        return squared_errors;
+    }
+
+} // namespace
+
+GRAPHICS_TEST(Sampling, PathsConvergeAtHighSampleCounts) {
+    // four dimensions, as a camera ray and three bounces read them; each factor integrates to 1
+    const SampleTable& table = SampleTable::Instance();
+    const auto path = [&](uint32_t pixel, uint32_t sample) {
+        double value = 1.0;
+        for (uint32_t dimension = 0; dimension < 4; dimension++) {
+            const Sample2D point = table.Get(pixel, sample, dimension);
+            value *= point.u + point.v;
+        }
+        return value;
+    };
+    const std::vector<uint32_t> counts = {64, 256, 1024, 4096, 16384};
+    const std::vector<double> rmse = Rmse(path, counts, 1.0);
+    for (size_t i = 0; i < counts.size(); i++)
+        std::printf("  %5u spp: RMSE %.2e\n", counts[i], rmse[i]);
+
+    // a quarter of the error or better for four times the samples would be QMC; half is plain
+    // Monte Carlo. Dimensions that depend on each other stop improving at some count instead
+    for (size_t i = 1; i < counts.size(); i++)
+        GRAPHICS_CHECK(rmse[i] < 0.6 * rmse[i - 1]);
+}
+
+GRAPHICS_TEST(Sampling, DimensionsStayStratified) {
+    // a smooth function of one dimension: stratified points beat random ones by far
+    const SampleTable& table = SampleTable::Instance();
+    const auto smooth = [](Sample2D point) { return std::exp(point.u) * std::sin(3.0 * point.v); };
+    const double exact = (std::exp(1.0) - 1.0) * (1.0 - std::cos(3.0)) / 3.0;
+    const std::vector<uint32_t> counts = {1024};
+    for (uint32_t dimension = 0; dimension < 3; dimension++) {
+        const double sobol = Rmse([&](uint32_t pixel, uint32_t sample) {
+            return smooth(table.Get(pixel, sample, dimension));
+        }, counts, exact)[0];
+        const double random = Rmse([&](uint32_t pixel, uint32_t sample) {
+            Pcg32 generator(pixel * 8 + dimension, sample);
+            const float u = generator.Next();
+            return smooth({u, generator.Next()});
+        }, counts, exact)[0];
+        std::printf("  dimension %u: RMSE %.2e, random %.2e\n", dimension, sobol, random);
+        GRAPHICS_CHECK(sobol < 0.1 * random);
+    }
+}
@@ -0,0 +1,158 @@
+#include "check.hpp"
+#include "graphics/texture.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+using namespace graphics;
+
+namespace {
+
+    /**
+     * @brief An image of random colors, row-major.
+     */
+    std::vector<Color> RandomImage(int width, int height, uint32_t seed) {
+        std::mt19937 rng(seed);
+        std::uniform_int_distribution<int> channel(0, 255);
+        std::vector<Color> pixels(static_cast<size_t>(width) * height);
+        for (Color& pixel : pixels)
+            pixel = {static_cast<unsigned char>(channel(rng)), static_cast<unsigned char>(channel(rng)),
+                     static_cast<unsigned char>(channel(rng)), static_cast<unsigned char>(channel(rng))};
+        return pixels;
+    }
+
+    bool SameColor(Color a, Color b) {
+        return a.r == b.r && a.g == b.g && a.b == b.b && a.a == b.a;
+    }
+
+    bool CloseColor(Color a, Color b, int tolerance) {
+        return std::abs(a.r - b.r) <= tolerance && std::abs(a.g - b.g) <= tolerance && std::abs(a.b - b.b) <= tolerance &&
+               std::abs(a.a - b.a) <= tolerance;
+    }
+
+    /**
+     * @brief Size of a mip level: both sides halved per level, rounding down, never below 1.
+     */
+    int LevelSize(int size, int level) {
+        return std::max(1, size >> level);
+    }
+
+    // sizes that are neither powers of two nor multiples of the 4x4 tiles, and thin ones
+    constexpr int kSizes[][2] = {{1, 1}, {5, 3}, {7, 13}, {17, 9}, {33, 1}, {1, 6}, {30, 22}, {64, 64}};
+
+} // namespace
+
+GRAPHICS_TEST(Texture, TexelsRoundTrip) {
+    for (const auto& [width, height] : kSizes) {
+        const std::vector<Color> pixels = RandomImage(width, height, static_cast<uint32_t>(width * 100 + height));
+        const TextureMap texture(pixels.data(), width, height);
+        GRAPHICS_CHECK(texture.GetWidth() == width && texture.GetHeight() == height);
+        for (int y = 0; y < height; y++)
+            for (int x = 0; x < width; x++)
+                GRAPHICS_CHECK(SameColor(texture.Texel(0, x, y), pixels[static_cast<size_t>(y) * width + x]));
+    }
+}
+
+GRAPHICS_TEST(Texture, MipChainIsBoxAverage) {
+    for (const auto& [width, height] : kSizes) {
+        const std::vector<Color> pixels = RandomImage(width, height, static_cast<uint32_t>(width + height * 100));
+        const TextureMap texture(pixels.data(), width, height);
+
+        // one level per halving of the longer side, the last one 1x1
+        int levels = 1;
+        while (LevelSize(width, levels - 1) > 1 || LevelSize(height, levels - 1) > 1)
+            levels++;
+        GRAPHICS_CHECK(texture.GetLevelCount() == levels);
+
+        // each texel the rounded mean of the 2x2 texels above it; an odd side repeats its last row or column
+        for (int level = 1; level < texture.GetLevelCount(); level++) {
+            const int source_width = LevelSize(width, level - 1), source_height = LevelSize(height, level - 1);
+            for (int y = 0; y < LevelSize(height, level); y++) {
+                for (int x = 0; x < LevelSize(width, level); x++) {
+                    const int xs[2] = {std::min(2 * x, source_width - 1), std::min(2 * x + 1, source_width - 1)};
+                    const int ys[2] = {std::min(2 * y, source_height - 1), std::min(2 * y + 1, source_height - 1)};
+                    int sum[4] = {};
+                    for (const int sy : ys) {
+                        for (const int sx : xs) {
+                            const Color c = texture.Texel(level - 1, sx, sy);
+                            sum[0] += c.r, sum[1] += c.g, sum[2] += c.b, sum[3] += c.a;
+                        }
+                    }
+                    const Color expected{static_cast<unsigned char>((sum[0] + 2) / 4), static_cast<unsigned char>((sum[1] + 2) / 4),
+                                         static_cast<unsigned char>((sum[2] + 2) / 4), static_cast<unsigned char>((sum[3] + 2) / 4)};
+                    GRAPHICS_CHECK(SameColor(texture.Texel(level, x, y), expected));
+                }
+            }
+        }
+    }
+}
+
+GRAPHICS_TEST(Texture, SamplePicksLevel) {
+    const int width = 30, height = 22;
+    const std::vector<Color> pixels = RandomImage(width, height, 5);
+    TextureMap texture(pixels.data(), width, height);
+    const int last = texture.GetLevelCount() - 1;
+
+    // nearest: the level closest to the lod, level 0 when magnified, the last one past the chain
+    texture.SetFilter(TextureFilter::Nearest);
+    std::mt19937 rng(6);
+    std::uniform_real_distribution<float> coordinate(0.0f, 1.0f), lod(-3.0f, 8.0f);
+    for (int k = 0; k < 2000; k++) {
+        const float u = coordinate(rng), v = coordinate(rng), l = lod(rng);
+        const int level = l <= 0.0f ? 0 : std::min(static_cast<int>(std::lround(l)), last);
+        const int x = std::min(static_cast<int>(u * LevelSize(width, level)), LevelSize(width, level) - 1);
+        const int y = std::min(static_cast<int>(v * LevelSize(height, level)), LevelSize(height, level) - 1);
+        GRAPHICS_CHECK(SameColor(texture.Sample(u, v, l), texture.Texel(level, x, y)));
+    }
+
+    // bilinear and trilinear at a whole lod read that level alone, exactly at its texel centers
+    for (const TextureFilter filter : {TextureFilter::Bilinear, TextureFilter::Trilinear}) {
+        texture.SetFilter(filter);
+        for (int level = 0; level <= last; level++) {
+            const int level_width = LevelSize(width, level), level_height = LevelSize(height, level);
+            for (int y = 0; y < level_height; y++) {
+                for (int x = 0; x < level_width; x++) {
+                    const float u = (x + 0.5f) / level_width, v = (y + 0.5f) / level_height;
+                    GRAPHICS_CHECK(SameColor(texture.Sample(u, v, static_cast<float>(level)), texture.Texel(level, x, y)));
+                }
+            }
+        }
+    }
+}
+
+GRAPHICS_TEST(Texture, SampleWrapsAtEdges) {
+    const int width = 30, height = 22;
+    const std::vector<Color> pixels = RandomImage(width, height, 7);
+    TextureMap texture(pixels.data(), width, height);
+
+    // nearest: 0 and 1 are the first texel, just below 1 the last, and coordinates repeat
+    texture.SetFilter(TextureFilter::Nearest);
+    const float v = 7.5f / height;
+    GRAPHICS_CHECK(SameColor(texture.Sample(0.0f, v, 0.0f), texture.Texel(0, 0, 7)));
+    GRAPHICS_CHECK(SameColor(texture.Sample(1.0f, v, 0.0f), texture.Texel(0, 0, 7)));
+    GRAPHICS_CHECK(SameColor(texture.Sample(0.999f, v, 0.0f), texture.Texel(0, width - 1, 7)));
+    GRAPHICS_CHECK(SameColor(texture.Sample(-1e-9f, v, 0.0f), texture.Texel(0, 0, 7)));
+    GRAPHICS_CHECK(SameColor(texture.Sample(-0.25f, v, 0.0f), texture.Sample(0.75f, v, 0.0f)));
+    GRAPHICS_CHECK(SameColor(texture.Sample(2.25f, v, 0.0f), texture.Sample(0.25f, v, 0.0f)));
+    const float u = 11.5f / width;
+    GRAPHICS_CHECK(SameColor(texture.Sample(u, 0.0f, 0.0f), texture.Texel(0, 11, 0)));
+    GRAPHICS_CHECK(SameColor(texture.Sample(u, 1.0f, 0.0f), texture.Texel(0, 11, 0)));
+    GRAPHICS_CHECK(SameColor(texture.Sample(u, 0.999f, 0.0f), texture.Texel(0, 11, height - 1)));
+
+    // bilinear: u = 0 and 1 fall halfway between the last and the first column, v likewise
+    texture.SetFilter(TextureFilter::Bilinear);
+    const auto halfway = [](Color a, Color b) {
+        return Color{static_cast<unsigned char>((a.r + b.r + 1) / 2), static_cast<unsigned char>((a.g + b.g + 1) / 2),
+                     static_cast<unsigned char>((a.b + b.b + 1) / 2), static_cast<unsigned char>((a.a + b.a + 1) / 2)};
+    };
+    const Color across_u = halfway(texture.Texel(0, width - 1, 7), texture.Texel(0, 0, 7));
+    const Color across_v = halfway(texture.Texel(0, 11, height - 1), texture.Texel(0, 11, 0));
+    for (const float edge : {0.0f, 1.0f, -1.0f, 2.0f}) {
+        GRAPHICS_CHECK(CloseColor(texture.Sample(edge, v, 0.0f), across_u, 1));
+        GRAPHICS_CHECK(CloseColor(texture.Sample(u, edge, 0.0f), across_v, 1));
+    }
+}
@@ -0,0 +1,113 @@
+#include "check.hpp"
+#include "images.hpp"
+#include "graphics/canvas.hpp"
+#include "graphics/clipping.hpp"
+#include "graphics/mesh.hpp"
+#include "graphics/transform.hpp"
+#include "raymath.h"
+
+#include <cmath>
+#include <cstring>
+#include <vector>
+
+using namespace graphics;
+
+namespace {
+
+    /**
+     * @brief Applies a matrix to a column vector, one scalar product at a time.
+     */
+    void Apply(const Matrix& m, const float in[4], float out[4]) {
+        out[0] = m.m0 * in[0] + m.m4 * in[1] + m.m8 * in[2] + m.m12 * in[3];
+        out[1] = m.m1 * in[0] + m.m5 * in[1] + m.m9 * in[2] + m.m13 * in[3];
+        out[2] = m.m2 * in[0] + m.m6 * in[1] + m.m10 * in[2] + m.m14 * in[3];
+        out[3] = m.m3 * in[0] + m.m7 * in[1] + m.m11 * in[2] + m.m15 * in[3];
+    }
+
+    bool SameMatrix(const Matrix& a, const Matrix& b) {
+        return std::memcmp(&a, &b, sizeof(Matrix)) == 0;
+    }
+
+} // namespace
+
+GRAPHICS_TEST(Transform, MatchesScalarChain) {
+    Canvas canvas(640, 480, "graphics_tests", true);
+    Mesh mesh = Mesh::UvSphere({0.0f, 0.0f, 0.0f}, 1.5f, 64, 32);
+    OptimizeVertexCache(mesh);
+    const Matrix model = MatrixMultiply(MatrixRotateY(0.7f), MatrixTranslate(0.5f, 0.2f, 1.0f));
+    const Matrix view = MatrixTranslate(0.0f, 0.0f, 4.0f);
+    const Matrix projection = ProjectionFromViewPort(canvas, 0.5f);
+    ViewProjection camera;
+    camera.SetProjection(projection);
+    camera.SetView(view);
+    Instance instance(mesh);
+    instance.SetModel(model);
+
+    // model, then view, then projection, applied one after the other
+    ClipVertexBuffer vertices;
+    TransformVertices(instance, camera, vertices);
+    double error = 0.0;
+    for (size_t i = 0; i < mesh.vertex_count; i++) {
+        const float position[4] = {mesh.x[i], mesh.y[i], mesh.z[i], 1.0f};
+        float world[4], eye[4], clip[4];
+        Apply(model, position, world);
+        Apply(view, world, eye);
+        Apply(projection, eye, clip);
+        const float got[4] = {vertices.x[i], vertices.y[i], vertices.z[i], vertices.w[i]};
+        for (int k = 0; k < 4; k++)
+            error = std::fmax(error, std::fabs(got[k] - clip[k]));
+    }
+    GRAPHICS_CHECK(vertices.count == mesh.vertex_count);
+    GRAPHICS_CHECK(error < 1e-5);
+    for (size_t i = mesh.vertex_count; i < vertices.x.size(); i++)
+        GRAPHICS_CHECK(vertices.w[i] == 1.0f);
+
+    // the batch transform draws what the vertex stage draws
+    VertexStage stage;
+    ClipVertexBuffer stage_vertices;
+    std::vector<uint32_t> stage_indices;
+    stage.Process(mesh, instance.GetModelViewProjection(camera), stage_vertices, stage_indices);
+    const std::vector<Color> batch = tests::DrawClipped(canvas, vertices, mesh.indices.data(), mesh.GetTriangleCount());
+    const std::vector<Color> staged = tests::DrawClipped(canvas, stage_vertices, stage_indices.data(), stage_indices.size() / 3);
+    GRAPHICS_CHECK(tests::SameImage(batch, staged));
+}
+
+GRAPHICS_TEST(Transform, CachedMatrixFollowsChanges) {
+    const Mesh mesh = Mesh::UvSphere({0.0f, 0.0f, 0.0f}, 1.0f, 8, 4);
+    ViewProjection camera;
+    camera.SetProjection(MatrixPerspective(1.0, 4.0 / 3.0, 0.5, 100.0));
+    camera.SetView(MatrixTranslate(0.0f, 0.0f, 4.0f));
+    Instance instance(mesh);
+    instance.SetModel(MatrixRotateY(0.7f));
+
+    const auto expected = [&] { return MatrixMultiply(instance.GetModel(), camera.GetViewProjection()); };
+    GRAPHICS_CHECK(SameMatrix(instance.GetModelViewProjection(camera), expected()));
+
+    camera.SetView(MatrixTranslate(0.0f, 1.0f, 5.0f));
+    GRAPHICS_CHECK(SameMatrix(instance.GetModelViewProjection(camera), expected()));
+
+    instance.SetModel(MatrixTranslate(1.0f, 0.0f, 0.0f));
+    GRAPHICS_CHECK(SameMatrix(instance.GetModelViewProjection(camera), expected()));
+
+    // another camera, set as often as the first one
+    ViewProjection other;
+    other.SetProjection(MatrixPerspective(0.5, 1.0, 0.5, 100.0));
+    other.SetView(MatrixTranslate(2.0f, 0.0f, 4.0f));
+    GRAPHICS_CHECK(SameMatrix(instance.GetModelViewProjection(other), MatrixMultiply(instance.GetModel(), other.GetViewProjection())));
+}
+
+GRAPHICS_TEST(Transform, CameraRebuiltInPlace) {
+    const Mesh mesh = Mesh::UvSphere({0.0f, 0.0f, 0.0f}, 1.0f, 8, 4);
+    Instance instance(mesh);
+    instance.SetModel(MatrixRotateY(0.7f));
+
+    // a camera built anew each frame, in the same object and with the same calls
+    ViewProjection camera;
+    for (int frame = 0; frame < 3; frame++) {
+        camera = ViewProjection();
+        camera.SetProjection(MatrixPerspective(1.0, 4.0 / 3.0, 0.5, 100.0));
+        camera.SetView(MatrixTranslate(0.5f * frame, 0.0f, 4.0f));
+        GRAPHICS_CHECK(SameMatrix(instance.GetModelViewProjection(camera),
+                                  MatrixMultiply(instance.GetModel(), camera.GetViewProjection())));
+    }
+}